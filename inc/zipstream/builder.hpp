@@ -2,6 +2,12 @@
 #define ZIPSTREAM_BUILDER_HPP
 
 #include <zipstream/stream_i.hpp>
+#include <zipstream/tree_filter.hpp>
+#include <zipstream/entry_generator.hpp>
+#include <zipstream/range_source_i.hpp>
+#include <zipstream/compression.hpp>
+#include <zipstream/content_cache.hpp>
+#include <zipstream/entry_order.hpp>
 
 #include <string>
 #include <memory>
@@ -21,7 +27,19 @@ public:
     builder& add_directory(std::string const & name);
     builder& add_file_with_content(std::string const & name, std::string const & content);
     builder& add_file_from_path(std::string const & name, std::string const & path);
+    builder& add_tree(std::string const & root, std::string const & prefix, tree_filter const & filter = tree_filter());
+    builder& add_file_from_archive(std::string const & name, std::string const & archive, std::string const & entry_name);
+    builder& add_archive(std::string const & archive, std::string const & prefix = std::string());
+    builder& set_alignment(size_t alignment);
+    builder& set_compression(compression backend, int level = -1);
+    builder& set_compression_policy(compression_policy const & policy);
+    builder& set_adaptive_level(int min_level, int max_level);
+    builder& set_content_cache(std::shared_ptr<content_cache> cache);
+    builder& set_entry_order(entry_order order, bool keep_toc_order = false);
     std::unique_ptr<stream_i> build();
+    std::unique_ptr<stream_i> build(entry_generator generator);
+    std::unique_ptr<range_source_i> build_ranges();
+    void append_to_file(std::string const & path);
 private:
     class detail;
     detail *d;
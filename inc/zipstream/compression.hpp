@@ -0,0 +1,44 @@
+#ifndef ZIPSTREAM_COMPRESSION_HPP
+#define ZIPSTREAM_COMPRESSION_HPP
+
+#include <cinttypes>
+#include <map>
+#include <string>
+
+namespace zipstream
+{
+
+// Compression backend of an entry.
+// zlib and libdeflate produce deflate (method 8), which every unzip tool
+// reads. libdeflate compresses small entries in one shot and falls back
+// to zlib for entries that do not fit into memory. zstd produces method
+// 93, which is only supported by newer tools.
+enum class compression: uint8_t
+{
+    store,
+    zlib,
+    libdeflate,
+    zstd
+};
+
+// libdeflate and zstd are loaded at runtime and may be missing
+bool compression_available(compression backend);
+
+// Decides per entry whether compressing it pays off.
+// Entries starting with the signature of a compressed format (JPEG, PNG,
+// MP4, gzip, zip, ...) are stored. Otherwise the byte entropy of the first
+// block estimates the savings; if it is inconclusive, the block (or the
+// whole entry, if it is small) is compressed on trial. Entries saving
+// less than min_savings of their size are stored.
+struct compression_policy
+{
+    double min_savings = 0.05;
+
+    // backends per lower case file extension including the dot, e.g.
+    // ".jpg"; they bypass the estimate and the backend of the builder
+    std::map<std::string, compression> extensions;
+};
+
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef ZIPSTREAM_CONTENT_CACHE_HPP
+#define ZIPSTREAM_CONTENT_CACHE_HPP
+
+#include <zipstream/compression.hpp>
+
+#include <cinttypes>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace zipstream
+{
+
+// identity of a file and the compressor settings its payload was made with
+struct content_key
+{
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime;
+    compression backend;
+    int level;
+
+    bool operator==(content_key const & other) const;
+};
+
+// compressed payload of a file
+struct cached_content
+{
+    uint32_t crc32;
+    uint64_t size;
+    std::shared_ptr<std::string const> data;
+};
+
+// Cache of compressed file payloads shared by builders and streams.
+// Payloads are kept in files below directory, up to disk_limit bytes,
+// and the most recently used ones in memory, up to memory_limit bytes;
+// the least recently used payloads are evicted first. Payloads larger
+// than memory_limit are not cached. A modified file gets a new key, as
+// its size or modification time changes. Files are written atomically,
+// so several processes may share a directory. All methods are thread-safe.
+class content_cache
+{
+    content_cache(content_cache const &) = delete;
+    content_cache& operator=(content_cache const &) = delete;
+public:
+    static constexpr size_t const default_memory_limit = 64 * 1024 * 1024;
+
+    content_cache(std::string const & directory, size_t disk_limit, size_t memory_limit = default_memory_limit);
+    ~content_cache();
+
+    static content_key key_of(std::string const & path, compression backend, int level);
+
+    std::optional<cached_content> find(content_key const & key);
+    cached_content insert(content_key const & key, uint32_t crc32, std::string && data);
+
+    size_t max_payload_size() const;
+    size_t memory_usage() const;
+    size_t disk_usage() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    class detail;
+    detail *d;
+};
+
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef ZIPSTREAM_DESCRIPTORS_HPP
+#define ZIPSTREAM_DESCRIPTORS_HPP
+
+#include <cstddef>
+
+namespace zipstream
+{
+
+// Limits the descriptors of files added by path that are kept open
+// between reads; they are shared by all streams of the process.
+void set_descriptor_limit(size_t limit);
+
+// Descriptors currently kept open by the shared cache.
+size_t get_cached_descriptors();
+
+}
+
+#endif
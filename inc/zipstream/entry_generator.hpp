@@ -0,0 +1,29 @@
+#ifndef ZIPSTREAM_ENTRY_GENERATOR_HPP
+#define ZIPSTREAM_ENTRY_GENERATOR_HPP
+
+#include <string>
+#include <functional>
+
+namespace zipstream
+{
+
+class entry_sink_i
+{
+public:
+    virtual ~entry_sink_i() = default;
+    virtual void add_directory(std::string const & name) = 0;
+    virtual void add_file_with_content(std::string const & name, std::string const & content) = 0;
+    virtual void add_file_from_path(std::string const & name, std::string const & path) = 0;
+    // true once the stream was cancelled; generators waiting for entries
+    // should return false then
+    virtual bool cancelled() const { return false; }
+};
+
+// Called by the stream whenever it needs further entries.
+// Adds one or more entries to sink and returns true, or returns
+// false if there are no more entries.
+using entry_generator = std::function<bool(entry_sink_i & sink)>;
+
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef ZIPSTREAM_ENTRY_ORDER_HPP
+#define ZIPSTREAM_ENTRY_ORDER_HPP
+
+#include <cinttypes>
+
+namespace zipstream
+{
+
+// Order in which the data of files added by path is written.
+// Reading files in the order of their location on disk avoids seeks on
+// spinning disks and network block devices. physical sorts by the first
+// extent reported by FIEMAP; files without one (empty or inline files,
+// file systems without FIEMAP) follow, sorted by inode number. Entries
+// not read from files come first, in insertion order.
+enum class entry_order: uint8_t
+{
+    insertion,
+    inode,
+    physical
+};
+
+}
+
+#endif
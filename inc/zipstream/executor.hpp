@@ -0,0 +1,67 @@
+#ifndef ZIPSTREAM_EXECUTOR_HPP
+#define ZIPSTREAM_EXECUTOR_HPP
+
+#include <zipstream/stream_i.hpp>
+#include <zipstream/sink_i.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+
+namespace zipstream
+{
+
+struct executor_options
+{
+    // 0 selects one worker per CPU
+    size_t worker_count = 0;
+    // staging buffer of a stream while it runs or waits for its sink
+    size_t buffer_size = 64 * 1024;
+    // memory of all streams holding a staging buffer, including the
+    // buffer; checked whenever a stream gets its buffer
+    size_t memory_limit = 256 * 1024 * 1024;
+    // a stream yields to the next one after writing slice_size bytes
+    // or after slice_time, whatever comes first
+    size_t slice_size = 256 * 1024;
+    std::chrono::microseconds slice_time = std::chrono::microseconds(2000);
+};
+
+// Drives many streams to their sinks using a fixed number of workers.
+// Each worker runs streams from its own queue in time slices and steals
+// from the other queues when it runs dry. Streams whose sinks are full
+// are parked until the sink is writable (epoll) and hold their staging
+// buffer meanwhile; streams only get a buffer while the memory limit
+// allows, otherwise they wait for another stream to release one. The
+// memory usage counts each stream holding a buffer with its buffer and
+// its own memory_usage, updated after every time slice.
+// done is called on a worker once the stream is written completely,
+// with the exception that stopped it otherwise. Streams left when the
+// executor is destroyed are completed with an error.
+class executor
+{
+    executor(executor const &) = delete;
+    executor& operator=(executor const &) = delete;
+public:
+    using completion = std::function<void(std::exception_ptr error)>;
+
+    explicit executor(executor_options const & options = executor_options());
+    ~executor();
+
+    void submit(std::unique_ptr<stream_i> stream, std::unique_ptr<sink_i> sink, completion done = nullptr);
+
+    // blocks until all submitted streams are completed
+    void wait();
+
+    size_t active() const;
+    size_t memory_usage() const;
+
+private:
+    class detail;
+    detail *d;
+};
+
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef ZIPSTREAM_LIVE_BUILDER_HPP
+#define ZIPSTREAM_LIVE_BUILDER_HPP
+
+#include <zipstream/stream_i.hpp>
+
+#include <string>
+#include <memory>
+
+namespace zipstream
+{
+
+// Builder for archives whose entries are not known up front.
+// Entries can be added from any number of threads while the stream
+// returned by build() is already read. Entries are emitted in the order
+// they were added; the central directory is written after finish().
+// Reading the stream blocks while no entries are pending.
+class live_builder
+{
+    live_builder(live_builder const &) = delete;
+    live_builder& operator=(live_builder const &) = delete;
+public:
+    live_builder();
+    ~live_builder();
+    live_builder(live_builder && other);
+    live_builder& operator=(live_builder && other);
+    live_builder& add_directory(std::string const & name);
+    live_builder& add_file_with_content(std::string const & name, std::string const & content);
+    live_builder& add_file_from_path(std::string const & name, std::string const & path);
+    void finish();
+    std::unique_ptr<stream_i> build();
+private:
+    class detail;
+    detail *d;
+};
+
+}
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef ZIPSTREAM_MEMORY_HPP
+#define ZIPSTREAM_MEMORY_HPP
+
+#include <cstddef>
+
+namespace zipstream
+{
+
+// Limits the scratch and I/O buffers that streams borrow from the
+// shared buffer pool: global_limit for all streams of the process,
+// stream_limit for a single stream.
+void set_memory_limits(size_t global_limit, size_t stream_limit);
+
+// Bytes currently allocated by the shared buffer pool.
+size_t get_pooled_memory();
+
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef ZIPSTREAM_PIPELINE_HPP
+#define ZIPSTREAM_PIPELINE_HPP
+
+#include <zipstream/stream_i.hpp>
+
+#include <memory>
+#include <cstddef>
+
+namespace zipstream
+{
+
+constexpr size_t const default_pipeline_size = 1024 * 1024;
+
+// Runs stream on a dedicated producer thread that fills a ring buffer
+// of ring_size bytes ahead of read(). read() only copies out bytes
+// that are ready and blocks while none are available.
+std::unique_ptr<stream_i> make_pipelined(std::unique_ptr<stream_i> stream, size_t ring_size = default_pipeline_size);
+
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef ZIPSTREAM_RANGE_SOURCE_I_HPP
+#define ZIPSTREAM_RANGE_SOURCE_I_HPP
+
+#include <zipstream/stream_i.hpp>
+
+#include <memory>
+#include <cstddef>
+
+namespace zipstream
+{
+
+// Archive with a fully determined layout.
+// Any byte range can be produced independently; open_range may be
+// called from multiple threads and the returned streams can be read
+// concurrently.
+class range_source_i
+{
+public:
+    virtual ~range_source_i() = default;
+    virtual size_t size() const = 0;
+    virtual std::unique_ptr<stream_i> open_range(size_t begin, size_t end) const = 0;
+};
+
+}
+
+#endif
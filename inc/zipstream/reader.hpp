@@ -0,0 +1,105 @@
+#ifndef ZIPSTREAM_READER_HPP
+#define ZIPSTREAM_READER_HPP
+
+#include <cinttypes>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace zipstream
+{
+
+// central directory record of an entry; views point into the mapped archive
+struct entry_info
+{
+    uint16_t version_made_by;
+    uint16_t version_needed;
+    uint16_t flags;
+    uint16_t compression_method;
+    uint16_t last_mod_time;
+    uint16_t last_mod_date;
+    uint32_t crc32;
+    uint64_t compressed_size;
+    uint64_t uncompressed_size;
+    uint32_t disk_number_start;
+    uint16_t internal_attributes;
+    uint32_t external_attributes;
+    uint64_t local_header_offset;
+    std::string_view name;
+    std::string_view extra;
+    std::string_view comment;
+};
+
+// local file header of an entry; views point into the mapped archive
+struct local_header_info
+{
+    uint16_t version_needed;
+    uint16_t flags;
+    uint16_t compression_method;
+    uint16_t last_mod_time;
+    uint16_t last_mod_date;
+    uint32_t crc32;
+    uint32_t compressed_size;
+    uint32_t uncompressed_size;
+    std::string_view name;
+    std::string_view extra;
+    uint64_t data_offset;
+};
+
+// Zero-copy reader of zip archives, including Zip64.
+// The archive is mapped once; the central directory is indexed on first
+// access to an entry. Names and entry data are returned as views into
+// the mapping and stay valid as long as the reader exists.
+// All const methods may be called concurrently.
+class reader
+{
+    reader(reader const &) = delete;
+    reader& operator=(reader const &) = delete;
+public:
+    explicit reader(std::string const & path);
+    ~reader();
+    reader(reader && other);
+    reader& operator=(reader && other);
+
+    size_t size() const;
+    size_t count() const;
+    uint64_t toc_offset() const;
+    // records of the central directory
+    std::string_view toc() const;
+    // the whole mapped archive
+    std::string_view bytes() const;
+    std::string_view comment() const;
+
+    entry_info entry(size_t index) const;
+    std::string_view name(size_t index) const;
+    std::optional<size_t> find(std::string_view name) const;
+    local_header_info local_header(size_t index) const;
+
+    // compressed data of an entry; for stored entries this is the content
+    std::string_view data(size_t index) const;
+
+    // Optional hash index over entry names, used by find once present.
+    // The index can be kept in a sidecar file together with the offsets
+    // of all central directory records, so a reopened archive needs no
+    // pass over its central directory. Loading fails if the sidecar does
+    // not match the archive. Building or loading the index must not run
+    // concurrently with other calls.
+    void build_index();
+    void save_index(std::string const & path);
+    bool load_index(std::string const & path);
+
+private:
+    class detail;
+    detail *d;
+};
+
+// Rebuilds the central directory of a damaged or truncated archive from
+// the intact local headers found in it. The archive up to the end of the
+// last intact entry is written to output, followed by the new central
+// directory. Returns the number of recovered entries.
+size_t recover_archive(std::string const & path, std::string const & output);
+
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef ZIPSTREAM_SINK_I_HPP
+#define ZIPSTREAM_SINK_I_HPP
+
+#include <cstddef>
+#include <memory>
+
+namespace zipstream
+{
+
+// Destination of a stream driven by an executor.
+class sink_i
+{
+public:
+    virtual ~sink_i() = default;
+
+    // writes at most size bytes and returns the number written;
+    // 0 if the sink is full, in which case writing is retried once
+    // the descriptor is writable
+    virtual size_t write(char const * data, size_t size) = 0;
+
+    // called once the whole stream was written, e.g. to write data
+    // held back by the sink
+    virtual void finish() = 0;
+
+    // descriptor polled for writability, or -1 if there is none
+    virtual int descriptor() const = 0;
+};
+
+// Writes to a file, pipe or socket; the descriptor is not closed.
+// Non-blocking descriptors let an executor pause the stream while the
+// descriptor is full instead of blocking a worker. Descriptors opened
+// with O_DIRECT are written in aligned blocks; the unaligned tail is
+// written with O_DIRECT cleared once the stream is finished.
+std::unique_ptr<sink_i> make_fd_sink(int fd);
+
+}
+
+#endif
@@ -1,19 +1,56 @@
 #ifndef ZIPSTREAM_STREAM_I_HPP
 #define ZIPSTREAM_STREAM_I_HPP
 
+#include <cinttypes>
+#include <optional>
 #include <string>
 
 namespace zipstream
 {
 
+// counters of the entries completed since the stream was created or reset
+struct stream_statistics
+{
+    uint64_t entries = 0;
+    uint64_t compressed_entries = 0;
+    // entries stored since compressing them would not pay off
+    uint64_t incompressible_entries = 0;
+    uint64_t uncompressed_bytes = 0;
+    uint64_t compressed_bytes = 0;
+    // current level in adaptive mode, -1 otherwise
+    int compression_level = -1;
+};
+
+enum class write_mode
+{
+    buffered,
+    // bypasses the page cache (O_DIRECT), e.g. for very large archives;
+    // falls back to buffered writes if the filesystem does not support it
+    direct
+};
+
+// Only read, skip and reset must be implemented; the other methods
+// have defaults built on them.
 class stream_i
 {
 public:
     virtual ~stream_i() = default;
-    virtual void write_to_file(std::string const & path) = 0;
+    virtual void write_to_file(std::string const & path);
+    virtual void write_to_file(std::string const & path, write_mode mode);
+    // writes the stream to a file, pipe or socket; the descriptor is not closed.
+    // Descriptors opened with O_DIRECT are written in aligned blocks.
+    virtual void write_to_fd(int fd);
     virtual size_t read(char * buffer, size_t buffer_size) = 0;
     virtual void skip(size_t count) = 0;
     virtual void reset() = 0;
+    // 0 if unknown
+    virtual size_t memory_usage() const;
+    virtual stream_statistics statistics() const;
+    // size of the whole stream if it is known before reading it
+    virtual std::optional<size_t> expected_size() const;
+    // makes a read() in another thread that waits for generated entries,
+    // e.g. of a live builder, give up with an exception
+    virtual void cancel() {}
 };
 
 }
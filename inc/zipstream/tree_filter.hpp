@@ -0,0 +1,23 @@
+#ifndef ZIPSTREAM_TREE_FILTER_HPP
+#define ZIPSTREAM_TREE_FILTER_HPP
+
+#include <string>
+#include <vector>
+
+namespace zipstream
+{
+
+// Glob patterns (fnmatch syntax) matched against the path relative
+// to the root of a tree added by builder::add_tree.
+// - excluded files are skipped, excluded directories are not descended
+// - if include is not empty, only files matching any include pattern are added,
+//   and only directories that match an include pattern or contain such files
+struct tree_filter
+{
+    std::vector<std::string> include;
+    std::vector<std::string> exclude;
+};
+
+}
+
+#endif
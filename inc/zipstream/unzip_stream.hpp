@@ -0,0 +1,65 @@
+#ifndef ZIPSTREAM_UNZIP_STREAM_HPP
+#define ZIPSTREAM_UNZIP_STREAM_HPP
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+
+namespace zipstream
+{
+
+constexpr size_t const default_unzip_buffer_size = 64 * 1024;
+
+// local file header of an entry read by unzip_stream
+// sizes and CRC are zero if the entry uses a data descriptor
+struct unzip_entry
+{
+    std::string name;
+    uint16_t flags;
+    uint16_t compression_method;
+    uint32_t crc32;
+    uint64_t compressed_size;
+    uint64_t size;
+};
+
+// Forward-only reader of zip archives fed in chunks, e.g. from a socket.
+// Entries are decoded from their local headers; stored, deflated and
+// zstd data (if libzstd is available at runtime) is returned
+// incrementally and its CRC is validated on the fly. Entries
+// with a data descriptor (flag bit 3) end where the descriptor is found.
+// Input is buffered up to buffer_size bytes (more only to hold a single
+// local header). Invalid or truncated archives throw std::runtime_error.
+class unzip_stream
+{
+    unzip_stream(unzip_stream const &) = delete;
+    unzip_stream& operator=(unzip_stream const &) = delete;
+public:
+    explicit unzip_stream(size_t buffer_size = default_unzip_buffer_size);
+    ~unzip_stream();
+    unzip_stream(unzip_stream && other);
+    unzip_stream& operator=(unzip_stream && other);
+
+    // appends input; returns the number of bytes accepted
+    size_t feed(char const * data, size_t size);
+    // marks the end of input
+    void finish();
+
+    // skips the rest of the current entry and reads the next local header;
+    // returns false if more input is needed or the archive ended
+    bool next_entry(unzip_entry & entry);
+
+    // returns data of the current entry; 0 if more input is needed or the
+    // entry ended
+    size_t read(char * buffer, size_t buffer_size);
+
+    bool need_input() const;
+    bool done() const;
+
+private:
+    class detail;
+    detail *d;
+};
+
+}
+
+#endif
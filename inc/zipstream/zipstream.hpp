@@ -2,6 +2,20 @@
 #define ZIPSTREAM_ZIPSTREAM_HPP
 
 #include <zipstream/stream_i.hpp>
+#include <zipstream/range_source_i.hpp>
 #include <zipstream/builder.hpp>
+#include <zipstream/compression.hpp>
+#include <zipstream/content_cache.hpp>
+#include <zipstream/entry_order.hpp>
+#include <zipstream/live_builder.hpp>
+#include <zipstream/reader.hpp>
+#include <zipstream/unzip_stream.hpp>
+#include <zipstream/pipeline.hpp>
+#include <zipstream/sink_i.hpp>
+#include <zipstream/executor.hpp>
+#include <zipstream/memory.hpp>
+#include <zipstream/descriptors.hpp>
+#include <zipstream/tree_filter.hpp>
+#include <zipstream/entry_generator.hpp>
 
 #endif
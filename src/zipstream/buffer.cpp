@@ -48,7 +48,13 @@ void buffer::write_u32(uint32_t value)
     }
 }
 
-void buffer::write_str(std::string const & value)
+void buffer::write_u64(uint64_t value)
+{
+    write_u32(static_cast<uint32_t>(value & 0xffffffff));
+    write_u32(static_cast<uint32_t>(value >> 32));
+}
+
+void buffer::write_str(std::string_view value)
 {
     if (value.size() == 0) { return; }
 
@@ -62,16 +68,54 @@ void buffer::write_str(std::string const & value)
     write_pos += value.size();
 }
 
+void buffer::write_zeros(size_t count)
+{
+    if ((cap - write_pos) < count)
+    {
+        throw std::runtime_error("buffer too small");
+    }
+
+    memset(&data[write_pos], 0, count);
+    write_pos += count;
+}
+
 size_t buffer::write_position() const
 {
     return write_pos;
 }
 
+size_t buffer::capacity() const
+{
+    return cap;
+}
+
+void buffer::reserve(size_t capacity)
+{
+    if (capacity <= cap)
+    {
+        return;
+    }
+
+    uint8_t * const target = new uint8_t[capacity];
+    memcpy(target, &data[read_pos], write_pos - read_pos);
+    delete[] data;
+
+    data = target;
+    cap = capacity;
+    write_pos -= read_pos;
+    read_pos = 0;
+}
+
 bool buffer::empty() const
 {
     return (read_pos == write_pos);
 }
 
+size_t buffer::size() const
+{
+    return write_pos - read_pos;
+}
+
 size_t buffer::read(char * buffer, size_t size)
 {
     size_t const available = write_pos - read_pos;
@@ -91,6 +135,16 @@ size_t buffer::read(char * buffer, size_t size)
     return count;
 }
 
+void buffer::skip(size_t count)
+{
+    read_pos += std::min(count, write_pos - read_pos);
+
+    if (read_pos == write_pos)
+    {
+        reset();
+    }
+}
+
 void buffer::reset() {
     read_pos = 0;
     write_pos = 0;
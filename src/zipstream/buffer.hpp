@@ -3,7 +3,7 @@
 
 #include <cinttypes>
 #include <cstddef>
-#include <string>
+#include <string_view>
 
 namespace zipstream
 {
@@ -21,11 +21,17 @@ public:
 
     void write_u16(uint16_t value);
     void write_u32(uint32_t value);
-    void write_str(std::string const & value);
+    void write_u64(uint64_t value);
+    void write_str(std::string_view value);
+    void write_zeros(size_t count);
     size_t write_position() const;
+    size_t capacity() const;
+    void reserve(size_t capacity);
 
     bool empty() const;
+    size_t size() const;
     size_t read(char * buffer, size_t size);
+    void skip(size_t count);
     
     void reset();
 
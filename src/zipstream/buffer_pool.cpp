@@ -0,0 +1,183 @@
+#include "zipstream/buffer_pool.hpp"
+#include "zipstream/memory.hpp"
+
+#include <algorithm>
+#include <new>
+
+namespace zipstream
+{
+
+pooled_buffer::pooled_buffer(buffer_pool & pool, char * data, size_t size, size_t & account)
+: m_pool(&pool)
+, m_data(data)
+, m_size(size)
+, m_account(&account)
+{
+
+}
+
+pooled_buffer::~pooled_buffer()
+{
+    if (m_data != nullptr)
+    {
+        *m_account -= m_size;
+        m_pool->release(m_data, m_size);
+    }
+}
+
+pooled_buffer::pooled_buffer(pooled_buffer && other)
+: m_pool(other.m_pool)
+, m_data(other.m_data)
+, m_size(other.m_size)
+, m_account(other.m_account)
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+char * pooled_buffer::data() const
+{
+    return m_data;
+}
+
+size_t pooled_buffer::size() const
+{
+    return m_size;
+}
+
+buffer_pool & buffer_pool::instance()
+{
+    static buffer_pool pool(default_global_limit, default_stream_limit);
+    return pool;
+}
+
+buffer_pool::buffer_pool(size_t global_limit, size_t stream_limit)
+: m_global_limit(global_limit)
+, m_stream_limit(stream_limit)
+, m_usage(0)
+, m_cached(0)
+{
+
+}
+
+buffer_pool::~buffer_pool()
+{
+    for(auto & buffers: m_free)
+    {
+        for(char * data: buffers)
+        {
+            deallocate(data);
+        }
+    }
+}
+
+void buffer_pool::set_limits(size_t global_limit, size_t stream_limit)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_global_limit = global_limit;
+    m_stream_limit = stream_limit;
+    trim(0);
+}
+
+size_t buffer_pool::usage() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_usage;
+}
+
+pooled_buffer buffer_pool::acquire(size_t size, size_t & account)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // cached buffers do not count against the limits, they can be freed on demand
+    size_t const in_use = m_usage - m_cached;
+    size_t const stream_room = (m_stream_limit > account) ? (m_stream_limit - account) : 0;
+    size_t const global_room = (m_global_limit > in_use) ? (m_global_limit - in_use) : 0;
+    size_t const granted_size = std::min({size, max_buffer_size, stream_room, global_room});
+
+    size_t const index = class_of(granted_size);
+    size_t const class_size = min_buffer_size << index;
+
+    char * data = nullptr;
+    if (!m_free[index].empty())
+    {
+        data = m_free[index].back();
+        m_free[index].pop_back();
+        m_cached -= class_size;
+    }
+    else
+    {
+        trim(class_size);
+        data = allocate(class_size);
+        m_usage += class_size;
+    }
+
+    account += class_size;
+    return pooled_buffer(*this, data, class_size, account);
+}
+
+void buffer_pool::release(char * data, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto & buffers = m_free[class_of(size)];
+    if ((m_usage > m_global_limit) || (((buffers.size() + 1) * size) > max_idle_size))
+    {
+        deallocate(data);
+        m_usage -= size;
+    }
+    else
+    {
+        buffers.push_back(data);
+        m_cached += size;
+    }
+}
+
+size_t buffer_pool::class_of(size_t size)
+{
+    size_t index = 0;
+    while (((index + 1) < class_count) && ((min_buffer_size << (index + 1)) <= size))
+    {
+        index++;
+    }
+
+    return index;
+}
+
+char * buffer_pool::allocate(size_t size)
+{
+    return static_cast<char *>(::operator new[](size, std::align_val_t(buffer_alignment)));
+}
+
+void buffer_pool::deallocate(char * data)
+{
+    ::operator delete[](data, std::align_val_t(buffer_alignment));
+}
+
+// frees cached buffers until needed bytes can be allocated within the global limit
+void buffer_pool::trim(size_t needed)
+{
+    for(size_t index = 0; index < class_count; index++)
+    {
+        auto & buffers = m_free[index];
+        while ((!buffers.empty()) && ((m_usage + needed) > m_global_limit))
+        {
+            deallocate(buffers.back());
+            buffers.pop_back();
+            m_usage -= min_buffer_size << index;
+            m_cached -= min_buffer_size << index;
+        }
+    }
+}
+
+void set_memory_limits(size_t global_limit, size_t stream_limit)
+{
+    buffer_pool::instance().set_limits(global_limit, stream_limit);
+}
+
+size_t get_pooled_memory()
+{
+    return buffer_pool::instance().usage();
+}
+
+}
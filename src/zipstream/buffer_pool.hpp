@@ -0,0 +1,81 @@
+#ifndef ZIPSTREAM_BUFFER_POOL_HPP
+#define ZIPSTREAM_BUFFER_POOL_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace zipstream
+{
+
+class buffer_pool;
+
+// Scratch buffer borrowed from a buffer_pool; returned on destruction.
+class pooled_buffer
+{
+    pooled_buffer(pooled_buffer const &) = delete;
+    pooled_buffer& operator=(pooled_buffer const &) = delete;
+public:
+    pooled_buffer(buffer_pool & pool, char * data, size_t size, size_t & account);
+    ~pooled_buffer();
+    pooled_buffer(pooled_buffer && other);
+    pooled_buffer& operator=(pooled_buffer && other) = delete;
+
+    char * data() const;
+    size_t size() const;
+
+private:
+    buffer_pool * m_pool;
+    char * m_data;
+    size_t m_size;
+    size_t * m_account;
+};
+
+// Thread-safe pool of scratch and I/O buffers shared by all streams.
+// Buffers are handed out in power of two size classes and are page
+// aligned, so that they can be used for direct I/O. A request is
+// shrunk to fit into the per-stream and the global limit, but never
+// below min_buffer_size, so that a stream can always make progress.
+// Released buffers are kept for reuse up to max_idle_size per size class.
+class buffer_pool
+{
+    buffer_pool(buffer_pool const &) = delete;
+    buffer_pool& operator=(buffer_pool const &) = delete;
+public:
+    static constexpr size_t const min_buffer_size = 4 * 1024;
+    static constexpr size_t const buffer_alignment = 4 * 1024;
+    static constexpr size_t const max_buffer_size = 1024 * 1024;
+    static constexpr size_t const default_global_limit = 256 * 1024 * 1024;
+    static constexpr size_t const default_stream_limit = 1024 * 1024;
+    static constexpr size_t const max_idle_size = 4 * 1024 * 1024;
+
+    static buffer_pool & instance();
+
+    buffer_pool(size_t global_limit, size_t stream_limit);
+    ~buffer_pool();
+
+    void set_limits(size_t global_limit, size_t stream_limit);
+    size_t usage() const;
+
+    // account is the number of pooled bytes currently used by the stream
+    pooled_buffer acquire(size_t size, size_t & account);
+    void release(char * data, size_t size);
+
+private:
+    static constexpr size_t const class_count = 9;
+    static size_t class_of(size_t size);
+    static char * allocate(size_t size);
+    static void deallocate(char * data);
+    void trim(size_t needed);
+
+    mutable std::mutex m_mutex;
+    size_t m_global_limit;
+    size_t m_stream_limit;
+    size_t m_usage;
+    size_t m_cached;
+    std::vector<char*> m_free[class_count];
+};
+
+}
+
+#endif
@@ -1,21 +1,143 @@
 #include "zipstream/builder.hpp"
-#include "zipstream/entry.hpp"
+#include "zipstream/entry_table.hpp"
 #include "zipstream/stream.hpp"
+#include "zipstream/range_source.hpp"
+#include "zipstream/tree_walker.hpp"
+#include "zipstream/buffer_pool.hpp"
+#include "zipstream/reader.hpp"
+#include "zipstream/compressor.hpp"
+#include "zipstream/entry_sorter.hpp"
+#include "zipstream/fd_writer.hpp"
 
-#include "zipstream/entries/dir_entry.hpp"
-#include "zipstream/entries/static_file_entry.hpp"
-#include "zipstream/entries/file_entry.hpp"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#include <vector>
-#include <filesystem>
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
 
 namespace zipstream
 {
 
+// the extra field of a local header holds at most 64 KiB of padding
+constexpr size_t const max_alignment = 64 * 1024;
+
+namespace
+{
+
+// copies the first size bytes of source to target; copy_file_range lets
+// file systems with reflinks share the data instead of copying it
+void copy_prefix(int source, int target, size_t size)
+{
+    loff_t offset = 0;
+    while (static_cast<size_t>(offset) < size)
+    {
+        ssize_t const count = copy_file_range(source, &offset, target, nullptr, size - offset, 0);
+        if (count > 0)
+        {
+            continue;
+        }
+        if ((count < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        if ((count == 0) || ((errno != EXDEV) && (errno != ENOSYS) && (errno != EINVAL) && (errno != EOPNOTSUPP)))
+        {
+            throw std::runtime_error("failed to append to archive");
+        }
+        break;
+    }
+
+    size_t pooled = 0;
+    auto buffer = buffer_pool::instance().acquire(buffer_pool::max_buffer_size, pooled);
+    while (static_cast<size_t>(offset) < size)
+    {
+        ssize_t const count = pread(source, buffer.data(), std::min(buffer.size(), size - offset), offset);
+        if ((count < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            throw std::runtime_error("failed to append to archive");
+        }
+        write_all(target, buffer.data(), static_cast<size_t>(count));
+        offset += count;
+    }
+}
+
+}
+
 class builder::detail
 {
 public:
-    std::vector<entry> entries;
+    entry_table entries;
+    size_t alignment = 0;
+    std::optional<std::pair<int, int>> level_range;
+    std::shared_ptr<content_cache> cache;
+    entry_order order = entry_order::insertion;
+    bool keep_toc_order = false;
+    std::map<std::string, std::pair<uint32_t, std::shared_ptr<reader const>>> sources;
+
+    // source archives are opened once and shared by their entries
+    std::pair<uint32_t, std::shared_ptr<reader const>> const & source(std::string const & archive)
+    {
+        auto it = sources.find(archive);
+        if (it == sources.end())
+        {
+            auto source = std::make_shared<reader const>(archive);
+            uint32_t const id = entries.add_source(source);
+            it = sources.emplace(archive, std::make_pair(id, std::move(source))).first;
+        }
+
+        return it->second;
+    }
+
+    // sorts the data of the entries; the central directory lists them in
+    // the original order if it is kept, otherwise by name, so that it does
+    // not depend on where the files happen to be on disk
+    std::shared_ptr<std::vector<uint32_t> const> sort()
+    {
+        if (order == entry_order::insertion)
+        {
+            return nullptr;
+        }
+
+        auto const sorted = sort_entries(entries, order);
+        entries.reorder(sorted);
+
+        auto toc_order = std::make_shared<std::vector<uint32_t>>(sorted.size());
+        if (keep_toc_order)
+        {
+            for(size_t index = 0; index < sorted.size(); index++)
+            {
+                (*toc_order)[sorted[index]] = static_cast<uint32_t>(index);
+            }
+        }
+        else
+        {
+            std::iota(toc_order->begin(), toc_order->end(), 0);
+            std::stable_sort(toc_order->begin(), toc_order->end(), [this](uint32_t a, uint32_t b) {
+                return entries.name(a) < entries.name(b);
+            });
+        }
+        return toc_order;
+    }
+
+    // applies the stream settings of the builder
+    void configure(stream & result) const
+    {
+        if (level_range)
+        {
+            result.set_level_range(level_range->first, level_range->second);
+        }
+        result.set_content_cache(cache);
+    }
 };
 
 
@@ -52,36 +174,253 @@ builder& builder::operator=(builder && other)
 
 builder& builder::add_directory(std::string const & name)
 {
-    entry e;
-    e.inner_entry = std::make_unique<dir_entry>(name);
-    d->entries.emplace_back(std::move(e));
+    d->entries.add_directory(name);
 
     return *this;
 }
 
 builder& builder::add_file_with_content(std::string const & name, std::string const & content)
 {
-    entry e;
-    e.inner_entry = std::make_unique<static_file_entry>(name, content);
-    d->entries.emplace_back(std::move(e));
+    d->entries.add_file_with_content(name, content);
 
     return *this;
 }
 
 builder& builder::add_file_from_path(std::string const & name, std::string const & path)
 {
-    entry e;
-    e.inner_entry = std::make_unique<file_entry>(name, path);
-    d->entries.emplace_back(std::move(e));
+    d->entries.add_file_from_path(name, path);
+
+    return *this;
+}
+
+builder& builder::add_tree(std::string const & root, std::string const & prefix, tree_filter const & filter)
+{
+    std::string const base = ((prefix.empty()) || (prefix.back() == '/')) ? prefix : prefix + '/';
+
+    tree_walker walker(root, filter);
+    for(auto const & item: walker.walk())
+    {
+        if (item.is_directory)
+        {
+            d->entries.add_directory(base + item.name);
+        }
+        else
+        {
+            // no zip64 support
+            if (item.size > std::numeric_limits<uint32_t>::max())
+            {
+                throw std::runtime_error("file too large: " + item.path);
+            }
+            d->entries.add_file_from_path(base + item.name, item.path, item.size);
+        }
+    }
+
+    return *this;
+}
+
+builder& builder::add_file_from_archive(std::string const & name, std::string const & archive, std::string const & entry_name)
+{
+    auto const & source = d->source(archive);
+    auto const index = source.second->find(entry_name);
+    if (!index.has_value())
+    {
+        throw std::runtime_error("entry not found: " + entry_name);
+    }
+
+    d->entries.add_raw_copy(name, source.first, index.value());
+    return *this;
+}
+
+builder& builder::add_archive(std::string const & archive, std::string const & prefix)
+{
+    std::string const base = ((prefix.empty()) || (prefix.back() == '/')) ? prefix : prefix + '/';
+    auto const & source = d->source(archive);
+    auto const & entries = *source.second;
+
+    for(size_t index = 0; index < entries.count(); index++)
+    {
+        auto const name = base + std::string(entries.name(index));
+        if ((name.back() == '/') && (entries.entry(index).uncompressed_size == 0))
+        {
+            d->entries.add_directory(name);
+        }
+        else
+        {
+            d->entries.add_raw_copy(name, source.first, index);
+        }
+    }
+
+    return *this;
+}
+
+builder& builder::set_alignment(size_t alignment)
+{
+    if ((alignment > max_alignment) || ((alignment & (alignment - 1)) != 0))
+    {
+        throw std::runtime_error("invalid alignment");
+    }
+
+    d->alignment = alignment;
+
+    return *this;
+}
+
+// applies to files added afterwards, so that it can be selected per entry
+builder& builder::set_compression(compression backend, int level)
+{
+    if (!compression_available(backend))
+    {
+        throw std::runtime_error("compression not available");
+    }
+
+    d->entries.set_compression(backend, level);
+
+    return *this;
+}
+
+builder& builder::set_compression_policy(compression_policy const & policy)
+{
+    for(auto const & extension: policy.extensions)
+    {
+        if (!compression_available(extension.second))
+        {
+            throw std::runtime_error("compression not available");
+        }
+    }
+
+    d->entries.set_policy(policy);
+
+    return *this;
+}
+
+// the level follows the consumer of the stream: slow consumers get
+// stronger compression, fast ones get faster compression
+builder& builder::set_adaptive_level(int min_level, int max_level)
+{
+    if ((min_level < 0) || (min_level > max_level) || (!is_valid_level(d->entries.compression(), max_level)))
+    {
+        throw std::runtime_error("invalid compression level range");
+    }
+
+    d->level_range = std::make_pair(min_level, max_level);
+
+    return *this;
+}
+
+// compressed files are looked up in the cache first; compressed files
+// are required to be cached for range sources, whose layout needs their
+// compressed sizes up front
+builder& builder::set_content_cache(std::shared_ptr<content_cache> cache)
+{
+    d->cache = std::move(cache);
+
+    return *this;
+}
+
+// Sorting files by their location on disk avoids seeks while reading
+// them. The central directory lists the entries by name, or in insertion
+// order if keep_toc_order is set. Generated entries and appended entries
+// are not sorted.
+builder& builder::set_entry_order(entry_order order, bool keep_toc_order)
+{
+    d->order = order;
+    d->keep_toc_order = keep_toc_order;
 
     return *this;
 }
 
 std::unique_ptr<stream_i> builder::build()
 {
-    return std::unique_ptr<stream_i>(new stream(std::move(d->entries)));
+    d->sources.clear();
+    d->entries.shrink_to_fit();
+    auto toc_order = d->sort();
+    auto result = std::make_unique<stream>(std::move(d->entries), d->alignment);
+    d->configure(*result);
+    result->set_toc_order(std::move(toc_order));
+    return result;
+}
+
+std::unique_ptr<stream_i> builder::build(entry_generator generator)
+{
+    d->sources.clear();
+    auto result = std::make_unique<stream>(std::move(d->entries), std::move(generator), d->alignment);
+    d->configure(*result);
+    return result;
+}
+
+std::unique_ptr<range_source_i> builder::build_ranges()
+{
+    d->sources.clear();
+    d->entries.shrink_to_fit();
+    auto toc_order = d->sort();
+    return std::unique_ptr<range_source_i>(new range_source(std::move(d->entries), d->alignment, 0, d->cache,
+        std::move(toc_order)));
 }
 
+// The archive is rebuilt next to the existing one and renamed over it
+// once complete, so that the archive stays readable if appending fails
+// or is interrupted: existing local headers and data are copied, the new
+// entries follow where the old central directory started, then a merged
+// central directory.
+void builder::append_to_file(std::string const & path)
+{
+    archive_prefix prefix;
+    {
+        reader existing(path);
+        prefix.toc_start = existing.toc_offset();
+        prefix.toc = std::string(existing.toc());
+        prefix.entry_count = existing.count();
+        prefix.comment = std::string(existing.comment());
+    }
+
+    size_t const toc_start = prefix.toc_start;
+    d->sources.clear();
+    d->entries.shrink_to_fit();
+    stream tail(std::move(d->entries), std::move(prefix), d->alignment);
+    d->configure(tail);
+
+    int const source = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if ((source < 0) || (0 != fstat(source, &info)))
+    {
+        if (source >= 0)
+        {
+            close(source);
+        }
+        throw std::runtime_error("failed to append to archive");
+    }
+
+    std::string staged_path = path + ".XXXXXX";
+    int const staged = mkostemp(&staged_path[0], O_CLOEXEC);
+    if (staged < 0)
+    {
+        close(source);
+        throw std::runtime_error("failed to append to archive");
+    }
+
+    try
+    {
+        copy_prefix(source, staged, toc_start);
+        tail.write_to_fd(staged);
+        if ((0 != fchmod(staged, info.st_mode & 07777)) || (0 != fsync(staged)))
+        {
+            throw std::runtime_error("failed to append to archive");
+        }
+    }
+    catch (...)
+    {
+        close(source);
+        close(staged);
+        unlink(staged_path.c_str());
+        throw;
+    }
 
+    close(source);
+    if ((0 != close(staged)) || (0 != rename(staged_path.c_str(), path.c_str())))
+    {
+        unlink(staged_path.c_str());
+        throw std::runtime_error("failed to append to archive");
+    }
+}
 
-}
\ No newline at end of file
+}
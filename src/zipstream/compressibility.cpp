@@ -0,0 +1,94 @@
+#include "zipstream/compressibility.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace zipstream
+{
+
+namespace
+{
+
+struct signature
+{
+    size_t offset;
+    char const * bytes;
+    size_t size;
+};
+
+// formats whose payload is compressed; deflating them saves next to nothing
+constexpr signature const compressed_signatures[] = {
+    {0, "\xff\xd8\xff", 3},                     // JPEG
+    {0, "\x89PNG", 4},                          // PNG
+    {0, "GIF8", 4},                             // GIF
+    {8, "WEBP", 4},                             // WebP (RIFF container)
+    {4, "ftyp", 4},                             // MP4, MOV, HEIC
+    {0, "\x1a\x45\xdf\xa3", 4},                 // Matroska, WebM
+    {0, "OggS", 4},                             // Ogg
+    {0, "ID3", 3},                              // MP3
+    {0, "fLaC", 4},                             // FLAC
+    {0, "PK\x03\x04", 4},                       // zip, jar, docx, apk
+    {0, "\x1f\x8b", 2},                         // gzip
+    {0, "BZh", 3},                              // bzip2
+    {0, "\xfd" "7zXZ", 5},                      // xz
+    {0, "\x28\xb5\x2f\xfd", 4},                 // zstd
+    {0, "7z\xbc\xaf\x27\x1c", 6},               // 7-Zip
+    {0, "Rar!\x1a\x07", 6},                     // RAR
+    {0, "\x04\x22\x4d\x18", 4},                 // LZ4
+    {0, "wOF2", 4}                              // WOFF2
+};
+
+}
+
+bool has_compressed_signature(char const * data, size_t size)
+{
+    for(auto const & signature: compressed_signatures)
+    {
+        if (((signature.offset + signature.size) <= size)
+            && (0 == memcmp(&data[signature.offset], signature.bytes, signature.size)))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+double byte_entropy(char const * data, size_t size)
+{
+    if (size == 0)
+    {
+        return 0.0;
+    }
+
+    size_t counts[256] = {};
+    for(size_t i = 0; i < size; i++)
+    {
+        counts[static_cast<unsigned char>(data[i])]++;
+    }
+
+    double entropy = 0.0;
+    for(size_t count: counts)
+    {
+        if (count > 0)
+        {
+            double const p = static_cast<double>(count) / static_cast<double>(size);
+            entropy -= p * std::log2(p);
+        }
+    }
+
+    return entropy;
+}
+
+compressibility estimate_compressibility(char const * data, size_t size, double min_savings)
+{
+    if ((size == 0) || (has_compressed_signature(data, size)))
+    {
+        return compressibility::store;
+    }
+
+    double const savings = 1.0 - (byte_entropy(data, size) / 8.0);
+    return (savings >= min_savings) ? compressibility::compress : compressibility::unknown;
+}
+
+}
@@ -0,0 +1,30 @@
+#ifndef ZIPSTREAM_COMPRESSIBILITY_HPP
+#define ZIPSTREAM_COMPRESSIBILITY_HPP
+
+#include <cstddef>
+
+namespace zipstream
+{
+
+enum class compressibility
+{
+    compress,
+    store,
+    unknown
+};
+
+// true if data starts with the signature of an already compressed format
+bool has_compressed_signature(char const * data, size_t size);
+
+// order-0 entropy of data in bits per byte
+double byte_entropy(char const * data, size_t size);
+
+// Estimates whether compressing data saves at least min_savings of its
+// size. Huffman coding alone reaches the order-0 entropy, so a low
+// entropy is conclusive; a high one is not, since repetitions are not
+// taken into account.
+compressibility estimate_compressibility(char const * data, size_t size, double min_savings);
+
+}
+
+#endif
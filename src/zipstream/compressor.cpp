@@ -0,0 +1,795 @@
+#include "zipstream/compressor.hpp"
+
+#include <zlib.h>
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace zipstream
+{
+
+namespace
+{
+
+constexpr uint16_t const method_store = 0;
+constexpr uint16_t const method_deflate = 8;
+constexpr uint16_t const method_zstd = 93;
+
+constexpr int const libdeflate_default_level = 6;
+constexpr int const libdeflate_max_level = 12;
+constexpr int const zstd_default_level = 3;
+constexpr int const zstd_max_level = 22;
+
+// zlib counts in unsigned int
+constexpr size_t const max_zlib_chunk = 0x7fffffff;
+
+// runs of zeros are spliced into deflate streams in units of this size
+constexpr size_t const zero_run_size = 1024 * 1024;
+constexpr size_t const deflate_window_size = 32 * 1024;
+
+// Optional libraries are bound at runtime, so that neither their
+// headers nor their libraries are needed to build zipstream.
+void * open_library(char const * const * names)
+{
+    for(; *names != nullptr; names++)
+    {
+        void * handle = dlopen(*names, RTLD_NOW | RTLD_LOCAL);
+        if (handle != nullptr)
+        {
+            return handle;
+        }
+    }
+
+    return nullptr;
+}
+
+// Deflate data of zero_run_size zeros, made of non-final blocks that
+// start and end on byte boundaries and refer to no earlier data, so it
+// can be spliced into any raw deflate stream after a sync flush.
+std::string const & zero_run_blocks()
+{
+    static std::string const blocks = []() {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (Z_OK != deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY))
+        {
+            throw std::runtime_error("failed to initialize deflate");
+        }
+
+        std::string const zeros(zero_run_size, '\0');
+        std::string output(deflateBound(&stream, zeros.size()) + 16, '\0');
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(zeros.data()));
+        stream.avail_in = static_cast<uInt>(zeros.size());
+        stream.next_out = reinterpret_cast<Bytef *>(&output[0]);
+        stream.avail_out = static_cast<uInt>(output.size());
+        int const rc = deflate(&stream, Z_SYNC_FLUSH);
+        output.resize(output.size() - stream.avail_out);
+        deflateEnd(&stream);
+        if ((rc != Z_OK) || (stream.avail_in != 0))
+        {
+            throw std::runtime_error("failed to deflate");
+        }
+
+        return output;
+    }();
+
+    return blocks;
+}
+
+template <typename Function>
+bool bind(void * handle, char const * name, Function & function)
+{
+    function = reinterpret_cast<Function>(dlsym(handle, name));
+    return (function != nullptr);
+}
+
+struct libdeflate_compressor;
+
+class libdeflate_api
+{
+public:
+    static libdeflate_api const & instance()
+    {
+        static libdeflate_api const api;
+        return api;
+    }
+
+    bool available;
+    libdeflate_compressor * (*alloc_compressor)(int level);
+    size_t (*deflate_compress)(libdeflate_compressor * compressor, void const * input, size_t input_size,
+        void * output, size_t output_size);
+    size_t (*deflate_compress_bound)(libdeflate_compressor * compressor, size_t input_size);
+    void (*free_compressor)(libdeflate_compressor * compressor);
+
+private:
+    libdeflate_api()
+    {
+        char const * const names[] = {"libdeflate.so.0", "libdeflate.so", nullptr};
+        void * handle = open_library(names);
+        available = (handle != nullptr)
+            && bind(handle, "libdeflate_alloc_compressor", alloc_compressor)
+            && bind(handle, "libdeflate_deflate_compress", deflate_compress)
+            && bind(handle, "libdeflate_deflate_compress_bound", deflate_compress_bound)
+            && bind(handle, "libdeflate_free_compressor", free_compressor);
+    }
+};
+
+struct zstd_context;
+struct zstd_dcontext;
+
+// mirrors ZSTD_inBuffer and ZSTD_outBuffer
+struct zstd_input
+{
+    void const * data;
+    size_t size;
+    size_t pos;
+};
+
+struct zstd_output
+{
+    void * data;
+    size_t size;
+    size_t pos;
+};
+
+class zstd_api
+{
+public:
+    // values of ZSTD_cParameter, ZSTD_ResetDirective and ZSTD_EndDirective
+    static constexpr int const compression_level = 100;
+    static constexpr int const reset_session = 1;
+    static constexpr int const end_continue = 0;
+    static constexpr int const end_finish = 2;
+
+    static zstd_api const & instance()
+    {
+        static zstd_api const api;
+        return api;
+    }
+
+    bool available;
+    zstd_context * (*create_context)();
+    size_t (*free_context)(zstd_context * context);
+    size_t (*set_parameter)(zstd_context * context, int parameter, int value);
+    size_t (*reset_context)(zstd_context * context, int directive);
+    size_t (*compress_stream)(zstd_context * context, zstd_output * output, zstd_input * input, int end);
+    size_t (*compress_bound)(size_t input_size);
+    size_t (*decompress)(void * output, size_t output_size, void const * input, size_t input_size);
+    zstd_dcontext * (*create_dcontext)();
+    size_t (*free_dcontext)(zstd_dcontext * context);
+    size_t (*reset_dcontext)(zstd_dcontext * context, int directive);
+    size_t (*decompress_stream)(zstd_dcontext * context, zstd_output * output, zstd_input * input);
+    unsigned (*is_error)(size_t code);
+
+private:
+    zstd_api()
+    {
+        char const * const names[] = {"libzstd.so.1", "libzstd.so", nullptr};
+        void * handle = open_library(names);
+        available = (handle != nullptr)
+            && bind(handle, "ZSTD_createCCtx", create_context)
+            && bind(handle, "ZSTD_freeCCtx", free_context)
+            && bind(handle, "ZSTD_CCtx_setParameter", set_parameter)
+            && bind(handle, "ZSTD_CCtx_reset", reset_context)
+            && bind(handle, "ZSTD_compressStream2", compress_stream)
+            && bind(handle, "ZSTD_compressBound", compress_bound)
+            && bind(handle, "ZSTD_decompress", decompress)
+            && bind(handle, "ZSTD_createDCtx", create_dcontext)
+            && bind(handle, "ZSTD_freeDCtx", free_dcontext)
+            && bind(handle, "ZSTD_DCtx_reset", reset_dcontext)
+            && bind(handle, "ZSTD_decompressStream", decompress_stream)
+            && bind(handle, "ZSTD_isError", is_error);
+    }
+};
+
+class zlib_compressor: public compressor_i
+{
+public:
+    explicit zlib_compressor(int level)
+    : m_level(level)
+    , m_pending_level(level)
+    , m_zero_runs(0)
+    , m_zero_pos(0)
+    , m_flushed(false)
+    {
+        memset(&m_stream, 0, sizeof(m_stream));
+        if (Z_OK != deflateInit2(&m_stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY))
+        {
+            throw std::runtime_error("failed to initialize deflate");
+        }
+    }
+
+    ~zlib_compressor() override
+    {
+        deflateEnd(&m_stream);
+    }
+
+    uint16_t method() const override
+    {
+        return method_deflate;
+    }
+
+    void reset() override
+    {
+        deflateReset(&m_stream);
+        m_zero_runs = 0;
+        m_zero_pos = 0;
+        m_flushed = false;
+        if (m_pending_level != m_level)
+        {
+            // no output is pending after a reset
+            deflateParams(&m_stream, m_pending_level, Z_DEFAULT_STRATEGY);
+            m_level = m_pending_level;
+        }
+    }
+
+    void set_level(int level) override
+    {
+        m_pending_level = std::clamp(level, 0, Z_BEST_COMPRESSION);
+    }
+
+    bool compress(char const * & input, size_t & input_size, char * & output, size_t & output_size,
+        bool finish) override
+    {
+        if ((m_zero_runs > 0) && (!write_zero_runs(output, output_size)))
+        {
+            return false;
+        }
+
+        size_t const input_chunk = std::min(input_size, max_zlib_chunk);
+        size_t const output_chunk = std::min(output_size, max_zlib_chunk);
+        bool const last_chunk = finish && (input_chunk == input_size);
+
+        m_stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input));
+        m_stream.avail_in = static_cast<uInt>(input_chunk);
+        m_stream.next_out = reinterpret_cast<Bytef *>(output);
+        m_stream.avail_out = static_cast<uInt>(output_chunk);
+
+        if ((m_pending_level != m_level) && (Z_OK == deflateParams(&m_stream, m_pending_level, Z_DEFAULT_STRATEGY)))
+        {
+            // the data so far is flushed as a block of the old level; on
+            // Z_BUF_ERROR the output was too small and the change is retried
+            m_level = m_pending_level;
+        }
+
+        int const rc = deflate(&m_stream, (last_chunk) ? Z_FINISH : Z_NO_FLUSH);
+        if ((rc != Z_OK) && (rc != Z_STREAM_END) && (rc != Z_BUF_ERROR))
+        {
+            throw std::runtime_error("failed to deflate");
+        }
+
+        size_t const consumed = input_chunk - m_stream.avail_in;
+        size_t const produced = output_chunk - m_stream.avail_out;
+        input += consumed;
+        input_size -= consumed;
+        output += produced;
+        output_size -= produced;
+
+        return (rc == Z_STREAM_END);
+    }
+
+    // runs are written by the next calls of compress()
+    size_t add_zeros(size_t count) override
+    {
+        size_t const runs = count / zero_run_size;
+        m_zero_runs += runs;
+        return runs * zero_run_size;
+    }
+
+    size_t bound(size_t input_size) override
+    {
+        return deflateBound(&m_stream, input_size);
+    }
+
+    size_t compress_all(char const * input, size_t input_size, char * output, size_t output_size) override
+    {
+        reset();
+        size_t const capacity = output_size;
+        bool const done = compress(input, input_size, output, output_size, true);
+        reset();
+
+        return (done) ? capacity - output_size : 0;
+    }
+
+private:
+    // flushes pending data to a byte boundary and copies the precompressed
+    // runs; returns false while the output is too small
+    bool write_zero_runs(char * & output, size_t & output_size)
+    {
+        if (!m_flushed)
+        {
+            size_t const output_chunk = std::min(output_size, max_zlib_chunk);
+            m_stream.next_in = nullptr;
+            m_stream.avail_in = 0;
+            m_stream.next_out = reinterpret_cast<Bytef *>(output);
+            m_stream.avail_out = static_cast<uInt>(output_chunk);
+            int const rc = deflate(&m_stream, Z_SYNC_FLUSH);
+            if ((rc != Z_OK) && (rc != Z_BUF_ERROR))
+            {
+                throw std::runtime_error("failed to deflate");
+            }
+
+            size_t const produced = output_chunk - m_stream.avail_out;
+            output += produced;
+            output_size -= produced;
+            if (m_stream.avail_out == 0)
+            {
+                // more output may be pending
+                return false;
+            }
+            m_flushed = true;
+        }
+
+        auto const & blocks = zero_run_blocks();
+        while ((m_zero_runs > 0) && (output_size > 0))
+        {
+            size_t const count = std::min(output_size, blocks.size() - m_zero_pos);
+            memcpy(output, &blocks[m_zero_pos], count);
+            output += count;
+            output_size -= count;
+            m_zero_pos += count;
+            if (m_zero_pos == blocks.size())
+            {
+                m_zero_pos = 0;
+                m_zero_runs--;
+            }
+        }
+
+        if (m_zero_runs > 0)
+        {
+            return false;
+        }
+
+        // later matches may refer to the zeros
+        static char const zeros[deflate_window_size] = {};
+        m_flushed = false;
+        if (Z_OK != deflateSetDictionary(&m_stream, reinterpret_cast<Bytef const *>(zeros), sizeof(zeros)))
+        {
+            throw std::runtime_error("failed to deflate");
+        }
+
+        return true;
+    }
+
+    z_stream m_stream;
+    int m_level;
+    int m_pending_level;
+    size_t m_zero_runs;
+    size_t m_zero_pos;
+    bool m_flushed;
+};
+
+// libdeflate has no streaming interface; entries that are compressed
+// incrementally are passed to zlib at the same level
+class libdeflate_compressor_impl: public compressor_i
+{
+public:
+    explicit libdeflate_compressor_impl(int level)
+    : m_api(libdeflate_api::instance())
+    , m_compressor(nullptr)
+    , m_level((level < 0) ? libdeflate_default_level : level)
+    , m_streaming(std::min(level, Z_BEST_COMPRESSION))
+    {
+        if (m_api.available)
+        {
+            m_compressor = m_api.alloc_compressor(m_level);
+        }
+
+        if (m_compressor == nullptr)
+        {
+            throw std::runtime_error("libdeflate not available");
+        }
+    }
+
+    ~libdeflate_compressor_impl() override
+    {
+        m_api.free_compressor(m_compressor);
+    }
+
+    uint16_t method() const override
+    {
+        return method_deflate;
+    }
+
+    void reset() override
+    {
+        m_streaming.reset();
+    }
+
+    void set_level(int level) override
+    {
+        level = std::clamp(level, 0, libdeflate_max_level);
+        m_streaming.set_level(level);
+        if (level != m_level)
+        {
+            auto * compressor = m_api.alloc_compressor(level);
+            if (compressor != nullptr)
+            {
+                m_api.free_compressor(m_compressor);
+                m_compressor = compressor;
+                m_level = level;
+            }
+        }
+    }
+
+    bool compress(char const * & input, size_t & input_size, char * & output, size_t & output_size,
+        bool finish) override
+    {
+        return m_streaming.compress(input, input_size, output, output_size, finish);
+    }
+
+    size_t add_zeros(size_t count) override
+    {
+        return m_streaming.add_zeros(count);
+    }
+
+    size_t bound(size_t input_size) override
+    {
+        return m_api.deflate_compress_bound(m_compressor, input_size);
+    }
+
+    size_t compress_all(char const * input, size_t input_size, char * output, size_t output_size) override
+    {
+        return m_api.deflate_compress(m_compressor, input, input_size, output, output_size);
+    }
+
+private:
+    libdeflate_api const & m_api;
+    libdeflate_compressor * m_compressor;
+    int m_level;
+    zlib_compressor m_streaming;
+};
+
+class zstd_compressor: public compressor_i
+{
+public:
+    explicit zstd_compressor(int level)
+    : m_api(zstd_api::instance())
+    , m_context(nullptr)
+    , m_pending_level(0)
+    {
+        if (m_api.available)
+        {
+            m_context = m_api.create_context();
+        }
+
+        if (m_context == nullptr)
+        {
+            throw std::runtime_error("zstd not available");
+        }
+
+        m_api.set_parameter(m_context, zstd_api::compression_level, (level < 0) ? zstd_default_level : level);
+    }
+
+    ~zstd_compressor() override
+    {
+        m_api.free_context(m_context);
+    }
+
+    uint16_t method() const override
+    {
+        return method_zstd;
+    }
+
+    void reset() override
+    {
+        // parameters are kept and may be changed between frames only
+        m_api.reset_context(m_context, zstd_api::reset_session);
+        if (m_pending_level != 0)
+        {
+            m_api.set_parameter(m_context, zstd_api::compression_level, m_pending_level);
+            m_pending_level = 0;
+        }
+    }
+
+    void set_level(int level) override
+    {
+        m_pending_level = std::clamp(level, 1, zstd_max_level);
+    }
+
+    bool compress(char const * & input, size_t & input_size, char * & output, size_t & output_size,
+        bool finish) override
+    {
+        zstd_input in = {input, input_size, 0};
+        zstd_output out = {output, output_size, 0};
+        size_t const rc = m_api.compress_stream(m_context, &out, &in,
+            (finish) ? zstd_api::end_finish : zstd_api::end_continue);
+        if (m_api.is_error(rc))
+        {
+            throw std::runtime_error("failed to compress using zstd");
+        }
+
+        input += in.pos;
+        input_size -= in.pos;
+        output += out.pos;
+        output_size -= out.pos;
+
+        return (finish) && (input_size == 0) && (rc == 0);
+    }
+
+    // zstd encodes runs of zeros as RLE blocks on its own
+    size_t add_zeros(size_t) override
+    {
+        return 0;
+    }
+
+    size_t bound(size_t input_size) override
+    {
+        return m_api.compress_bound(input_size);
+    }
+
+    size_t compress_all(char const * input, size_t input_size, char * output, size_t output_size) override
+    {
+        reset();
+        size_t const capacity = output_size;
+        bool const done = compress(input, input_size, output, output_size, true);
+        reset();
+
+        return (done) ? capacity - output_size : 0;
+    }
+
+private:
+    zstd_api const & m_api;
+    zstd_context * m_context;
+    int m_pending_level;
+};
+
+class zlib_decompressor: public decompressor_i
+{
+public:
+    zlib_decompressor()
+    {
+        memset(&m_stream, 0, sizeof(m_stream));
+        if (Z_OK != inflateInit2(&m_stream, -MAX_WBITS))
+        {
+            throw std::runtime_error("failed to initialize inflate");
+        }
+    }
+
+    ~zlib_decompressor() override
+    {
+        inflateEnd(&m_stream);
+    }
+
+    void reset() override
+    {
+        inflateReset(&m_stream);
+    }
+
+    bool decompress(char const * & input, size_t & input_size, char * & output, size_t & output_size) override
+    {
+        // zlib rejects null pointers, even for empty buffers
+        char empty = 0;
+        size_t const input_chunk = std::min(input_size, max_zlib_chunk);
+        size_t const output_chunk = std::min(output_size, max_zlib_chunk);
+        m_stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>((input_chunk > 0) ? input : &empty));
+        m_stream.avail_in = static_cast<uInt>(input_chunk);
+        m_stream.next_out = reinterpret_cast<Bytef *>((output_chunk > 0) ? output : &empty);
+        m_stream.avail_out = static_cast<uInt>(output_chunk);
+
+        int const rc = inflate(&m_stream, Z_NO_FLUSH);
+        if ((rc != Z_OK) && (rc != Z_STREAM_END) && (rc != Z_BUF_ERROR))
+        {
+            throw std::runtime_error("invalid deflate data");
+        }
+
+        size_t const consumed = input_chunk - m_stream.avail_in;
+        size_t const produced = output_chunk - m_stream.avail_out;
+        input += consumed;
+        input_size -= consumed;
+        output += produced;
+        output_size -= produced;
+
+        return (rc == Z_STREAM_END);
+    }
+
+private:
+    z_stream m_stream;
+};
+
+class zstd_decompressor: public decompressor_i
+{
+public:
+    zstd_decompressor()
+    : m_api(zstd_api::instance())
+    , m_context(nullptr)
+    {
+        if (m_api.available)
+        {
+            m_context = m_api.create_dcontext();
+        }
+
+        if (m_context == nullptr)
+        {
+            throw std::runtime_error("zstd not available");
+        }
+    }
+
+    ~zstd_decompressor() override
+    {
+        m_api.free_dcontext(m_context);
+    }
+
+    void reset() override
+    {
+        m_api.reset_dcontext(m_context, zstd_api::reset_session);
+    }
+
+    // entries hold a single frame, which ends once the stream returns 0
+    bool decompress(char const * & input, size_t & input_size, char * & output, size_t & output_size) override
+    {
+        zstd_input in = {input, input_size, 0};
+        zstd_output out = {output, output_size, 0};
+        size_t const rc = m_api.decompress_stream(m_context, &out, &in);
+        if (m_api.is_error(rc))
+        {
+            throw std::runtime_error("invalid zstd data");
+        }
+
+        input += in.pos;
+        input_size -= in.pos;
+        output += out.pos;
+        output_size -= out.pos;
+
+        return (rc == 0);
+    }
+
+private:
+    zstd_api const & m_api;
+    zstd_dcontext * m_context;
+};
+
+bool inflate_all(std::string_view input, char * output, size_t output_size)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (Z_OK != inflateInit2(&stream, -MAX_WBITS))
+    {
+        return false;
+    }
+
+    // zlib rejects null pointers, even for empty buffers
+    char empty = 0;
+    if (output_size == 0)
+    {
+        output = &empty;
+    }
+
+    int rc = Z_OK;
+    size_t input_pos = 0;
+    size_t output_pos = 0;
+    while (rc == Z_OK)
+    {
+        size_t const input_chunk = std::min(input.size() - input_pos, max_zlib_chunk);
+        size_t const output_chunk = std::min(output_size - output_pos, max_zlib_chunk);
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(&input.data()[input_pos]));
+        stream.avail_in = static_cast<uInt>(input_chunk);
+        stream.next_out = reinterpret_cast<Bytef *>(&output[output_pos]);
+        stream.avail_out = static_cast<uInt>(output_chunk);
+
+        rc = inflate(&stream, Z_NO_FLUSH);
+        size_t const consumed = input_chunk - stream.avail_in;
+        size_t const produced = output_chunk - stream.avail_out;
+        input_pos += consumed;
+        output_pos += produced;
+        if ((rc == Z_OK) && (consumed == 0) && (produced == 0))
+        {
+            // truncated input or output too small
+            rc = Z_DATA_ERROR;
+        }
+    }
+
+    inflateEnd(&stream);
+    return (rc == Z_STREAM_END) && (output_pos == output_size);
+}
+
+}
+
+bool compression_available(compression backend)
+{
+    switch (backend)
+    {
+        case compression::store:
+            // fall-through
+        case compression::zlib:
+            return true;
+        case compression::libdeflate:
+            return libdeflate_api::instance().available;
+        case compression::zstd:
+            return zstd_api::instance().available;
+        default:
+            return false;
+    }
+}
+
+bool is_valid_level(compression backend, int level)
+{
+    switch (backend)
+    {
+        case compression::zlib:
+            return (level >= -1) && (level <= Z_BEST_COMPRESSION);
+        case compression::libdeflate:
+            return (level >= -1) && (level <= libdeflate_max_level);
+        case compression::zstd:
+            return (level >= -1) && (level <= zstd_max_level);
+        default:
+            return true;
+    }
+}
+
+uint16_t compression_method(compression backend)
+{
+    switch (backend)
+    {
+        case compression::zlib:
+            // fall-through
+        case compression::libdeflate:
+            return method_deflate;
+        case compression::zstd:
+            return method_zstd;
+        default:
+            return method_store;
+    }
+}
+
+std::unique_ptr<compressor_i> make_compressor(compression backend, int level)
+{
+    switch (backend)
+    {
+        case compression::zlib:
+            return std::make_unique<zlib_compressor>(level);
+        case compression::libdeflate:
+            return std::make_unique<libdeflate_compressor_impl>(level);
+        case compression::zstd:
+            return std::make_unique<zstd_compressor>(level);
+        default:
+            throw std::runtime_error("invalid compression");
+    }
+}
+
+std::unique_ptr<decompressor_i> make_decompressor(uint16_t method)
+{
+    switch (method)
+    {
+        case method_deflate:
+            return std::make_unique<zlib_decompressor>();
+        case method_zstd:
+            return (zstd_api::instance().available) ? std::make_unique<zstd_decompressor>() : nullptr;
+        default:
+            return nullptr;
+    }
+}
+
+bool decompress(uint16_t method, std::string_view input, char * output, size_t output_size)
+{
+    switch (method)
+    {
+        case method_store:
+            if (input.size() != output_size)
+            {
+                return false;
+            }
+            memcpy(output, input.data(), output_size);
+            return true;
+        case method_deflate:
+            return inflate_all(input, output, output_size);
+        case method_zstd:
+        {
+            auto const & api = zstd_api::instance();
+            if (!api.available)
+            {
+                return false;
+            }
+
+            size_t const rc = api.decompress(output, output_size, input.data(), input.size());
+            return (!api.is_error(rc)) && (rc == output_size);
+        }
+        default:
+            return false;
+    }
+}
+
+}
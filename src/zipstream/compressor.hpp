@@ -0,0 +1,76 @@
+#ifndef ZIPSTREAM_COMPRESSOR_HPP
+#define ZIPSTREAM_COMPRESSOR_HPP
+
+#include <zipstream/compression.hpp>
+
+#include <cinttypes>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace zipstream
+{
+
+// Compresses the data of one entry at a time.
+// Entries are either compressed incrementally using compress() or at
+// once using compress_all(); reset() starts the next entry.
+class compressor_i
+{
+public:
+    virtual ~compressor_i() = default;
+
+    // zip compression method of the produced data
+    virtual uint16_t method() const = 0;
+    virtual void reset() = 0;
+
+    // takes effect with the next block or entry, depending on the backend;
+    // levels beyond the range of the backend are clamped
+    virtual void set_level(int level) = 0;
+
+    // consumes input and fills output, advancing both;
+    // returns true once finish is set and all output is written
+    virtual bool compress(char const * & input, size_t & input_size, char * & output, size_t & output_size,
+        bool finish) = 0;
+
+    // appends a run of zeros without compressing it byte by byte; all
+    // input so far must be consumed. Returns the number of zeros taken,
+    // possibly less than count or none; the rest is passed as input
+    virtual size_t add_zeros(size_t count) = 0;
+
+    // upper bound of the output of compress_all
+    virtual size_t bound(size_t input_size) = 0;
+
+    // returns the size of the output or 0 if it does not fit
+    virtual size_t compress_all(char const * input, size_t input_size, char * output, size_t output_size) = 0;
+};
+
+// level -1 selects the default level of the backend
+std::unique_ptr<compressor_i> make_compressor(compression backend, int level = -1);
+
+bool is_valid_level(compression backend, int level);
+uint16_t compression_method(compression backend);
+
+// Decompresses the data of one entry incrementally; reset() starts the
+// next entry.
+class decompressor_i
+{
+public:
+    virtual ~decompressor_i() = default;
+
+    virtual void reset() = 0;
+
+    // consumes input and fills output, advancing both; returns true once
+    // the end of the compressed data is reached; throws on corrupt data
+    virtual bool decompress(char const * & input, size_t & input_size, char * & output, size_t & output_size) = 0;
+};
+
+// returns nullptr if the method is not supported or its backend is missing
+std::unique_ptr<decompressor_i> make_decompressor(uint16_t method);
+
+// decompresses a complete entry; returns false if the data is corrupt,
+// does not match output_size or the method is not supported
+bool decompress(uint16_t method, std::string_view input, char * output, size_t output_size);
+
+}
+
+#endif
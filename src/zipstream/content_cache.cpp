@@ -0,0 +1,456 @@
+#include "zipstream/content_cache.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace zipstream
+{
+
+namespace
+{
+
+constexpr char const cache_magic[8] = {'Z', 'S', 'C', 'A', 'C', 'H', 'E', '1'};
+constexpr char const cache_suffix[] = ".zsc";
+
+// header of a cache file, stored in host byte order
+struct file_header
+{
+    char magic[8];
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime;
+    int32_t backend;
+    int32_t level;
+    uint32_t crc32;
+    uint32_t reserved;
+    uint64_t data_size;
+};
+
+// 64 bit FNV-1a over the key fields
+uint64_t hash_of(content_key const & key)
+{
+    uint64_t const fields[] = {key.device, key.inode, key.size, static_cast<uint64_t>(key.mtime),
+        static_cast<uint64_t>(key.backend), static_cast<uint64_t>(static_cast<int64_t>(key.level))};
+
+    uint64_t hash = 0xcbf29ce484222325;
+    for(uint64_t field: fields)
+    {
+        for(int i = 0; i < 8; i++)
+        {
+            hash ^= (field >> (i * 8)) & 0xff;
+            hash *= 0x100000001b3;
+        }
+    }
+
+    return hash;
+}
+
+std::string file_name_of(uint64_t hash)
+{
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    return std::string(name) + cache_suffix;
+}
+
+}
+
+bool content_key::operator==(content_key const & other) const
+{
+    return (device == other.device) && (inode == other.inode) && (size == other.size) && (mtime == other.mtime)
+        && (backend == other.backend) && (level == other.level);
+}
+
+class content_cache::detail
+{
+public:
+    struct memory_entry
+    {
+        content_key key;
+        cached_content content;
+    };
+
+    struct disk_entry
+    {
+        uint64_t hash;
+        size_t size;
+    };
+
+    detail(std::string const & directory, size_t disk_limit, size_t memory_limit)
+    : directory(directory)
+    , disk_limit(disk_limit)
+    , memory_limit(memory_limit)
+    , memory_used(0)
+    , disk_used(0)
+    , hits(0)
+    , misses(0)
+    , temp_count(0)
+    {
+        std::filesystem::create_directories(directory);
+        scan();
+    }
+
+    // adopts the files of earlier runs, oldest first
+    void scan()
+    {
+        std::vector<std::pair<std::filesystem::file_time_type, disk_entry>> found;
+        for(auto const & item: std::filesystem::directory_iterator(directory))
+        {
+            auto const name = item.path().filename().string();
+            std::error_code error;
+            if ((!item.is_regular_file(error)) || (name.size() != (16 + sizeof(cache_suffix) - 1))
+                || (name.compare(16, std::string::npos, cache_suffix) != 0))
+            {
+                continue;
+            }
+
+            disk_entry entry;
+            entry.hash = std::stoull(name.substr(0, 16), nullptr, 16);
+            entry.size = item.file_size(error);
+            found.emplace_back(item.last_write_time(error), entry);
+        }
+
+        std::sort(found.begin(), found.end(), [](auto const & a, auto const & b) { return a.first < b.first; });
+        for(auto const & item: found)
+        {
+            disk_lru.push_front(item.second);
+            disk_index[item.second.hash] = disk_lru.begin();
+            disk_used += item.second.size;
+        }
+        remove_files(evict_disk(0));
+    }
+
+    std::string path_of(uint64_t hash) const
+    {
+        return (std::filesystem::path(directory) / file_name_of(hash)).string();
+    }
+
+    std::optional<cached_content> find_in_memory(uint64_t hash, content_key const & key)
+    {
+        auto const it = memory_index.find(hash);
+        if ((it == memory_index.end()) || (!(it->second->key == key)))
+        {
+            return std::nullopt;
+        }
+
+        memory_lru.splice(memory_lru.begin(), memory_lru, it->second);
+        return it->second->content;
+    }
+
+    // called without the lock; files written by other processes are not
+    // indexed yet, so the file is looked up even if it is not indexed
+    std::optional<cached_content> read_file(uint64_t hash, content_key const & key) const
+    {
+        std::ifstream file(path_of(hash), std::ios_base::in | std::ios_base::binary);
+        file_header header;
+        if ((!file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+            || (0 != memcmp(header.magic, cache_magic, sizeof(cache_magic)))
+            || (!(key == content_key{header.device, header.inode, header.size, header.mtime,
+                static_cast<compression>(header.backend), header.level}))
+            || (header.data_size > memory_limit))
+        {
+            return std::nullopt;
+        }
+
+        auto data = std::make_shared<std::string>(header.data_size, '\0');
+        if (!file.read(&(*data)[0], data->size()))
+        {
+            return std::nullopt;
+        }
+
+        return cached_content{header.crc32, header.size, std::move(data)};
+    }
+
+    // called without the lock; the payload is written to a temporary file
+    // that is moved into place by commit_file, so readers never see partial files
+    std::optional<std::string> write_file(uint64_t hash, content_key const & key, cached_content const & content)
+    {
+        file_header header = {};
+        memcpy(header.magic, cache_magic, sizeof(cache_magic));
+        header.device = key.device;
+        header.inode = key.inode;
+        header.size = key.size;
+        header.mtime = key.mtime;
+        header.backend = static_cast<int32_t>(key.backend);
+        header.level = key.level;
+        header.crc32 = content.crc32;
+        header.data_size = content.data->size();
+
+        std::string const temp_path = unique_path_of(hash, ".tmp");
+        std::ofstream file(temp_path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+        file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        file.write(content.data->data(), content.data->size());
+        if (!file.flush())
+        {
+            std::error_code error;
+            std::filesystem::remove(temp_path, error);
+            return std::nullopt;
+        }
+
+        return temp_path;
+    }
+
+    // called with the lock, so that the file is not evicted between being
+    // moved into place and being indexed
+    bool commit_file(uint64_t hash, std::string const & temp_path)
+    {
+        std::error_code error;
+        std::filesystem::rename(temp_path, path_of(hash), error);
+        if (error)
+        {
+            std::filesystem::remove(temp_path, error);
+            return false;
+        }
+
+        return true;
+    }
+
+    std::string unique_path_of(uint64_t hash, char const * suffix)
+    {
+        return path_of(hash) + "." + std::to_string(getpid()) + "." + std::to_string(temp_count++) + suffix;
+    }
+
+    void add_to_memory(uint64_t hash, content_key const & key, cached_content const & content)
+    {
+        auto const it = memory_index.find(hash);
+        if (it != memory_index.end())
+        {
+            memory_used -= it->second->content.data->size();
+            memory_lru.erase(it->second);
+            memory_index.erase(it);
+        }
+
+        evict_memory(content.data->size());
+        memory_lru.push_front(memory_entry{key, content});
+        memory_index[hash] = memory_lru.begin();
+        memory_used += content.data->size();
+    }
+
+    // marks a payload file as most recently used; returns the evicted files
+    std::vector<std::string> add_to_disk(uint64_t hash, size_t file_size)
+    {
+        auto const it = disk_index.find(hash);
+        if (it != disk_index.end())
+        {
+            disk_used -= it->second->size;
+            disk_lru.erase(it->second);
+            disk_index.erase(it);
+        }
+
+        auto evicted = evict_disk(file_size);
+        disk_lru.push_front(disk_entry{hash, file_size});
+        disk_index[hash] = disk_lru.begin();
+        disk_used += file_size;
+        return evicted;
+    }
+
+    void evict_memory(size_t needed)
+    {
+        while ((!memory_lru.empty()) && ((memory_used + needed) > memory_limit))
+        {
+            auto const & entry = memory_lru.back();
+            memory_used -= entry.content.data->size();
+            memory_index.erase(hash_of(entry.key));
+            memory_lru.pop_back();
+        }
+    }
+
+    // evicted files are renamed to unique names with the lock held, so that
+    // a file added again under the same hash meanwhile is never removed;
+    // the caller removes them outside the lock
+    std::vector<std::string> evict_disk(size_t needed)
+    {
+        std::vector<std::string> evicted;
+        while ((!disk_lru.empty()) && ((disk_used + needed) > disk_limit))
+        {
+            auto const & entry = disk_lru.back();
+            std::string const evicted_path = unique_path_of(entry.hash, ".evicted");
+            std::error_code error;
+            std::filesystem::rename(path_of(entry.hash), evicted_path, error);
+            if (!error)
+            {
+                evicted.push_back(evicted_path);
+            }
+
+            disk_used -= entry.size;
+            disk_index.erase(entry.hash);
+            disk_lru.pop_back();
+        }
+        return evicted;
+    }
+
+    static void remove_files(std::vector<std::string> const & paths)
+    {
+        for(auto const & path: paths)
+        {
+            std::error_code error;
+            std::filesystem::remove(path, error);
+        }
+    }
+
+    std::string const directory;
+    size_t const disk_limit;
+    size_t const memory_limit;
+
+    mutable std::mutex mutex;
+    std::list<memory_entry> memory_lru;
+    std::unordered_map<uint64_t, std::list<memory_entry>::iterator> memory_index;
+    size_t memory_used;
+    std::list<disk_entry> disk_lru;
+    std::unordered_map<uint64_t, std::list<disk_entry>::iterator> disk_index;
+    size_t disk_used;
+    uint64_t hits;
+    uint64_t misses;
+    std::atomic<uint64_t> temp_count;
+};
+
+content_cache::content_cache(std::string const & directory, size_t disk_limit, size_t memory_limit)
+: d(new detail(directory, disk_limit, memory_limit))
+{
+}
+
+content_cache::~content_cache()
+{
+    delete d;
+}
+
+content_key content_cache::key_of(std::string const & path, compression backend, int level)
+{
+    struct stat info;
+    if (0 != stat(path.c_str(), &info))
+    {
+        throw std::runtime_error("failed to stat " + path);
+    }
+
+    content_key key;
+    key.device = static_cast<uint64_t>(info.st_dev);
+    key.inode = static_cast<uint64_t>(info.st_ino);
+    key.size = static_cast<uint64_t>(info.st_size);
+    key.mtime = (static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000) + info.st_mtim.tv_nsec;
+    key.backend = backend;
+    key.level = level;
+    return key;
+}
+
+// the lock guards the indexes and the renames that add or evict cache
+// files; the files are read and written without it, so that lookups of
+// cached payloads do not wait for disk I/O
+std::optional<cached_content> content_cache::find(content_key const & key)
+{
+    uint64_t const hash = hash_of(key);
+    {
+        std::lock_guard<std::mutex> lock(d->mutex);
+        auto content = d->find_in_memory(hash, key);
+        if (content)
+        {
+            d->hits++;
+            return content;
+        }
+    }
+
+    auto content = d->read_file(hash, key);
+    std::vector<std::string> evicted;
+    {
+        std::lock_guard<std::mutex> lock(d->mutex);
+        if (!content)
+        {
+            d->misses++;
+            return content;
+        }
+
+        d->hits++;
+        // the file may have been evicted since it was read
+        std::error_code error;
+        if ((d->disk_index.count(hash) > 0) || (std::filesystem::exists(d->path_of(hash), error)))
+        {
+            evicted = d->add_to_disk(hash, sizeof(file_header) + content->data->size());
+        }
+        d->add_to_memory(hash, key, content.value());
+    }
+
+    d->remove_files(evicted);
+    return content;
+}
+
+cached_content content_cache::insert(content_key const & key, uint32_t crc32, std::string && data)
+{
+    cached_content content{crc32, key.size, std::make_shared<std::string const>(std::move(data))};
+    if (content.data->size() > d->memory_limit)
+    {
+        return content;
+    }
+
+    uint64_t const hash = hash_of(key);
+    {
+        std::lock_guard<std::mutex> lock(d->mutex);
+        d->add_to_memory(hash, key, content);
+    }
+
+    size_t const file_size = sizeof(file_header) + content.data->size();
+    if (file_size > d->disk_limit)
+    {
+        return content;
+    }
+
+    auto const temp_path = d->write_file(hash, key, content);
+    if (!temp_path)
+    {
+        return content;
+    }
+
+    std::vector<std::string> evicted;
+    {
+        std::lock_guard<std::mutex> lock(d->mutex);
+        if (!d->commit_file(hash, temp_path.value()))
+        {
+            return content;
+        }
+        evicted = d->add_to_disk(hash, file_size);
+    }
+
+    d->remove_files(evicted);
+    return content;
+}
+
+size_t content_cache::max_payload_size() const
+{
+    return d->memory_limit;
+}
+
+size_t content_cache::memory_usage() const
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+    return d->memory_used;
+}
+
+size_t content_cache::disk_usage() const
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+    return d->disk_used;
+}
+
+uint64_t content_cache::hits() const
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+    return d->hits;
+}
+
+uint64_t content_cache::misses() const
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+    return d->misses;
+}
+
+}
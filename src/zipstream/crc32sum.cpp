@@ -3,6 +3,11 @@
 #include <fstream>
 #include <stdexcept>
 #include <cstdint>
+#include <cstring>
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
 
 namespace zipstream
 {
@@ -47,6 +52,142 @@ uint32_t const table[256] =
     0xB3667A2E, 0xC4614AB8,  0x5D681B02, 0x2A6F2B94,   0xB40BBE37, 0xC30C8EA1,  0x5A05DF1B, 0x2D02EF8D
 };  
 
+// tables for slicing-by-8: slices[k][i] is the CRC of byte i followed by k zero bytes
+struct slice_tables
+{
+    uint32_t slices[8][256];
+
+    slice_tables()
+    {
+        for(size_t i = 0; i < 256; i++)
+        {
+            slices[0][i] = table[i];
+        }
+
+        for(size_t k = 1; k < 8; k++)
+        {
+            for(size_t i = 0; i < 256; i++)
+            {
+                uint32_t const previous = slices[k - 1][i];
+                slices[k][i] = (previous >> 8) ^ table[previous & 0xff];
+            }
+        }
+    }
+};
+
+slice_tables const & get_slice_tables()
+{
+    static slice_tables const tables;
+    return tables;
+}
+
+// Appending zeros is linear in the CRC register, so runs of 2^k zero
+// bytes are applied as 32x32 bit matrices over GF(2), one per bit of
+// the run length. Column i holds the image of bit i.
+struct zero_operators
+{
+    static constexpr size_t const count = 64;
+    uint32_t matrices[count][32];
+
+    static uint32_t times(uint32_t const * matrix, uint32_t vector)
+    {
+        uint32_t result = 0;
+        for(size_t i = 0; vector != 0; i++, vector >>= 1)
+        {
+            if (0 != (vector & 1))
+            {
+                result ^= matrix[i];
+            }
+        }
+
+        return result;
+    }
+
+    zero_operators()
+    {
+        for(size_t i = 0; i < 32; i++)
+        {
+            uint32_t const bit = uint32_t(1) << i;
+            matrices[0][i] = (bit >> 8) ^ table[bit & 0xff];
+        }
+
+        for(size_t k = 1; k < count; k++)
+        {
+            for(size_t i = 0; i < 32; i++)
+            {
+                matrices[k][i] = times(matrices[k - 1], matrices[k - 1][i]);
+            }
+        }
+    }
+};
+
+zero_operators const & get_zero_operators()
+{
+    static zero_operators const operators;
+    return operators;
+}
+
+uint32_t update_bytewise(uint32_t value, unsigned char const * buffer, size_t buffer_size)
+{
+    for(size_t i = 0; i < buffer_size; i++)
+    {
+        size_t const idx = (value ^ buffer[i]) & 0xff;
+        value = (value >> 8) ^ table[idx];
+    }
+
+    return value;
+}
+
+#if defined(__ARM_FEATURE_CRC32)
+
+// ARMv8 provides instructions for this polynomial
+uint32_t update_fast(uint32_t value, unsigned char const * buffer, size_t buffer_size)
+{
+    size_t i = 0;
+    for(; (i + 8) <= buffer_size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, &buffer[i], 8);
+        value = __crc32d(value, word);
+    }
+
+    return update_bytewise(value, &buffer[i], buffer_size - i);
+}
+
+#elif defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+
+// slicing-by-8: processes eight bytes per step with independent table lookups
+uint32_t update_fast(uint32_t value, unsigned char const * buffer, size_t buffer_size)
+{
+    auto const & slices = get_slice_tables().slices;
+
+    size_t i = 0;
+    for(; (i + 8) <= buffer_size; i += 8)
+    {
+        uint32_t low;
+        uint32_t high;
+        memcpy(&low, &buffer[i], 4);
+        memcpy(&high, &buffer[i + 4], 4);
+        low ^= value;
+
+        value = slices[7][low & 0xff] ^ slices[6][(low >> 8) & 0xff]
+            ^ slices[5][(low >> 16) & 0xff] ^ slices[4][low >> 24]
+            ^ slices[3][high & 0xff] ^ slices[2][(high >> 8) & 0xff]
+            ^ slices[1][(high >> 16) & 0xff] ^ slices[0][high >> 24];
+    }
+
+    return update_bytewise(value, &buffer[i], buffer_size - i);
+}
+
+#else
+
+uint32_t update_fast(uint32_t value, unsigned char const * buffer, size_t buffer_size)
+{
+    return update_bytewise(value, buffer, buffer_size);
+}
+
+#endif
+
 }
 
 crc32sum::crc32sum()
@@ -60,15 +201,23 @@ void crc32sum::update(char const * buffer, size_t buffer_size)
     unsigned char const * const buf = reinterpret_cast<unsigned char const *>(buffer);
 
     value = value ^ 0xffffffff;
+    value = update_fast(value, buf, buffer_size);
+    value ^= 0xffffffff;
+}
 
-    for(size_t i = 0; i < buffer_size; i++)
+void crc32sum::update_zeros(size_t count)
+{
+    auto const & operators = get_zero_operators();
+
+    value = value ^ 0xffffffff;
+    for(size_t k = 0; count != 0; k++, count >>= 1)
     {
-        size_t const idx = (value ^ buffer[i]) & 0xff;
-        value = (value >> 8) ^ table[idx];
+        if (0 != (count & 1))
+        {
+            value = zero_operators::times(operators.matrices[k], value);
+        }
     }
-
     value ^= 0xffffffff;
-    
 }
 
 uint32_t crc32sum::get_value() const
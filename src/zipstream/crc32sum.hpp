@@ -15,6 +15,8 @@ public:
     crc32sum();
     ~crc32sum() = default;
     void update(char const * buffer, size_t buffer_size);
+    // same as update() with count zero bytes, in logarithmic time
+    void update_zeros(size_t count);
     uint32_t get_value() const;
 
     static uint32_t from_string(std::string const & value);
@@ -0,0 +1,106 @@
+#include "zipstream/entry_sorter.hpp"
+#include "zipstream/fd_cache.hpp"
+
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+namespace zipstream
+{
+
+namespace
+{
+
+struct sort_key
+{
+    // entries not read from files, files with a physical location, others
+    uint8_t group;
+    uint64_t device;
+    uint64_t location;
+    size_t index;
+
+    bool operator<(sort_key const & other) const
+    {
+        return std::tie(group, device, location, index)
+            < std::tie(other.group, other.device, other.location, other.index);
+    }
+};
+
+// physical offset of the first extent of a file, if the file system reports one
+bool first_extent(int fd, uint64_t & location)
+{
+    // room for one extent after the header
+    alignas(struct fiemap) char request[sizeof(struct fiemap) + sizeof(struct fiemap_extent)] = {};
+    auto * map = reinterpret_cast<struct fiemap *>(request);
+    map->fm_start = 0;
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_extent_count = 1;
+
+    if ((0 != ioctl(fd, FS_IOC_FIEMAP, map)) || (map->fm_mapped_extents == 0)
+        || (0 != (map->fm_extents[0].fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DATA_INLINE))))
+    {
+        return false;
+    }
+
+    location = map->fm_extents[0].fe_physical;
+    return true;
+}
+
+sort_key key_of(entry_table & entries, size_t index, entry_order order)
+{
+    sort_key key = {0, 0, 0, index};
+    if (entries.type(index) != entry_type::file_from_path)
+    {
+        return key;
+    }
+
+    key.group = 2;
+    auto const file = fd_cache::instance().open(entries.path(index));
+    if (!file)
+    {
+        // reported when the file is read
+        return key;
+    }
+
+    key.device = file->device();
+    key.location = file->inode();
+    if ((order == entry_order::physical) && (first_extent(file->get(), key.location)))
+    {
+        key.group = 1;
+    }
+
+    return key;
+}
+
+}
+
+std::vector<size_t> sort_entries(entry_table & entries, entry_order order)
+{
+    std::vector<size_t> result(entries.count());
+    std::iota(result.begin(), result.end(), 0);
+    if (order == entry_order::insertion)
+    {
+        return result;
+    }
+
+    std::vector<sort_key> keys;
+    keys.reserve(entries.count());
+    for(size_t index = 0; index < entries.count(); index++)
+    {
+        keys.push_back(key_of(entries, index, order));
+    }
+
+    std::sort(keys.begin(), keys.end());
+    for(size_t i = 0; i < keys.size(); i++)
+    {
+        result[i] = keys[i].index;
+    }
+
+    return result;
+}
+
+}
@@ -0,0 +1,18 @@
+#ifndef ZIPSTREAM_ENTRY_SORTER_HPP
+#define ZIPSTREAM_ENTRY_SORTER_HPP
+
+#include "zipstream/entry_table.hpp"
+#include <zipstream/entry_order.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace zipstream
+{
+
+// indices of the entries in the given order; ties keep insertion order
+std::vector<size_t> sort_entries(entry_table & entries, entry_order order);
+
+}
+
+#endif
@@ -0,0 +1,528 @@
+#include "zipstream/entry_table.hpp"
+#include "zipstream/crc32sum.hpp"
+#include "zipstream/compressor.hpp"
+#include "zipstream/fd_cache.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+
+namespace zipstream
+{
+
+namespace
+{
+
+constexpr uint8_t const flag_crc32_known = 0x01;
+constexpr uint8_t const flag_size_known = 0x02;
+constexpr uint8_t const flag_compressed_size_known = 0x04;
+constexpr uint8_t const flag_compression_forced = 0x08;
+constexpr uint8_t const compression_shift = 4;
+constexpr uint8_t const compression_mask = 0x30;
+
+constexpr uint16_t const flag_encrypted = 0x01;
+
+// lower case extension of the file name including the dot
+std::string extension_of(std::string_view name)
+{
+    size_t const slash = name.rfind('/');
+    size_t const dot = name.rfind('.');
+    if ((dot == std::string_view::npos) || ((slash != std::string_view::npos) && (dot < slash)))
+    {
+        return std::string();
+    }
+
+    std::string extension(name.substr(dot));
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+template <typename T>
+size_t vector_usage(std::vector<T> const & values)
+{
+    return values.capacity() * sizeof(T);
+}
+
+template <typename T>
+void permute(std::vector<T> & values, std::vector<size_t> const & order)
+{
+    std::vector<T> result;
+    result.reserve(values.size());
+    for(size_t index: order)
+    {
+        result.push_back(values.at(index));
+    }
+    values.swap(result);
+}
+
+}
+
+size_t entry_table::add_directory(std::string_view name)
+{
+    return add(entry_type::directory, name, 0, 0, 0, 0);
+}
+
+size_t entry_table::add_file_with_content(std::string_view name, std::string_view content)
+{
+    if (content.size() > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::runtime_error("content too large");
+    }
+
+    crc32sum checksum;
+    checksum.update(content.data(), content.size());
+
+    uint64_t const pos = m_strings.add(content);
+    uint32_t const length = static_cast<uint32_t>(content.size());
+    return add(entry_type::file_with_content, name, pos, length, length, checksum.get_value());
+}
+
+size_t entry_table::add_file_from_path(std::string_view name, std::string_view path, std::optional<uint64_t> size)
+{
+    // no zip64 support
+    if ((size.has_value()) && (size.value() > std::numeric_limits<uint32_t>::max()))
+    {
+        throw std::runtime_error("content too large");
+    }
+
+    uint64_t const pos = m_strings.add(path);
+    size_t const index = add(entry_type::file_from_path, name, pos, static_cast<uint32_t>(path.size()),
+        static_cast<uint32_t>(size.value_or(0)), std::nullopt);
+    if (size.has_value())
+    {
+        m_flags[index] |= flag_size_known;
+    }
+
+    return index;
+}
+
+uint32_t entry_table::add_source(std::shared_ptr<reader const> source)
+{
+    for(size_t index = 0; index < m_sources.size(); index++)
+    {
+        if (m_sources[index] == source)
+        {
+            return static_cast<uint32_t>(index);
+        }
+    }
+
+    m_sources.push_back(std::move(source));
+    return static_cast<uint32_t>(m_sources.size() - 1);
+}
+
+size_t entry_table::add_raw_copy(std::string_view name, uint32_t source, size_t source_index)
+{
+    auto const & archive = *m_sources.at(source);
+    auto const info = archive.entry(source_index);
+    if ((info.flags & flag_encrypted) != 0)
+    {
+        throw std::runtime_error("encrypted entries cannot be copied");
+    }
+
+    if ((info.compressed_size > std::numeric_limits<uint32_t>::max())
+        || (info.uncompressed_size > std::numeric_limits<uint32_t>::max()))
+    {
+        throw std::runtime_error("content too large");
+    }
+
+    auto const data = archive.data(source_index);
+    raw_entry raw;
+    raw.data_offset = static_cast<uint64_t>(data.data() - archive.bytes().data());
+    raw.source = source;
+    raw.compression_method = info.compression_method;
+    m_raw.push_back(raw);
+
+    return add(entry_type::raw_copy, name, m_raw.size() - 1, static_cast<uint32_t>(data.size()),
+        static_cast<uint32_t>(info.uncompressed_size), info.crc32);
+}
+
+void entry_table::set_compression(zipstream::compression backend, int level)
+{
+    bool valid = is_valid_level(backend, level);
+    if (m_policy)
+    {
+        for(auto const & extension: m_policy->extensions)
+        {
+            valid = valid && is_valid_level(extension.second, level);
+        }
+    }
+
+    if (!valid)
+    {
+        throw std::runtime_error("invalid compression level");
+    }
+
+    m_compression = backend;
+    m_compression_level = level;
+}
+
+zipstream::compression entry_table::compression() const
+{
+    return m_compression;
+}
+
+int entry_table::compression_level() const
+{
+    return m_compression_level;
+}
+
+void entry_table::set_policy(compression_policy const & policy)
+{
+    for(auto const & extension: policy.extensions)
+    {
+        if (!is_valid_level(extension.second, m_compression_level))
+        {
+            throw std::runtime_error("invalid compression level");
+        }
+    }
+
+    m_policy = policy;
+}
+
+compression_policy const * entry_table::policy() const
+{
+    return (m_policy) ? &m_policy.value() : nullptr;
+}
+
+size_t entry_table::add(entry_type type, std::string_view name, uint64_t data_pos, uint32_t data_length,
+        uint32_t size, std::optional<uint32_t> crc32)
+{
+    if (name.size() > std::numeric_limits<uint16_t>::max())
+    {
+        throw std::runtime_error("name too long");
+    }
+
+    uint8_t flags = (type != entry_type::file_from_path) ? flag_size_known : 0;
+    if (crc32.has_value())
+    {
+        flags |= flag_crc32_known;
+    }
+
+    if ((type == entry_type::file_with_content) || (type == entry_type::file_from_path))
+    {
+        auto backend = m_compression;
+        if ((m_policy) && (!m_policy->extensions.empty()))
+        {
+            auto const it = m_policy->extensions.find(extension_of(name));
+            if (it != m_policy->extensions.end())
+            {
+                backend = it->second;
+                flags |= flag_compression_forced;
+            }
+        }
+        flags |= static_cast<uint8_t>(backend) << compression_shift;
+    }
+
+    m_type.push_back(type);
+    m_flags.push_back(flags);
+    m_name_length.push_back(static_cast<uint16_t>(name.size()));
+    m_name_pos.push_back(m_strings.add(name));
+    m_data_pos.push_back(data_pos);
+    m_data_length.push_back(data_length);
+    m_size.push_back(size);
+    m_compressed_size.push_back(0);
+    m_crc32.push_back(crc32.value_or(0));
+    m_offset.push_back(0);
+
+    return m_type.size() - 1;
+}
+
+size_t entry_table::count() const
+{
+    return m_type.size();
+}
+
+void entry_table::clear()
+{
+    m_type.clear();
+    m_flags.clear();
+    m_name_length.clear();
+    m_name_pos.clear();
+    m_data_pos.clear();
+    m_data_length.clear();
+    m_size.clear();
+    m_compressed_size.clear();
+    m_crc32.clear();
+    m_offset.clear();
+    m_strings.clear();
+    m_raw.clear();
+    m_sources.clear();
+}
+
+void entry_table::reserve(size_t count)
+{
+    m_type.reserve(count);
+    m_flags.reserve(count);
+    m_name_length.reserve(count);
+    m_name_pos.reserve(count);
+    m_data_pos.reserve(count);
+    m_data_length.reserve(count);
+    m_size.reserve(count);
+    m_compressed_size.reserve(count);
+    m_crc32.reserve(count);
+    m_offset.reserve(count);
+}
+
+void entry_table::shrink_to_fit()
+{
+    m_type.shrink_to_fit();
+    m_flags.shrink_to_fit();
+    m_name_length.shrink_to_fit();
+    m_name_pos.shrink_to_fit();
+    m_data_pos.shrink_to_fit();
+    m_data_length.shrink_to_fit();
+    m_size.shrink_to_fit();
+    m_compressed_size.shrink_to_fit();
+    m_crc32.shrink_to_fit();
+    m_offset.shrink_to_fit();
+    m_raw.shrink_to_fit();
+}
+
+void entry_table::reorder(std::vector<size_t> const & order)
+{
+    if (order.size() != count())
+    {
+        throw std::runtime_error("invalid entry order");
+    }
+
+    permute(m_type, order);
+    permute(m_flags, order);
+    permute(m_name_length, order);
+    permute(m_name_pos, order);
+    permute(m_data_pos, order);
+    permute(m_data_length, order);
+    permute(m_size, order);
+    permute(m_compressed_size, order);
+    permute(m_crc32, order);
+    permute(m_offset, order);
+}
+
+size_t entry_table::memory_usage() const
+{
+    return vector_usage(m_type) + vector_usage(m_flags) + vector_usage(m_name_length)
+        + vector_usage(m_name_pos) + vector_usage(m_data_pos) + vector_usage(m_data_length)
+        + vector_usage(m_size) + vector_usage(m_compressed_size) + vector_usage(m_crc32) + vector_usage(m_offset)
+        + m_strings.memory_usage() + vector_usage(m_raw) + vector_usage(m_sources);
+}
+
+size_t entry_table::max_name_length() const
+{
+    auto const it = std::max_element(m_name_length.begin(), m_name_length.end());
+    return (it != m_name_length.end()) ? *it : 0;
+}
+
+entry_type entry_table::type(size_t index) const
+{
+    return m_type.at(index);
+}
+
+std::string_view entry_table::name(size_t index) const
+{
+    return m_strings.get(m_name_pos.at(index), m_name_length[index]);
+}
+
+uint32_t entry_table::size(size_t index)
+{
+    if (0 == (m_flags.at(index) & flag_size_known))
+    {
+        auto const file_size = std::filesystem::file_size(path(index));
+        if (file_size > std::numeric_limits<uint32_t>::max())
+        {
+            throw std::runtime_error("content too large");
+        }
+        m_size[index] = static_cast<uint32_t>(file_size);
+        m_flags[index] |= flag_size_known;
+    }
+
+    return m_size[index];
+}
+
+uint32_t entry_table::compressed_size(size_t index)
+{
+    if (m_type.at(index) == entry_type::raw_copy)
+    {
+        return m_data_length[index];
+    }
+
+    return (compression(index) != zipstream::compression::store) ? m_compressed_size[index] : size(index);
+}
+
+uint16_t entry_table::compression_method(size_t index) const
+{
+    if (m_type.at(index) == entry_type::raw_copy)
+    {
+        return m_raw[m_data_pos[index]].compression_method;
+    }
+
+    return zipstream::compression_method(compression(index));
+}
+
+zipstream::compression entry_table::compression(size_t index) const
+{
+    return static_cast<zipstream::compression>((m_flags.at(index) & compression_mask) >> compression_shift);
+}
+
+bool entry_table::compression_forced(size_t index) const
+{
+    return (0 != (m_flags.at(index) & flag_compression_forced));
+}
+
+void entry_table::set_stored(size_t index)
+{
+    m_flags.at(index) &= ~compression_mask;
+}
+
+void entry_table::set_compressed_size(size_t index, uint32_t value)
+{
+    m_compressed_size.at(index) = value;
+}
+
+void entry_table::set_known_compressed_size(size_t index, uint32_t value)
+{
+    m_compressed_size.at(index) = value;
+    m_flags[index] |= flag_compressed_size_known;
+}
+
+bool entry_table::data_descriptor_needed(size_t index) const
+{
+    uint8_t const flags = m_flags.at(index);
+    bool const compressed = (0 != (flags & compression_mask));
+    return (0 == (flags & flag_crc32_known)) || ((compressed) && (0 == (flags & flag_compressed_size_known)));
+}
+
+uint32_t entry_table::crc32(size_t index) const
+{
+    return m_crc32.at(index);
+}
+
+void entry_table::set_crc32(size_t index, uint32_t value)
+{
+    m_crc32.at(index) = value;
+}
+
+void entry_table::set_known_crc32(size_t index, uint32_t value)
+{
+    m_crc32.at(index) = value;
+    m_flags[index] |= flag_crc32_known;
+}
+
+uint32_t entry_table::offset(size_t index) const
+{
+    return m_offset.at(index);
+}
+
+void entry_table::set_offset(size_t index, uint32_t value)
+{
+    m_offset.at(index) = value;
+}
+
+size_t entry_table::read_at(size_t index, size_t offset, char * buffer, size_t buffer_size)
+{
+    switch (m_type.at(index))
+    {
+        case entry_type::directory:
+            return 0;
+        case entry_type::file_with_content:
+        {
+            auto const content = m_strings.get(m_data_pos[index], m_data_length[index]);
+            if (offset >= content.size())
+            {
+                return 0;
+            }
+
+            size_t const count = std::min(content.size() - offset, buffer_size);
+            memcpy(buffer, &content.data()[offset], count);
+            return count;
+        }
+        case entry_type::file_from_path:
+        {
+            // descriptors are shared with other streams reading the same file
+            auto const file = fd_cache::instance().open(path(index));
+            if (!file)
+            {
+                throw std::runtime_error("failed to read file");
+            }
+
+            return file->read_at(offset, buffer, buffer_size);
+        }
+        case entry_type::raw_copy:
+        {
+            // compressed data is copied straight from the mapped source archive
+            auto const & raw = m_raw[m_data_pos[index]];
+            size_t const length = m_data_length[index];
+            if (offset >= length)
+            {
+                return 0;
+            }
+
+            size_t const count = std::min(length - offset, buffer_size);
+            auto const data = m_sources[raw.source]->bytes().substr(raw.data_offset + offset, count);
+            memcpy(buffer, data.data(), count);
+            return count;
+        }
+        default:
+            throw std::runtime_error("invalid entry type");
+    }
+}
+
+file_extent entry_table::extent_at(size_t index, size_t offset)
+{
+    size_t const entry_size = (m_type.at(index) == entry_type::directory) ? 0
+        : (m_type[index] == entry_type::raw_copy) ? m_data_length[index] : size(index);
+    file_extent extent{offset, (offset < entry_size) ? entry_size - offset : 0, false};
+    if ((m_type[index] != entry_type::file_from_path) || (extent.length == 0))
+    {
+        return extent;
+    }
+
+    auto const file = fd_cache::instance().open(path(index));
+    if (!file)
+    {
+        // reported by read_at
+        return extent;
+    }
+    // the shared file offset is moved, which pread does not depend on
+    int const fd = file->get();
+
+    struct stat info;
+    if ((0 == fstat(fd, &info)) && (static_cast<off_t>(offset) < info.st_size))
+    {
+        off_t const data = lseek(fd, static_cast<off_t>(offset), SEEK_DATA);
+        if ((data < 0) && (errno == ENXIO))
+        {
+            // hole up to the end of the file
+            extent.hole = true;
+            extent.length = std::min(extent.length, static_cast<size_t>(info.st_size) - offset);
+        }
+        else if (data > static_cast<off_t>(offset))
+        {
+            extent.hole = true;
+            extent.length = std::min(extent.length, static_cast<size_t>(data) - offset);
+        }
+        else if (data == static_cast<off_t>(offset))
+        {
+            off_t const hole = lseek(fd, static_cast<off_t>(offset), SEEK_HOLE);
+            if (hole > data)
+            {
+                extent.length = std::min(extent.length, static_cast<size_t>(hole) - offset);
+            }
+        }
+    }
+
+    return extent;
+}
+
+char const * entry_table::path(size_t index) const
+{
+    return m_strings.c_str(m_data_pos[index]);
+}
+
+}
@@ -0,0 +1,128 @@
+#ifndef ZIPSTREAM_ENTRY_TABLE_HPP
+#define ZIPSTREAM_ENTRY_TABLE_HPP
+
+#include "zipstream/entry_type.hpp"
+#include "zipstream/string_arena.hpp"
+#include "zipstream/reader.hpp"
+#include <zipstream/compression.hpp>
+
+#include <cinttypes>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace zipstream
+{
+
+// run of data or of a hole within the data of an entry; holes read as zeros
+struct file_extent
+{
+    size_t offset;
+    size_t length;
+    bool hole;
+};
+
+// Compact storage of archive entries.
+// Each attribute is stored in its own contiguous array, names, contents
+// and paths are stored in a shared string arena. The behavior of an
+// entry is selected by its type instead of a virtual function table.
+// Raw copies of entries from other archives keep their source and
+// compression method in a side table, so other entries do not pay for it.
+// Files are compressed using the compression selected when they are added.
+class entry_table
+{
+    entry_table(entry_table const &) = delete;
+    entry_table& operator=(entry_table const &) = delete;
+public:
+    // fixed memory per entry, not including strings stored in the arena
+    static constexpr size_t const bytes_per_entry =
+        sizeof(entry_type) + sizeof(uint8_t) + sizeof(uint16_t) + 2 * sizeof(uint64_t) + 5 * sizeof(uint32_t);
+
+    entry_table() = default;
+    ~entry_table() = default;
+    entry_table(entry_table &&) = default;
+    entry_table& operator=(entry_table &&) = default;
+
+    size_t add_directory(std::string_view name);
+    size_t add_file_with_content(std::string_view name, std::string_view content);
+    size_t add_file_from_path(std::string_view name, std::string_view path, std::optional<uint64_t> size = std::nullopt);
+    uint32_t add_source(std::shared_ptr<reader const> source);
+    size_t add_raw_copy(std::string_view name, uint32_t source, size_t source_index);
+
+    // applies to files added afterwards; the level applies to all entries
+    void set_compression(zipstream::compression backend, int level = -1);
+    zipstream::compression compression() const;
+    int compression_level() const;
+    void set_policy(compression_policy const & policy);
+    compression_policy const * policy() const;
+
+    size_t count() const;
+    void clear();
+    void reserve(size_t count);
+    void shrink_to_fit();
+    // the entry at order[i] becomes entry i
+    void reorder(std::vector<size_t> const & order);
+    size_t memory_usage() const;
+    size_t max_name_length() const;
+
+    entry_type type(size_t index) const;
+    std::string_view name(size_t index) const;
+    uint32_t size(size_t index);
+    uint32_t compressed_size(size_t index);
+    uint16_t compression_method(size_t index) const;
+    zipstream::compression compression(size_t index) const;
+    // true if the compression was selected by file extension
+    bool compression_forced(size_t index) const;
+    void set_stored(size_t index);
+    void set_compressed_size(size_t index, uint32_t value);
+    void set_known_compressed_size(size_t index, uint32_t value);
+    bool data_descriptor_needed(size_t index) const;
+    uint32_t crc32(size_t index) const;
+    void set_crc32(size_t index, uint32_t value);
+    void set_known_crc32(size_t index, uint32_t value);
+    uint32_t offset(size_t index) const;
+    void set_offset(size_t index, uint32_t value);
+
+    size_t read_at(size_t index, size_t offset, char * buffer, size_t buffer_size);
+
+    // holes of sparse files are found using SEEK_DATA and SEEK_HOLE,
+    // all other data is reported as a single extent
+    file_extent extent_at(size_t index, size_t offset);
+
+    // source file of file_from_path entries
+    char const * path(size_t index) const;
+
+private:
+    size_t add(entry_type type, std::string_view name, uint64_t data_pos, uint32_t data_length,
+        uint32_t size, std::optional<uint32_t> crc32);
+
+    struct raw_entry
+    {
+        uint64_t data_offset;
+        uint32_t source;
+        uint16_t compression_method;
+    };
+
+    std::vector<entry_type> m_type;
+    std::vector<uint8_t> m_flags;
+    std::vector<uint16_t> m_name_length;
+    std::vector<uint64_t> m_name_pos;
+    std::vector<uint64_t> m_data_pos;
+    std::vector<uint32_t> m_data_length;
+    std::vector<uint32_t> m_size;
+    std::vector<uint32_t> m_compressed_size;
+    std::vector<uint32_t> m_crc32;
+    std::vector<uint32_t> m_offset;
+    string_arena m_strings;
+    std::vector<raw_entry> m_raw;
+    std::vector<std::shared_ptr<reader const>> m_sources;
+    zipstream::compression m_compression = zipstream::compression::store;
+    int m_compression_level = -1;
+    std::optional<compression_policy> m_policy;
+};
+
+}
+
+#endif
@@ -1,14 +1,17 @@
 #ifndef ZIPSTREAM_ENTRY_TYPE_HPP
 #define ZIPSTREAM_ENTRY_TYPE_HPP
 
+#include <cinttypes>
+
 namespace zipstream
 {
 
-enum class entry_type
+enum class entry_type: uint8_t
 {
     directory,
     file_with_content,
-    file_from_path
+    file_from_path,
+    raw_copy
 };
 
 }
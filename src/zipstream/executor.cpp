@@ -0,0 +1,579 @@
+#include <zipstream/executor.hpp>
+#include "zipstream/buffer_pool.hpp"
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace zipstream
+{
+
+namespace
+{
+
+// upper bound of a single wait; wake-ups are signaled explicitly
+constexpr auto const wait_interval = std::chrono::milliseconds(100);
+
+// sinks without a descriptor are retried at this interval
+constexpr int const retry_interval_ms = 10;
+constexpr int const poll_interval_ms = 100;
+constexpr size_t const max_events = 256;
+
+struct task
+{
+    std::unique_ptr<stream_i> stream;
+    std::unique_ptr<sink_i> sink;
+    executor::completion done;
+    std::optional<pooled_buffer> buffer;
+    size_t account = 0;
+    // bytes accounted to the executor's memory usage
+    size_t charge = 0;
+    // bytes of the buffer not yet accepted by the sink
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+using task_ptr = std::unique_ptr<task>;
+
+// queue of a worker; the owner takes from the front, thieves from the back
+class work_queue
+{
+public:
+    void push(task_ptr item)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(item));
+    }
+
+    task_ptr pop_front()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return take(m_tasks.begin());
+    }
+
+    task_ptr pop_back()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return (m_tasks.empty()) ? nullptr : take(std::prev(m_tasks.end()));
+    }
+
+private:
+    task_ptr take(std::deque<task_ptr>::iterator it)
+    {
+        if (m_tasks.empty())
+        {
+            return nullptr;
+        }
+
+        task_ptr result = std::move(*it);
+        m_tasks.erase(it);
+        return result;
+    }
+
+    std::mutex m_mutex;
+    std::deque<task_ptr> m_tasks;
+};
+
+}
+
+class executor::detail
+{
+public:
+    explicit detail(executor_options const & options)
+    : options(options)
+    , queued(0)
+    , stopping(false)
+    , memory_used(0)
+    , active(0)
+    , epoll_fd(-1)
+    , wake_fd{-1, -1}
+    {
+        if (this->options.worker_count == 0)
+        {
+            this->options.worker_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if ((epoll_fd < 0) || (0 != pipe2(wake_fd, O_NONBLOCK | O_CLOEXEC)))
+        {
+            close_descriptors();
+            throw std::runtime_error("failed to create executor");
+        }
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd[0], &event);
+
+        for(size_t i = 0; i < this->options.worker_count; i++)
+        {
+            queues.push_back(std::make_unique<work_queue>());
+        }
+        ticks.resize(this->options.worker_count, 0);
+        for(size_t i = 0; i < this->options.worker_count; i++)
+        {
+            workers.emplace_back([this, i]() { work(i); });
+        }
+        poller = std::thread([this]() { poll(); });
+    }
+
+    ~detail()
+    {
+        stopping = true;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        cond.notify_all();
+        wake();
+        for(auto & worker: workers)
+        {
+            worker.join();
+        }
+        poller.join();
+
+        std::vector<task_ptr> remaining;
+        for(auto & queue: queues)
+        {
+            for(auto item = queue->pop_front(); item; item = queue->pop_front())
+            {
+                remaining.push_back(std::move(item));
+            }
+        }
+        for(auto * pending: {&injected, &memory_waiters})
+        {
+            for(auto & item: *pending)
+            {
+                remaining.push_back(std::move(item));
+            }
+            pending->clear();
+        }
+        for(auto & item: parked)
+        {
+            remaining.push_back(std::move(item.second));
+        }
+        parked.clear();
+
+        auto const error = std::make_exception_ptr(std::runtime_error("executor stopped"));
+        for(auto & item: remaining)
+        {
+            complete(std::move(item), error);
+        }
+
+        close_descriptors();
+    }
+
+    void close_descriptors()
+    {
+        for(int fd: {epoll_fd, wake_fd[0], wake_fd[1]})
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+    }
+
+    void submit(task_ptr item)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            active++;
+        }
+        inject(std::move(item));
+    }
+
+    void inject(task_ptr item)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            injected.push_back(std::move(item));
+            queued++;
+        }
+        cond.notify_one();
+    }
+
+    // alternates between the own queue and new or resumed streams, so
+    // neither starves the other; other queues are taken from last
+    task_ptr next_task(size_t self)
+    {
+        bool const injected_first = ((ticks[self]++ % 2) == 0);
+        task_ptr result = (injected_first) ? pop_injected() : queues[self]->pop_front();
+        if (!result)
+        {
+            result = (injected_first) ? queues[self]->pop_front() : pop_injected();
+        }
+
+        for(size_t i = 1; (!result) && (i < queues.size()); i++)
+        {
+            result = queues[(self + i) % queues.size()]->pop_back();
+        }
+
+        if (result)
+        {
+            queued--;
+        }
+        return result;
+    }
+
+    task_ptr pop_injected()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (injected.empty())
+        {
+            return nullptr;
+        }
+
+        task_ptr result = std::move(injected.front());
+        injected.pop_front();
+        return result;
+    }
+
+    void work(size_t self)
+    {
+        while (!stopping)
+        {
+            task_ptr item = next_task(self);
+            if (!item)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait_for(lock, wait_interval, [this]() { return (queued > 0) || stopping; });
+                continue;
+            }
+
+            run(self, std::move(item));
+        }
+    }
+
+    // runs a stream for one time slice
+    void run(size_t self, task_ptr item)
+    {
+        if ((!item->buffer) && (!reserve(item)))
+        {
+            return;
+        }
+
+        enum class outcome { yield, park, done };
+        outcome result;
+        try
+        {
+            auto const deadline = std::chrono::steady_clock::now() + options.slice_time;
+            char * const data = item->buffer->data();
+            size_t written = 0;
+            while (true)
+            {
+                if ((written >= options.slice_size) || (std::chrono::steady_clock::now() >= deadline))
+                {
+                    result = outcome::yield;
+                    break;
+                }
+
+                if (item->begin == item->end)
+                {
+                    item->begin = 0;
+                    item->end = item->stream->read(data, item->buffer->size());
+                    if (item->end == 0)
+                    {
+                        item->sink->finish();
+                        result = outcome::done;
+                        break;
+                    }
+                }
+
+                size_t const count = item->sink->write(&data[item->begin], item->end - item->begin);
+                if (count == 0)
+                {
+                    result = outcome::park;
+                    break;
+                }
+                item->begin += count;
+                written += count;
+            }
+        }
+        catch (...)
+        {
+            complete(std::move(item), std::current_exception());
+            return;
+        }
+
+        if (result != outcome::done)
+        {
+            recharge(*item);
+        }
+
+        switch (result)
+        {
+            case outcome::yield:
+                if (item->begin == item->end)
+                {
+                    release(*item);
+                }
+                queues[self]->push(std::move(item));
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    queued++;
+                }
+                cond.notify_one();
+                break;
+            case outcome::park:
+                park(std::move(item));
+                break;
+            default:
+                complete(std::move(item), nullptr);
+                break;
+        }
+    }
+
+    // memory of a stream including its staging buffer
+    size_t demand(task const & item) const
+    {
+        return options.buffer_size + item.stream->memory_usage();
+    }
+
+    // streams holding a buffer are limited globally; one stream may always run
+    bool reserve(task_ptr & item)
+    {
+        size_t const needed = demand(*item);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if ((memory_used > 0) && ((memory_used + needed) > options.memory_limit))
+            {
+                memory_waiters.push_back(std::move(item));
+                return false;
+            }
+            memory_used += needed;
+            item->charge = needed;
+        }
+
+        item->buffer.emplace(buffer_pool::instance().acquire(options.buffer_size, item->account));
+        return true;
+    }
+
+    // streams grow while they run, e.g. by their central directory
+    void recharge(task & item)
+    {
+        size_t const needed = demand(item);
+        std::lock_guard<std::mutex> lock(mutex);
+        memory_used = memory_used - item.charge + needed;
+        item.charge = needed;
+    }
+
+    void release(task & item)
+    {
+        if (!item.buffer)
+        {
+            return;
+        }
+
+        item.buffer.reset();
+        item.begin = 0;
+        item.end = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            memory_used -= item.charge;
+            item.charge = 0;
+            if (memory_waiters.empty())
+            {
+                return;
+            }
+
+            injected.push_back(std::move(memory_waiters.front()));
+            memory_waiters.pop_front();
+            queued++;
+        }
+        cond.notify_one();
+    }
+
+    void complete(task_ptr item, std::exception_ptr error)
+    {
+        release(*item);
+        int const fd = (item->sink) ? item->sink->descriptor() : -1;
+        if (fd >= 0)
+        {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        }
+
+        auto done = std::move(item->done);
+        item.reset();
+        if (done)
+        {
+            done(error);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            active--;
+        }
+        idle.notify_all();
+    }
+
+    // waits for the sink to become writable; the staging buffer is kept
+    void park(task_ptr item)
+    {
+        int const fd = item->sink->descriptor();
+        task * const key = item.get();
+
+        std::lock_guard<std::mutex> lock(park_mutex);
+        parked[key] = std::move(item);
+
+        epoll_event event = {};
+        event.events = EPOLLOUT | EPOLLONESHOT;
+        event.data.ptr = key;
+        bool const polled = (fd >= 0)
+            && ((0 == epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event))
+                || (0 == epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event)));
+        if (!polled)
+        {
+            // e.g. no descriptor or a regular file
+            unpolled.push_back(key);
+            if (unpolled.size() == 1)
+            {
+                wake();
+            }
+        }
+    }
+
+    void wake()
+    {
+        // a full pipe already wakes the poller
+        char const signal = 1;
+        ssize_t const result = write(wake_fd[1], &signal, 1);
+        (void) result;
+    }
+
+    void poll()
+    {
+        std::vector<epoll_event> events(max_events);
+        auto last_retry = std::chrono::steady_clock::now();
+        while (!stopping)
+        {
+            int timeout;
+            {
+                std::lock_guard<std::mutex> lock(park_mutex);
+                timeout = (unpolled.empty()) ? poll_interval_ms : retry_interval_ms;
+            }
+
+            int const count = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), timeout);
+            std::vector<task_ptr> ready;
+            {
+                std::lock_guard<std::mutex> lock(park_mutex);
+                for(int i = 0; i < count; i++)
+                {
+                    if (events[i].data.ptr == nullptr)
+                    {
+                        char signals[64];
+                        while (read(wake_fd[0], signals, sizeof(signals)) > 0) { }
+                        continue;
+                    }
+
+                    auto const it = parked.find(static_cast<task *>(events[i].data.ptr));
+                    if (it != parked.end())
+                    {
+                        ready.push_back(std::move(it->second));
+                        parked.erase(it);
+                    }
+                }
+
+                auto const now = std::chrono::steady_clock::now();
+                if ((now - last_retry) >= std::chrono::milliseconds(retry_interval_ms))
+                {
+                    last_retry = now;
+                    for(auto * key: unpolled)
+                    {
+                        auto const it = parked.find(key);
+                        ready.push_back(std::move(it->second));
+                        parked.erase(it);
+                    }
+                    unpolled.clear();
+                }
+            }
+
+            for(auto & item: ready)
+            {
+                inject(std::move(item));
+            }
+        }
+    }
+
+    executor_options options;
+    std::vector<std::unique_ptr<work_queue>> queues;
+    // scheduling rounds of each worker, only touched by the worker itself
+    std::vector<size_t> ticks;
+    std::vector<std::thread> workers;
+    std::thread poller;
+    std::atomic<size_t> queued;
+    std::atomic<bool> stopping;
+
+    // new and resumed streams, memory accounting and completion
+    mutable std::mutex mutex;
+    std::condition_variable cond;
+    std::condition_variable idle;
+    std::deque<task_ptr> injected;
+    std::deque<task_ptr> memory_waiters;
+    size_t memory_used;
+    size_t active;
+
+    // streams waiting for their sinks
+    std::mutex park_mutex;
+    std::unordered_map<task *, task_ptr> parked;
+    std::vector<task *> unpolled;
+    int epoll_fd;
+    int wake_fd[2];
+};
+
+executor::executor(executor_options const & options)
+: d(new detail(options))
+{
+}
+
+executor::~executor()
+{
+    delete d;
+}
+
+void executor::submit(std::unique_ptr<stream_i> stream, std::unique_ptr<sink_i> sink, completion done)
+{
+    if ((!stream) || (!sink))
+    {
+        throw std::runtime_error("invalid stream");
+    }
+
+    auto item = std::make_unique<task>();
+    item->stream = std::move(stream);
+    item->sink = std::move(sink);
+    item->done = std::move(done);
+    d->submit(std::move(item));
+}
+
+void executor::wait()
+{
+    std::unique_lock<std::mutex> lock(d->mutex);
+    while (d->active > 0)
+    {
+        d->idle.wait_for(lock, wait_interval);
+    }
+}
+
+size_t executor::active() const
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+    return d->active;
+}
+
+size_t executor::memory_usage() const
+{
+    std::lock_guard<std::mutex> lock(d->mutex);
+    return d->memory_used;
+}
+
+}
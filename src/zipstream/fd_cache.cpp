@@ -0,0 +1,171 @@
+#include "zipstream/fd_cache.hpp"
+#include <zipstream/descriptors.hpp>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <stdexcept>
+
+namespace zipstream
+{
+
+file_descriptor::file_descriptor(int fd, uint64_t device, uint64_t inode)
+: m_fd(fd)
+, m_device(device)
+, m_inode(inode)
+{
+
+}
+
+file_descriptor::~file_descriptor()
+{
+    close(m_fd);
+}
+
+int file_descriptor::get() const
+{
+    return m_fd;
+}
+
+uint64_t file_descriptor::device() const
+{
+    return m_device;
+}
+
+uint64_t file_descriptor::inode() const
+{
+    return m_inode;
+}
+
+size_t file_descriptor::read_at(size_t offset, char * buffer, size_t buffer_size) const
+{
+    size_t count = 0;
+    while (count < buffer_size)
+    {
+        ssize_t const bytes_read = pread(m_fd, &buffer[count], buffer_size - count,
+            static_cast<off_t>(offset + count));
+        if (bytes_read < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::runtime_error("failed to read file");
+        }
+
+        if (bytes_read == 0)
+        {
+            break;
+        }
+        count += static_cast<size_t>(bytes_read);
+    }
+
+    return count;
+}
+
+fd_cache & fd_cache::instance()
+{
+    static fd_cache cache(default_limit);
+    return cache;
+}
+
+fd_cache::fd_cache(size_t limit)
+: m_limit(limit)
+{
+
+}
+
+void fd_cache::set_limit(size_t limit)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_limit = limit;
+    trim();
+}
+
+size_t fd_cache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lru.size();
+}
+
+std::shared_ptr<file_descriptor const> fd_cache::open(char const * path)
+{
+    // system calls are made without holding the lock
+    struct stat info;
+    if (0 != stat(path, &info))
+    {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto const it = m_index.find(path);
+        if (it != m_index.end())
+        {
+            auto const & descriptor = it->second->second;
+            if ((descriptor->device() == static_cast<uint64_t>(info.st_dev))
+                && (descriptor->inode() == static_cast<uint64_t>(info.st_ino)))
+            {
+                m_lru.splice(m_lru.begin(), m_lru, it->second);
+                return descriptor;
+            }
+        }
+    }
+
+    int const fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    // the path may have been replaced since stat
+    struct stat opened;
+    if (0 != fstat(fd, &opened))
+    {
+        close(fd);
+        return nullptr;
+    }
+    auto descriptor = std::make_shared<file_descriptor const>(fd, static_cast<uint64_t>(opened.st_dev),
+        static_cast<uint64_t>(opened.st_ino));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto const it = m_index.find(path);
+    if (it != m_index.end())
+    {
+        // replaced file, or opened by another thread meanwhile
+        it->second->second = descriptor;
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+    }
+    else if (m_limit > 0)
+    {
+        m_lru.emplace_front(path, descriptor);
+        m_index[m_lru.front().first] = m_lru.begin();
+        trim();
+    }
+
+    return descriptor;
+}
+
+// descriptors still in use are closed by their last user
+void fd_cache::trim()
+{
+    while (m_lru.size() > m_limit)
+    {
+        m_index.erase(m_lru.back().first);
+        m_lru.pop_back();
+    }
+}
+
+void set_descriptor_limit(size_t limit)
+{
+    fd_cache::instance().set_limit(limit);
+}
+
+size_t get_cached_descriptors()
+{
+    return fd_cache::instance().size();
+}
+
+}
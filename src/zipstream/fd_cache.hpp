@@ -0,0 +1,73 @@
+#ifndef ZIPSTREAM_FD_CACHE_HPP
+#define ZIPSTREAM_FD_CACHE_HPP
+
+#include <cinttypes>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace zipstream
+{
+
+// Read-only descriptor of a file; closed when the last user releases it.
+class file_descriptor
+{
+    file_descriptor(file_descriptor const &) = delete;
+    file_descriptor& operator=(file_descriptor const &) = delete;
+public:
+    file_descriptor(int fd, uint64_t device, uint64_t inode);
+    ~file_descriptor();
+
+    int get() const;
+    uint64_t device() const;
+    uint64_t inode() const;
+
+    // reads until buffer_size bytes or the end of the file
+    size_t read_at(size_t offset, char * buffer, size_t buffer_size) const;
+
+private:
+    int m_fd;
+    uint64_t m_device;
+    uint64_t m_inode;
+};
+
+// Thread-safe cache of descriptors shared by all streams.
+// Descriptors are keyed by path and validated against the device and
+// inode of the path on each lookup, so a replaced file is opened again;
+// streams still reading the old file keep their descriptor. Reads use
+// pread, so a descriptor is used by several streams at once. At most
+// limit descriptors are kept, the least recently used one is closed first.
+class fd_cache
+{
+    fd_cache(fd_cache const &) = delete;
+    fd_cache& operator=(fd_cache const &) = delete;
+public:
+    static constexpr size_t const default_limit = 256;
+
+    static fd_cache & instance();
+
+    explicit fd_cache(size_t limit);
+    ~fd_cache() = default;
+
+    void set_limit(size_t limit);
+    size_t size() const;
+
+    // returns nullptr if the file cannot be opened
+    std::shared_ptr<file_descriptor const> open(char const * path);
+
+private:
+    using lru_list = std::list<std::pair<std::string, std::shared_ptr<file_descriptor const>>>;
+    void trim();
+
+    mutable std::mutex m_mutex;
+    size_t m_limit;
+    lru_list m_lru;
+    std::unordered_map<std::string, lru_list::iterator> m_index;
+};
+
+}
+
+#endif
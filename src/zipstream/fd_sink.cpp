@@ -0,0 +1,110 @@
+#include "zipstream/fd_sink.hpp"
+#include "zipstream/fd_writer.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace zipstream
+{
+
+namespace
+{
+
+constexpr size_t const direct_buffer_size = 256 * 1024;
+
+}
+
+std::unique_ptr<sink_i> make_fd_sink(int fd)
+{
+    return std::unique_ptr<sink_i>(new fd_sink(fd));
+}
+
+fd_sink::fd_sink(int fd)
+: m_fd(fd)
+, m_flags(fcntl(fd, F_GETFL))
+, m_pooled(0)
+, m_used(0)
+{
+    if ((m_flags < 0) || (0 == (m_flags & O_DIRECT)))
+    {
+        return;
+    }
+
+    off_t const offset = lseek(m_fd, 0, SEEK_CUR);
+    if ((offset < 0) || ((static_cast<size_t>(offset) % buffer_pool::buffer_alignment) != 0))
+    {
+        // unaligned offsets are written through the page cache
+        set_direct(false);
+        return;
+    }
+
+    m_buffer.emplace(buffer_pool::instance().acquire(direct_buffer_size, m_pooled));
+}
+
+fd_sink::~fd_sink()
+{
+    // the descriptor is handed back as it was
+    if ((m_flags >= 0) && (fcntl(m_fd, F_GETFL) != m_flags))
+    {
+        fcntl(m_fd, F_SETFL, m_flags);
+    }
+}
+
+size_t fd_sink::write(char const * data, size_t size)
+{
+    if (!m_buffer)
+    {
+        iovec const part{const_cast<char *>(data), size};
+        return write_some(m_fd, &part, 1);
+    }
+
+    // buffer sizes are multiples of the alignment
+    size_t const count = std::min(size, m_buffer->size() - m_used);
+    std::memcpy(m_buffer->data() + m_used, data, count);
+    m_used += count;
+    if (m_used == m_buffer->size())
+    {
+        write_all(m_fd, m_buffer->data(), m_used);
+        m_used = 0;
+    }
+
+    return count;
+}
+
+void fd_sink::finish()
+{
+    if (!m_buffer)
+    {
+        return;
+    }
+
+    size_t const tail_size = m_used % buffer_pool::buffer_alignment;
+    write_all(m_fd, m_buffer->data(), m_used - tail_size);
+    if (tail_size > 0)
+    {
+        set_direct(false);
+        write_all(m_fd, m_buffer->data() + (m_used - tail_size), tail_size);
+    }
+
+    m_used = 0;
+    m_buffer.reset();
+}
+
+int fd_sink::descriptor() const
+{
+    return m_fd;
+}
+
+void fd_sink::set_direct(bool enabled)
+{
+    int const flags = fcntl(m_fd, F_GETFL);
+    if (flags >= 0)
+    {
+        fcntl(m_fd, F_SETFL, (enabled) ? (flags | O_DIRECT) : (flags & ~O_DIRECT));
+    }
+}
+
+}
@@ -0,0 +1,38 @@
+#ifndef ZIPSTREAM_FD_SINK_HPP
+#define ZIPSTREAM_FD_SINK_HPP
+
+#include "zipstream/buffer_pool.hpp"
+#include <zipstream/sink_i.hpp>
+
+#include <optional>
+
+namespace zipstream
+{
+
+// Writes to a descriptor. With O_DIRECT, data is collected in an
+// aligned pooled buffer and written in whole buffers; finish writes
+// the rest, the unaligned tail with O_DIRECT cleared.
+class fd_sink: public sink_i
+{
+    fd_sink(fd_sink const &) = delete;
+    fd_sink& operator=(fd_sink const &) = delete;
+public:
+    explicit fd_sink(int fd);
+    ~fd_sink() override;
+    size_t write(char const * data, size_t size) override;
+    void finish() override;
+    int descriptor() const override;
+
+private:
+    void set_direct(bool enabled);
+
+    int m_fd;
+    int m_flags;
+    size_t m_pooled;
+    std::optional<pooled_buffer> m_buffer;
+    size_t m_used;
+};
+
+}
+
+#endif
@@ -0,0 +1,325 @@
+#include "zipstream/fd_writer.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+namespace zipstream
+{
+
+namespace
+{
+
+constexpr size_t const chunk_size = 64 * 1024;
+constexpr size_t const chunk_count = 4;
+
+// offsets, sizes and addresses of direct writes are multiples of it
+constexpr size_t const direct_alignment = buffer_pool::buffer_alignment;
+
+void wait_writable(int fd)
+{
+    pollfd entry = {};
+    entry.fd = fd;
+    entry.events = POLLOUT;
+    while ((poll(&entry, 1, -1) < 0) && (errno == EINTR)) { }
+}
+
+// bytes written, or -1 on errors other than EINTR
+ssize_t write_parts(int fd, iovec const * parts, size_t count)
+{
+    ssize_t written;
+    do
+    {
+        written = (count == 1)
+            ? ::write(fd, parts[0].iov_base, parts[0].iov_len)
+            : ::writev(fd, parts, static_cast<int>(count));
+    }
+    while ((written < 0) && (errno == EINTR));
+
+    return written;
+}
+
+bool is_aligned(size_t value)
+{
+    return (value % direct_alignment) == 0;
+}
+
+}
+
+size_t write_some(int fd, iovec const * parts, size_t count)
+{
+    ssize_t const written = write_parts(fd, parts, count);
+    if (written >= 0)
+    {
+        return static_cast<size_t>(written);
+    }
+
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+    {
+        return 0;
+    }
+
+    throw std::runtime_error("failed to write to descriptor");
+}
+
+void write_all(int fd, char const * data, size_t size)
+{
+    size_t pos = 0;
+    while (pos < size)
+    {
+        iovec const part{const_cast<char *>(&data[pos]), size - pos};
+        size_t const written = write_some(fd, &part, 1);
+        if (written == 0)
+        {
+            wait_writable(fd);
+        }
+        pos += written;
+    }
+}
+
+void write_to_path(stream_i & stream, std::string const & path, write_mode mode)
+{
+    int const flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    int fd = (mode == write_mode::direct) ? open(path.c_str(), flags | O_DIRECT, 0666) : -1;
+    if (fd < 0)
+    {
+        // e.g. O_DIRECT is not supported by the filesystem
+        fd = open(path.c_str(), flags, 0666);
+    }
+    if (fd < 0)
+    {
+        throw std::runtime_error("failed to open file");
+    }
+
+    try
+    {
+        stream.write_to_fd(fd);
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+
+    // delayed write errors are reported by close
+    if (0 != close(fd))
+    {
+        throw std::runtime_error("failed to write file");
+    }
+}
+
+fd_writer::fd_writer(int fd, size_t & account)
+: m_fd(fd)
+, m_flags(fcntl(fd, F_GETFL))
+, m_direct((m_flags >= 0) && (0 != (m_flags & O_DIRECT)))
+, m_write_count(0)
+{
+    for(size_t i = 0; i < chunk_count; i++)
+    {
+        m_chunks.push_back(buffer_pool::instance().acquire(chunk_size, account));
+    }
+    m_parts.reserve(chunk_count);
+
+    if (m_direct)
+    {
+        off_t const offset = lseek(m_fd, 0, SEEK_CUR);
+        if ((offset < 0) || (!is_aligned(static_cast<size_t>(offset))))
+        {
+            set_direct(false);
+        }
+    }
+}
+
+fd_writer::~fd_writer()
+{
+    // the descriptor is handed back as it was
+    if ((m_flags >= 0) && (fcntl(m_fd, F_GETFL) != m_flags))
+    {
+        fcntl(m_fd, F_SETFL, m_flags);
+    }
+}
+
+void fd_writer::preallocate(size_t size)
+{
+    struct stat info;
+    if ((size == 0) || (0 != fstat(m_fd, &info)) || (!S_ISREG(info.st_mode)))
+    {
+        return;
+    }
+
+    off_t const offset = lseek(m_fd, 0, SEEK_CUR);
+    if ((offset < 0) || (size > static_cast<size_t>(std::numeric_limits<off_t>::max() - offset)))
+    {
+        return;
+    }
+
+    // the size of the file is left alone, in case the stream turns out shorter;
+    // filesystems without support simply allocate while writing
+    int result;
+    do
+    {
+        result = fallocate(m_fd, FALLOC_FL_KEEP_SIZE, offset, static_cast<off_t>(size));
+    }
+    while ((result != 0) && (errno == EINTR));
+}
+
+void fd_writer::write(stream_i & stream)
+{
+    size_t chunk = 0;
+    size_t used = 0;
+    while (true)
+    {
+        char * const data = m_chunks[chunk].data() + used;
+        size_t const requested = m_chunks[chunk].size() - used;
+        size_t const count = stream.read(data, requested);
+        if (count == 0)
+        {
+            break;
+        }
+
+        // consecutive reads into a chunk form a single part
+        if ((used > 0) && (!m_parts.empty()))
+        {
+            m_parts.back().iov_len += count;
+        }
+        else
+        {
+            m_parts.push_back(iovec{data, count});
+        }
+        used += count;
+
+        if (used == m_chunks[chunk].size())
+        {
+            chunk++;
+            used = 0;
+        }
+
+        // a short read means the stream has no more data at hand for now;
+        // direct writes wait for whole chunks instead
+        if ((chunk == m_chunks.size()) || ((count < requested) && (!m_direct)))
+        {
+            flush();
+            chunk = 0;
+            used = 0;
+        }
+    }
+
+    flush_tail();
+}
+
+size_t fd_writer::write_count() const
+{
+    return m_write_count;
+}
+
+bool fd_writer::direct() const
+{
+    return m_direct;
+}
+
+void fd_writer::flush()
+{
+    size_t first = 0;
+    while (first < m_parts.size())
+    {
+        if ((m_direct) && (!parts_aligned(first)))
+        {
+            set_direct(false);
+        }
+
+        ssize_t const result = write_parts(m_fd, &m_parts[first], m_parts.size() - first);
+        m_write_count++;
+        if ((result < 0) && (m_direct) && (errno == EINVAL))
+        {
+            // alignment not accepted by the device
+            set_direct(false);
+            continue;
+        }
+
+        if ((result < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK))
+        {
+            throw std::runtime_error("failed to write to descriptor");
+        }
+
+        if (result <= 0)
+        {
+            wait_writable(m_fd);
+            continue;
+        }
+
+        size_t written = static_cast<size_t>(result);
+
+        // skip the parts written completely and trim the partial one
+        while ((first < m_parts.size()) && (written >= m_parts[first].iov_len))
+        {
+            written -= m_parts[first].iov_len;
+            first++;
+        }
+        if (written > 0)
+        {
+            m_parts[first].iov_base = static_cast<char *>(m_parts[first].iov_base) + written;
+            m_parts[first].iov_len -= written;
+        }
+    }
+
+    m_parts.clear();
+}
+
+// writes the aligned part directly and the remainder through the page cache
+void fd_writer::flush_tail()
+{
+    if ((!m_direct) || (m_parts.empty()))
+    {
+        flush();
+        return;
+    }
+
+    // all parts but the last one are whole chunks
+    iovec & last = m_parts.back();
+    size_t const tail_size = last.iov_len % direct_alignment;
+    iovec const tail{static_cast<char *>(last.iov_base) + (last.iov_len - tail_size), tail_size};
+    last.iov_len -= tail_size;
+    if (last.iov_len == 0)
+    {
+        m_parts.pop_back();
+    }
+    flush();
+
+    if (tail_size > 0)
+    {
+        set_direct(false);
+        m_parts.push_back(tail);
+        flush();
+    }
+}
+
+void fd_writer::set_direct(bool enabled)
+{
+    int const flags = fcntl(m_fd, F_GETFL);
+    if (flags >= 0)
+    {
+        fcntl(m_fd, F_SETFL, (enabled) ? (flags | O_DIRECT) : (flags & ~O_DIRECT));
+    }
+    m_direct = enabled;
+}
+
+bool fd_writer::parts_aligned(size_t first) const
+{
+    for(size_t i = first; i < m_parts.size(); i++)
+    {
+        if ((!is_aligned(reinterpret_cast<uintptr_t>(m_parts[i].iov_base))) || (!is_aligned(m_parts[i].iov_len)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
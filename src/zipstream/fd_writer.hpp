@@ -0,0 +1,68 @@
+#ifndef ZIPSTREAM_FD_WRITER_HPP
+#define ZIPSTREAM_FD_WRITER_HPP
+
+#include "zipstream/buffer_pool.hpp"
+#include <zipstream/stream_i.hpp>
+
+#include <sys/uio.h>
+
+#include <string>
+#include <vector>
+
+namespace zipstream
+{
+
+// writes as much of the parts as the descriptor accepts; 0 if the
+// descriptor is not ready (EAGAIN)
+size_t write_some(int fd, iovec const * parts, size_t count);
+
+// writes all of data, waiting for the descriptor if needed
+void write_all(int fd, char const * data, size_t size);
+
+// opens or replaces the file and writes the stream to it
+void write_to_path(stream_i & stream, std::string const & path, write_mode mode = write_mode::buffered);
+
+// Writes a stream to a file, pipe or socket. Reads of the stream are
+// gathered in pooled chunks, so that runs of small records are written
+// by a single writev once the chunks are full or the stream has no more
+// data at hand. Partial writes are resumed; descriptors that are not
+// ready are waited for.
+//
+// Descriptors opened with O_DIRECT are only written whole aligned
+// chunks; the unaligned tail of the stream is written with O_DIRECT
+// cleared. Direct I/O is given up if the descriptor rejects it.
+class fd_writer
+{
+    fd_writer(fd_writer const &) = delete;
+    fd_writer& operator=(fd_writer const &) = delete;
+public:
+    fd_writer(int fd, size_t & account);
+    ~fd_writer();
+
+    // reserves disk space of a regular file for size more bytes
+    void preallocate(size_t size);
+
+    void write(stream_i & stream);
+
+    // number of writes issued to the descriptor
+    size_t write_count() const;
+
+    bool direct() const;
+
+private:
+    void flush();
+    void flush_tail();
+    void set_direct(bool enabled);
+    bool parts_aligned(size_t first) const;
+
+    int m_fd;
+    int m_flags;
+    bool m_direct;
+    std::vector<pooled_buffer> m_chunks;
+    std::vector<iovec> m_parts;
+    size_t m_write_count;
+};
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include "zipstream/level_controller.hpp"
+
+#include <stdexcept>
+
+namespace zipstream
+{
+
+level_controller::level_controller(int min_level, int max_level)
+: m_min_level(min_level)
+, m_max_level(max_level)
+, m_level(min_level + ((max_level - min_level) / 2))
+, m_busy(0.0)
+, m_idle(0.0)
+, m_started(false)
+{
+    if ((min_level < 0) || (min_level > max_level))
+    {
+        throw std::runtime_error("invalid compression level range");
+    }
+}
+
+int level_controller::level() const
+{
+    return m_level;
+}
+
+void level_controller::begin_read()
+{
+    m_read_start = clock::now();
+}
+
+bool level_controller::end_read()
+{
+    auto const now = clock::now();
+    double const busy = std::chrono::duration<double>(now - m_read_start).count();
+
+    // the time before the first read is no indication of the consumer speed
+    double const idle = (m_started) ? std::chrono::duration<double>(m_read_start - m_read_end).count() : 0.0;
+    m_started = true;
+    m_read_end = now;
+
+    return update(busy, idle);
+}
+
+bool level_controller::update(double busy_seconds, double idle_seconds)
+{
+    m_busy += busy_seconds;
+    m_idle += idle_seconds;
+    double const total = m_busy + m_idle;
+    if (total < window_seconds)
+    {
+        return false;
+    }
+
+    double const utilization = m_busy / total;
+    m_busy = 0.0;
+    m_idle = 0.0;
+
+    int const previous = m_level;
+    if ((utilization > high_utilization) && (m_level > m_min_level))
+    {
+        m_level--;
+    }
+    else if ((utilization < low_utilization) && (m_level < m_max_level))
+    {
+        m_level++;
+    }
+
+    return (m_level != previous);
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef ZIPSTREAM_LEVEL_CONTROLLER_HPP
+#define ZIPSTREAM_LEVEL_CONTROLLER_HPP
+
+#include <chrono>
+
+namespace zipstream
+{
+
+// Adapts the compression level to the speed of the consumer of a stream.
+// The stream reports the time spent in read() producing data (busy) and
+// the time between two calls (idle). If the consumer hardly ever waits,
+// compression is the bottleneck and the level is lowered; if the stream
+// waits for the consumer, there is time to spare and the level is raised.
+// Decisions are made once per window to avoid oscillation.
+class level_controller
+{
+public:
+    static constexpr double const window_seconds = 0.1;
+    static constexpr double const high_utilization = 0.9;
+    static constexpr double const low_utilization = 0.6;
+
+    level_controller(int min_level, int max_level);
+
+    int level() const;
+
+    void begin_read();
+    // returns true if the level changed
+    bool end_read();
+
+    // accounts time explicitly; returns true if the level changed
+    bool update(double busy_seconds, double idle_seconds);
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    int m_min_level;
+    int m_max_level;
+    int m_level;
+    double m_busy;
+    double m_idle;
+    clock::time_point m_read_start;
+    clock::time_point m_read_end;
+    bool m_started;
+};
+
+}
+
+#endif
@@ -0,0 +1,223 @@
+#include "zipstream/live_builder.hpp"
+#include "zipstream/entry_type.hpp"
+#include "zipstream/entry_table.hpp"
+#include "zipstream/mpsc_queue.hpp"
+#include "zipstream/stream.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+
+namespace zipstream
+{
+
+namespace
+{
+
+// upper bound of a single wait; wake-ups are signaled explicitly
+constexpr auto const wait_interval = std::chrono::milliseconds(100);
+
+struct live_entry
+{
+    entry_type type;
+    std::string name;
+    std::string value;
+};
+
+class live_queue
+{
+public:
+    live_queue()
+    : m_finished(false)
+    , m_pushing(0)
+    , m_waiting(false)
+    {
+    }
+
+    // pushes in flight are counted, so that the consumer does not end the
+    // stream between a producer's check of m_finished and its push
+    void push(live_entry && entry)
+    {
+        m_pushing++;
+        if (m_finished)
+        {
+            m_pushing--;
+            throw std::runtime_error("live builder already finished");
+        }
+
+        m_queue.push(std::move(entry));
+        m_pushing--;
+        wake();
+    }
+
+    void finish()
+    {
+        m_finished = true;
+        wake();
+    }
+
+    // called by the consumer only: moves all pending entries to sink
+    bool next(entry_sink_i & sink)
+    {
+        while (true)
+        {
+            bool const finished = m_finished;
+            bool added = false;
+            for(auto entry = m_queue.pop(); entry.has_value(); entry = m_queue.pop())
+            {
+                add(sink, *entry);
+                added = true;
+            }
+
+            if (added)
+            {
+                return true;
+            }
+
+            if (((finished) && (m_pushing == 0) && (m_queue.empty())) || (sink.cancelled()))
+            {
+                return false;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_waiting = true;
+            m_cond.wait_for(lock, wait_interval, [this]() { return (!m_queue.empty()) || m_finished; });
+            m_waiting = false;
+        }
+    }
+
+private:
+    void wake()
+    {
+        if (m_waiting)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cond.notify_one();
+        }
+    }
+
+    static void add(entry_sink_i & sink, live_entry const & entry)
+    {
+        switch (entry.type)
+        {
+            case entry_type::directory:
+                sink.add_directory(entry.name);
+                break;
+            case entry_type::file_with_content:
+                sink.add_file_with_content(entry.name, entry.value);
+                break;
+            case entry_type::file_from_path:
+                sink.add_file_from_path(entry.name, entry.value);
+                break;
+            default:
+                throw std::runtime_error("invalid entry type");
+        }
+    }
+
+    mpsc_queue<live_entry> m_queue;
+    std::atomic<bool> m_finished;
+    std::atomic<size_t> m_pushing;
+    std::atomic<bool> m_waiting;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+};
+
+}
+
+class live_builder::detail
+{
+public:
+    detail()
+    : queue(std::make_shared<live_queue>())
+    , built(false)
+    {
+    }
+
+    std::shared_ptr<live_queue> queue;
+    bool built;
+};
+
+live_builder::live_builder()
+: d(new detail())
+{
+}
+
+live_builder::~live_builder()
+{
+    if (d != nullptr)
+    {
+        d->queue->finish();
+    }
+
+    delete d;
+}
+
+live_builder::live_builder(live_builder && other)
+{
+    if (this != &other)
+    {
+        this->d = other.d;
+        other.d = nullptr;
+    }
+}
+
+live_builder& live_builder::operator=(live_builder && other)
+{
+    if (this != &other)
+    {
+        if (d != nullptr)
+        {
+            d->queue->finish();
+        }
+
+        delete d;
+        this->d = other.d;
+        other.d = nullptr;
+    }
+
+    return *this;
+}
+
+live_builder& live_builder::add_directory(std::string const & name)
+{
+    d->queue->push({entry_type::directory, name, ""});
+
+    return *this;
+}
+
+live_builder& live_builder::add_file_with_content(std::string const & name, std::string const & content)
+{
+    d->queue->push({entry_type::file_with_content, name, content});
+
+    return *this;
+}
+
+live_builder& live_builder::add_file_from_path(std::string const & name, std::string const & path)
+{
+    d->queue->push({entry_type::file_from_path, name, path});
+
+    return *this;
+}
+
+void live_builder::finish()
+{
+    d->queue->finish();
+}
+
+std::unique_ptr<stream_i> live_builder::build()
+{
+    if (d->built)
+    {
+        throw std::runtime_error("live builder already built");
+    }
+    d->built = true;
+
+    auto queue = d->queue;
+    return std::unique_ptr<stream_i>(new stream(entry_table(), [queue](entry_sink_i & sink) {
+        return queue->next(sink);
+    }));
+}
+
+}
@@ -0,0 +1,152 @@
+#include "zipstream/mmap_file.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+namespace zipstream
+{
+
+mmap_file::mmap_file(std::string const & path)
+: fd(-1)
+, size(0)
+, address(nullptr)
+{
+    fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("failed to open file");
+    }
+
+    struct stat info;
+    int const rc = fstat(fd, &info);
+    if (rc != 0)
+    {
+        close(fd);
+        throw std::runtime_error("failed to stat file");
+    }
+    size = info.st_size;
+
+    if (size > 0)
+    {
+        void * const mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("failed to mmap file");
+        }
+        address = reinterpret_cast<uint8_t*>(mapped);
+    }
+}
+
+mmap_file::~mmap_file()
+{
+    unmap();
+}
+
+mmap_file::mmap_file(mmap_file && other)
+: fd(other.fd)
+, size(other.size)
+, address(other.address)
+{
+    other.fd = -1;
+    other.size = 0;
+    other.address = nullptr;
+}
+
+mmap_file& mmap_file::operator=(mmap_file && other)
+{
+    if (this != &other)
+    {
+        unmap();
+
+        this->fd = other.fd;
+        this->address = other.address;
+        this->size = other.size;
+
+        other.fd = -1;
+        other.address = nullptr;
+        other.size = 0;
+    }
+
+    return *this;
+}
+
+uint8_t const * mmap_file::get_address() const
+{
+    return address;
+}
+
+size_t mmap_file::get_size() const
+{
+    return size;
+}
+
+uint16_t mmap_file::read_u16(size_t offset) const
+{
+    check_bounds(offset, 2);
+
+    uint8_t const low = address[offset];
+    uint8_t const high = address[offset + 1];
+
+    return (high << 8) | low;
+}
+
+uint32_t mmap_file::read_u32(size_t offset) const
+{
+    check_bounds(offset, 4);
+
+    uint32_t value = 0;
+    for(size_t i = 0; i < 4; i++)
+    {
+        value <<= 8;
+        value |= address[offset + 3 - i];
+    }
+
+    return value;
+}
+
+uint64_t mmap_file::read_u64(size_t offset) const
+{
+    uint64_t const low = read_u32(offset);
+    uint64_t const high = read_u32(offset + 4);
+
+    return (high << 32) | low;
+}
+
+std::string_view mmap_file::view(size_t offset, size_t length) const
+{
+    check_bounds(offset, length);
+    if (length == 0)
+    {
+        return std::string_view();
+    }
+
+    return std::string_view(reinterpret_cast<char const*>(&address[offset]), length);
+}
+
+void mmap_file::check_bounds(size_t offset, size_t length) const
+{
+    if ((offset > size) || (length > (size - offset)))
+    {
+        throw std::runtime_error("read out of bounds");
+    }
+}
+
+void mmap_file::unmap()
+{
+    if (fd >= 0)
+    {
+        if (address != nullptr)
+        {
+            munmap(address, size);
+        }
+        close(fd);
+    }
+}
+
+}
@@ -0,0 +1,43 @@
+#ifndef ZIPSTREAM_MMAP_FILE_HPP
+#define ZIPSTREAM_MMAP_FILE_HPP
+
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace zipstream
+{
+
+// Read-only memory mapping of a whole file.
+// All accessors check bounds and read little endian values.
+class mmap_file
+{
+    mmap_file(mmap_file const &) = delete;
+    mmap_file& operator=(mmap_file const &) = delete;
+public:
+    explicit mmap_file(std::string const & path);
+    ~mmap_file();
+    mmap_file(mmap_file && other);
+    mmap_file& operator=(mmap_file && other);
+
+    uint8_t const * get_address() const;
+    size_t get_size() const;
+
+    uint16_t read_u16(size_t offset) const;
+    uint32_t read_u32(size_t offset) const;
+    uint64_t read_u64(size_t offset) const;
+    std::string_view view(size_t offset, size_t length) const;
+
+private:
+    void check_bounds(size_t offset, size_t length) const;
+    void unmap();
+
+    int fd;
+    size_t size;
+    uint8_t * address;
+};
+
+}
+
+#endif
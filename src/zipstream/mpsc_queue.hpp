@@ -0,0 +1,117 @@
+#ifndef ZIPSTREAM_MPSC_QUEUE_HPP
+#define ZIPSTREAM_MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace zipstream
+{
+
+// Unbounded lock-free multi producer / single consumer queue
+// (intrusive node based queue as described by Dmitry Vyukov).
+// push may be called from any thread, pop and empty only from
+// the single consumer thread.
+template <typename T>
+class mpsc_queue
+{
+    mpsc_queue(mpsc_queue const &) = delete;
+    mpsc_queue& operator=(mpsc_queue const &) = delete;
+public:
+    mpsc_queue()
+    : m_head(&m_stub)
+    , m_tail(&m_stub)
+    {
+    }
+
+    ~mpsc_queue()
+    {
+        while (pop().has_value()) { }
+    }
+
+    void push(T value)
+    {
+        node * item = new node(std::move(value));
+        node * prev = m_head.exchange(item, std::memory_order_acq_rel);
+        prev->next.store(item, std::memory_order_release);
+    }
+
+    std::optional<T> pop()
+    {
+        node * tail = m_tail;
+        node * next = tail->next.load(std::memory_order_acquire);
+
+        if (tail == &m_stub)
+        {
+            if (next == nullptr)
+            {
+                return std::nullopt;
+            }
+
+            m_tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if (next == nullptr)
+        {
+            if (tail != m_head.load(std::memory_order_acquire))
+            {
+                // a producer is in the middle of push
+                return std::nullopt;
+            }
+
+            m_stub.next.store(nullptr, std::memory_order_relaxed);
+            node * prev = m_head.exchange(&m_stub, std::memory_order_acq_rel);
+            prev->next.store(&m_stub, std::memory_order_release);
+
+            next = tail->next.load(std::memory_order_acquire);
+            if (next == nullptr)
+            {
+                return std::nullopt;
+            }
+        }
+
+        m_tail = next;
+        std::optional<T> result(std::move(*tail->value));
+        delete tail;
+        return result;
+    }
+
+    bool empty() const
+    {
+        node const * tail = m_tail;
+        if (tail == &m_stub)
+        {
+            return (nullptr == tail->next.load(std::memory_order_acquire));
+        }
+
+        return false;
+    }
+
+private:
+    struct node
+    {
+        node()
+        : next(nullptr)
+        {
+        }
+
+        explicit node(T && item)
+        : next(nullptr)
+        , value(std::move(item))
+        {
+        }
+
+        std::atomic<node*> next;
+        std::optional<T> value;
+    };
+
+    std::atomic<node*> m_head;
+    node * m_tail;
+    node m_stub;
+};
+
+}
+
+#endif
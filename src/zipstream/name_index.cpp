@@ -0,0 +1,165 @@
+#include "zipstream/name_index.hpp"
+
+#include <stdexcept>
+
+namespace zipstream
+{
+
+namespace
+{
+
+constexpr size_t const min_slot_count = 16;
+
+void write_u64(std::ostream & stream, uint64_t value)
+{
+    char data[8];
+    for(size_t i = 0; i < 8; i++)
+    {
+        data[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+    stream.write(data, 8);
+}
+
+bool read_u64(std::istream & stream, uint64_t & value)
+{
+    char data[8];
+    if (!stream.read(data, 8))
+    {
+        return false;
+    }
+
+    value = 0;
+    for(size_t i = 8; i > 0; i--)
+    {
+        value = (value << 8) | static_cast<uint8_t>(data[i - 1]);
+    }
+    return true;
+}
+
+}
+
+uint32_t name_index::hash(std::string_view name)
+{
+    // 64 bit FNV-1a folded to 32 bits
+    uint64_t value = 0xcbf29ce484222325;
+    for(char const c: name)
+    {
+        value ^= static_cast<uint8_t>(c);
+        value *= 0x100000001b3;
+    }
+
+    return static_cast<uint32_t>(value ^ (value >> 32));
+}
+
+bool name_index::empty() const
+{
+    return m_entries.empty();
+}
+
+size_t name_index::count() const
+{
+    return m_count;
+}
+
+size_t name_index::memory_usage() const
+{
+    return (m_hashes.capacity() + m_entries.capacity()) * sizeof(uint32_t);
+}
+
+void name_index::clear()
+{
+    m_hashes.clear();
+    m_entries.clear();
+    m_count = 0;
+}
+
+void name_index::save(std::ostream & stream) const
+{
+    write_u64(stream, m_count);
+    write_u64(stream, m_entries.size());
+    stream.write(reinterpret_cast<char const *>(m_hashes.data()), m_hashes.size() * sizeof(uint32_t));
+    stream.write(reinterpret_cast<char const *>(m_entries.data()), m_entries.size() * sizeof(uint32_t));
+}
+
+bool name_index::load(std::istream & stream, size_t count)
+{
+    clear();
+
+    uint64_t stored_count;
+    uint64_t slot_count;
+    if ((!read_u64(stream, stored_count)) || (!read_u64(stream, slot_count)))
+    {
+        return false;
+    }
+
+    if ((stored_count != count) || (slot_count < min_slot_count) || (slot_count < (2 * count))
+        || ((slot_count & (slot_count - 1)) != 0) || (slot_count > (uint64_t(1) << 32)))
+    {
+        return false;
+    }
+
+    std::vector<uint32_t> hashes(slot_count);
+    std::vector<uint32_t> entries(slot_count);
+    if ((!stream.read(reinterpret_cast<char *>(hashes.data()), slot_count * sizeof(uint32_t)))
+        || (!stream.read(reinterpret_cast<char *>(entries.data()), slot_count * sizeof(uint32_t))))
+    {
+        return false;
+    }
+
+    size_t used = 0;
+    for(auto const entry: entries)
+    {
+        if (entry != empty_slot)
+        {
+            if (entry >= count)
+            {
+                return false;
+            }
+            used++;
+        }
+    }
+
+    if (used != count)
+    {
+        return false;
+    }
+
+    m_hashes = std::move(hashes);
+    m_entries = std::move(entries);
+    m_count = count;
+    return true;
+}
+
+void name_index::resize(size_t count)
+{
+    if (count >= empty_slot)
+    {
+        throw std::runtime_error("too many entries to index");
+    }
+
+    // keep the load factor at or below one half
+    size_t slot_count = min_slot_count;
+    while (slot_count < (2 * count))
+    {
+        slot_count *= 2;
+    }
+
+    m_hashes.assign(slot_count, 0);
+    m_entries.assign(slot_count, empty_slot);
+}
+
+void name_index::insert(uint32_t value, uint32_t index)
+{
+    size_t const mask = m_entries.size() - 1;
+    size_t slot = value & mask;
+    while (m_entries[slot] != empty_slot)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    m_hashes[slot] = value;
+    m_entries[slot] = index;
+    m_count++;
+}
+
+}
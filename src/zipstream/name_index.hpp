@@ -0,0 +1,82 @@
+#ifndef ZIPSTREAM_NAME_INDEX_HPP
+#define ZIPSTREAM_NAME_INDEX_HPP
+
+#include <cinttypes>
+#include <cstddef>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace zipstream
+{
+
+// Open-addressing hash index from entry names to entry indices.
+// Names are not stored; lookups compare candidates using a callback
+// that returns the name of an entry. Each slot keeps the hash of its
+// name, so that collisions rarely need a name comparison.
+class name_index
+{
+public:
+    name_index() = default;
+    ~name_index() = default;
+
+    static uint32_t hash(std::string_view name);
+
+    template <typename NameOf>
+    void build(size_t count, NameOf name_of)
+    {
+        clear();
+        resize(count);
+        for(size_t index = 0; index < count; index++)
+        {
+            insert(hash(name_of(index)), static_cast<uint32_t>(index));
+        }
+    }
+
+    template <typename NameOf>
+    std::optional<size_t> find(std::string_view name, NameOf name_of) const
+    {
+        if (m_entries.empty())
+        {
+            return std::nullopt;
+        }
+
+        uint32_t const value = hash(name);
+        size_t const mask = m_entries.size() - 1;
+        for(size_t slot = value & mask; m_entries[slot] != empty_slot; slot = (slot + 1) & mask)
+        {
+            if ((m_hashes[slot] == value) && (name_of(m_entries[slot]) == name))
+            {
+                return m_entries[slot];
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    bool empty() const;
+    size_t count() const;
+    size_t memory_usage() const;
+    void clear();
+
+    // slots are written in host byte order
+    void save(std::ostream & stream) const;
+    // returns false if the stream does not contain a valid index for count entries
+    bool load(std::istream & stream, size_t count);
+
+private:
+    static constexpr uint32_t const empty_slot = 0xffffffff;
+
+    void resize(size_t count);
+    void insert(uint32_t value, uint32_t index);
+
+    std::vector<uint32_t> m_hashes;
+    std::vector<uint32_t> m_entries;
+    size_t m_count = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,211 @@
+#include "zipstream/pipelined_stream.hpp"
+#include "zipstream/pipeline.hpp"
+#include "zipstream/buffer_pool.hpp"
+#include "zipstream/fd_writer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace zipstream
+{
+
+namespace
+{
+
+// the producer hands out data in chunks to keep latency low
+constexpr size_t const max_chunk_size = 64 * 1024;
+constexpr size_t const io_buffer_size = 128 * 1024;
+
+// upper bound of a single wait; wake-ups are signaled explicitly
+constexpr auto const wait_interval = std::chrono::milliseconds(100);
+
+}
+
+std::unique_ptr<stream_i> make_pipelined(std::unique_ptr<stream_i> stream, size_t ring_size)
+{
+    return std::unique_ptr<stream_i>(new pipelined_stream(std::move(stream), ring_size));
+}
+
+template <typename Predicate>
+void pipelined_stream::waiter::wait(Predicate predicate)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    waiting = true;
+    cond.wait_for(lock, wait_interval, predicate);
+    waiting = false;
+}
+
+void pipelined_stream::waiter::notify()
+{
+    if (waiting)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cond.notify_one();
+    }
+}
+
+pipelined_stream::pipelined_stream(std::unique_ptr<stream_i> inner, size_t ring_size)
+: m_inner(std::move(inner))
+, m_ring(ring_size)
+, m_running(false)
+, m_done(false)
+, m_stop(false)
+, m_pooled(0)
+{
+
+}
+
+pipelined_stream::~pipelined_stream()
+{
+    stop();
+}
+
+void pipelined_stream::write_to_fd(int fd)
+{
+    reset();
+    fd_writer writer(fd, m_pooled);
+    auto const size = expected_size();
+    if (size)
+    {
+        writer.preallocate(size.value());
+    }
+    writer.write(*this);
+}
+
+size_t pipelined_stream::read(char * buffer, size_t buffer_size)
+{
+    start();
+
+    while (true)
+    {
+        size_t const count = m_ring.read(buffer, buffer_size);
+        if (count > 0)
+        {
+            m_space_ready.notify();
+            return count;
+        }
+
+        if (m_done)
+        {
+            if (m_ring.available() > 0)
+            {
+                continue;
+            }
+
+            if (m_error)
+            {
+                std::rethrow_exception(m_error);
+            }
+
+            return 0;
+        }
+
+        m_data_ready.wait([this]() { return (m_ring.available() > 0) || m_done; });
+    }
+}
+
+void pipelined_stream::skip(size_t count)
+{
+    auto buffer = buffer_pool::instance().acquire(io_buffer_size, m_pooled);
+
+    size_t remaining = count;
+    while (remaining > 0)
+    {
+        size_t const bytes_read = read(buffer.data(), std::min(remaining, buffer.size()));
+        if (bytes_read == 0)
+        {
+            // end of stream
+            break;
+        }
+
+        remaining -= bytes_read;
+    }
+}
+
+size_t pipelined_stream::memory_usage() const
+{
+    return sizeof(pipelined_stream) + m_ring.capacity() + m_pooled + m_inner->memory_usage();
+}
+
+stream_statistics pipelined_stream::statistics() const
+{
+    return m_inner->statistics();
+}
+
+std::optional<size_t> pipelined_stream::expected_size() const
+{
+    return m_inner->expected_size();
+}
+
+void pipelined_stream::cancel()
+{
+    m_inner->cancel();
+}
+
+void pipelined_stream::reset()
+{
+    stop();
+    m_inner->reset();
+    m_ring.clear();
+    m_done = false;
+    m_error = nullptr;
+}
+
+void pipelined_stream::start()
+{
+    if (!m_running)
+    {
+        m_running = true;
+        m_stop = false;
+        m_producer = std::thread([this]() { produce(); });
+    }
+}
+
+void pipelined_stream::stop()
+{
+    if (m_running)
+    {
+        // the producer may wait for entries of a generator
+        m_stop = true;
+        m_inner->cancel();
+        m_space_ready.notify();
+        m_producer.join();
+        m_running = false;
+    }
+}
+
+void pipelined_stream::produce()
+{
+    try
+    {
+        while (!m_stop)
+        {
+            char * window;
+            size_t const window_size = m_ring.write_window(window);
+            if (window_size == 0)
+            {
+                m_space_ready.wait([this]() { return (m_ring.available() < m_ring.capacity()) || m_stop; });
+                continue;
+            }
+
+            size_t const count = m_inner->read(window, std::min(window_size, max_chunk_size));
+            if (count == 0)
+            {
+                break;
+            }
+
+            m_ring.commit(count);
+            m_data_ready.notify();
+        }
+    }
+    catch (...)
+    {
+        m_error = std::current_exception();
+    }
+
+    m_done = true;
+    m_data_ready.notify();
+}
+
+}
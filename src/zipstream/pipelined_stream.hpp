@@ -0,0 +1,61 @@
+#ifndef ZIPSTREAM_PIPELINED_STREAM_HPP
+#define ZIPSTREAM_PIPELINED_STREAM_HPP
+
+#include "zipstream/stream_i.hpp"
+#include "zipstream/spsc_ring.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace zipstream
+{
+
+class pipelined_stream: public stream_i
+{
+public:
+    pipelined_stream(std::unique_ptr<stream_i> inner, size_t ring_size);
+    ~pipelined_stream() override;
+    void write_to_fd(int fd) override;
+    size_t read(char * buffer, size_t buffer_size) override;
+    void skip(size_t count) override;
+    void reset() override;
+    size_t memory_usage() const override;
+    stream_statistics statistics() const override;
+    std::optional<size_t> expected_size() const override;
+    void cancel() override;
+
+private:
+    struct waiter
+    {
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::atomic<bool> waiting = false;
+
+        template <typename Predicate>
+        void wait(Predicate predicate);
+        void notify();
+    };
+
+    void start();
+    void stop();
+    void produce();
+
+    std::unique_ptr<stream_i> m_inner;
+    spsc_ring m_ring;
+    std::thread m_producer;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_done;
+    std::atomic<bool> m_stop;
+    std::exception_ptr m_error;
+    size_t m_pooled;
+    waiter m_data_ready;
+    waiter m_space_ready;
+};
+
+}
+
+#endif
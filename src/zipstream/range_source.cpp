@@ -0,0 +1,167 @@
+#include "zipstream/range_source.hpp"
+#include "zipstream/crc32sum.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace zipstream
+{
+
+namespace
+{
+
+constexpr size_t const max_worker_count = 8;
+constexpr size_t const chunk_size = 64 * 1024;
+
+// computes the CRCs of all entries not known up front using a small pool of workers;
+// compressed files are compressed into the cache, which provides their sizes
+void compute_missing_crcs(entry_table & entries, size_t worker_count, content_cache * cache)
+{
+    std::vector<size_t> pending;
+    for(size_t index = 0; index < entries.count(); index++)
+    {
+        if ((entries.compression(index) != compression::store)
+            && ((cache == nullptr) || (entries.type(index) != entry_type::file_from_path)))
+        {
+            throw std::runtime_error("compressed entries require a streamed archive");
+        }
+
+        entries.size(index);
+        if (entries.data_descriptor_needed(index))
+        {
+            pending.push_back(index);
+        }
+    }
+
+    std::vector<uint32_t> values(pending.size());
+    std::vector<size_t> compressed_sizes(pending.size());
+    std::atomic<size_t> next(0);
+    std::mutex mutex;
+    std::exception_ptr error;
+
+    auto const work = [&]() {
+        std::vector<char> buffer(chunk_size);
+        std::unique_ptr<compressor_i> compressors[4];
+        for(size_t i = next++; i < pending.size(); i = next++)
+        {
+            try
+            {
+                auto const backend = entries.compression(pending[i]);
+                if (backend != compression::store)
+                {
+                    auto & compressor = compressors[static_cast<size_t>(backend)];
+                    if (!compressor)
+                    {
+                        compressor = make_compressor(backend, entries.compression_level());
+                    }
+
+                    auto const content = stream::cached_content_of(entries, pending[i], *cache, *compressor,
+                        entries.compression_level());
+                    values[i] = content.crc32;
+                    compressed_sizes[i] = content.data->size();
+                    continue;
+                }
+
+                // holes of sparse files are not read
+                crc32sum checksum;
+                size_t const size = entries.size(pending[i]);
+                size_t offset = 0;
+                while (offset < size)
+                {
+                    auto const extent = entries.extent_at(pending[i], offset);
+                    size_t const end = extent.offset + extent.length;
+                    if (extent.hole)
+                    {
+                        checksum.update_zeros(extent.length);
+                        offset = end;
+                        continue;
+                    }
+
+                    do
+                    {
+                        size_t const count = entries.read_at(pending[i], offset, buffer.data(),
+                            std::min(chunk_size, end - offset));
+                        if (count == 0)
+                        {
+                            throw std::runtime_error("failed to read file");
+                        }
+                        checksum.update(buffer.data(), count);
+                        offset += count;
+                    } while (offset < end);
+                }
+                values[i] = checksum.get_value();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                next = pending.size();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for(size_t i = 1; i < std::min(worker_count, pending.size()); i++)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+    for(auto & worker: workers)
+    {
+        worker.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    for(size_t i = 0; i < pending.size(); i++)
+    {
+        entries.set_known_crc32(pending[i], values[i]);
+        if (entries.compression(pending[i]) != compression::store)
+        {
+            entries.set_known_compressed_size(pending[i], static_cast<uint32_t>(compressed_sizes[i]));
+        }
+    }
+}
+
+}
+
+range_source::range_source(entry_table && entries, size_t alignment, size_t worker_count,
+    std::shared_ptr<content_cache> cache, std::shared_ptr<std::vector<uint32_t> const> toc_order)
+: m_entries(std::make_shared<entry_table>(std::move(entries)))
+, m_cache(std::move(cache))
+, m_toc_order(std::move(toc_order))
+{
+    if (worker_count == 0)
+    {
+        worker_count = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, max_worker_count);
+    }
+
+    compute_missing_crcs(*m_entries, worker_count, m_cache.get());
+    m_layout = stream::compute_layout(*m_entries, alignment);
+}
+
+size_t range_source::size() const
+{
+    return m_layout.size;
+}
+
+std::unique_ptr<stream_i> range_source::open_range(size_t begin, size_t end) const
+{
+    auto result = std::make_unique<stream>(m_entries, m_layout, begin, end);
+    result->set_content_cache(m_cache);
+    result->set_toc_order(m_toc_order);
+    return result;
+}
+
+}
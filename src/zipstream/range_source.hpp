@@ -0,0 +1,32 @@
+#ifndef ZIPSTREAM_RANGE_SOURCE_HPP
+#define ZIPSTREAM_RANGE_SOURCE_HPP
+
+#include "zipstream/range_source_i.hpp"
+#include "zipstream/entry_table.hpp"
+#include "zipstream/stream.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace zipstream
+{
+
+class range_source: public range_source_i
+{
+public:
+    explicit range_source(entry_table && entries, size_t alignment = 0, size_t worker_count = 0,
+        std::shared_ptr<content_cache> cache = nullptr, std::shared_ptr<std::vector<uint32_t> const> toc_order = nullptr);
+    ~range_source() override = default;
+    size_t size() const override;
+    std::unique_ptr<stream_i> open_range(size_t begin, size_t end) const override;
+
+private:
+    std::shared_ptr<entry_table> m_entries;
+    archive_layout m_layout;
+    std::shared_ptr<content_cache> m_cache;
+    std::shared_ptr<std::vector<uint32_t> const> m_toc_order;
+};
+
+}
+
+#endif
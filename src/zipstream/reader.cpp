@@ -0,0 +1,492 @@
+#include "zipstream/reader.hpp"
+#include "zipstream/mmap_file.hpp"
+#include "zipstream/crc32sum.hpp"
+#include "zipstream/name_index.hpp"
+#include "zipstream/signature_scanner.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace zipstream
+{
+
+namespace
+{
+
+// end of central directory
+
+constexpr uint32_t const eocd_signature = 0x06054b50;
+constexpr size_t const eocd_total_entries_offset = 10;
+constexpr size_t const eocd_toc_size_offset = 12;
+constexpr size_t const eocd_toc_offset_offset = 16;
+constexpr size_t const eocd_comment_length_offset = 20;
+constexpr size_t const eocd_static_size = 22;
+constexpr size_t const max_comment_length = 0xffff;
+
+// zip64 end of central directory locator and record
+
+constexpr uint32_t const eocd64_locator_signature = 0x07064b50;
+constexpr size_t const eocd64_locator_record_offset = 8;
+constexpr size_t const eocd64_locator_size = 20;
+constexpr uint32_t const eocd64_signature = 0x06064b50;
+constexpr size_t const eocd64_total_entries_offset = 32;
+constexpr size_t const eocd64_toc_size_offset = 40;
+constexpr size_t const eocd64_toc_offset_offset = 48;
+
+// central file header
+
+constexpr uint32_t const cfh_signature = 0x02014b50;
+constexpr size_t const cfh_version_made_by_offset = 4;
+constexpr size_t const cfh_version_needed_offset = 6;
+constexpr size_t const cfh_flags_offset = 8;
+constexpr size_t const cfh_compression_method_offset = 10;
+constexpr size_t const cfh_last_mod_time_offset = 12;
+constexpr size_t const cfh_last_mod_date_offset = 14;
+constexpr size_t const cfh_checksum_offset = 16;
+constexpr size_t const cfh_compressed_size_offset = 20;
+constexpr size_t const cfh_uncompressed_size_offset = 24;
+constexpr size_t const cfh_filename_length_offset = 28;
+constexpr size_t const cfh_extra_field_length_offset = 30;
+constexpr size_t const cfh_comment_offset = 32;
+constexpr size_t const cfh_start_disk_offset = 34;
+constexpr size_t const cfh_internal_attributes_offset = 36;
+constexpr size_t const cfh_external_attributes_offset = 38;
+constexpr size_t const cfh_local_header_offset_offset = 42;
+constexpr size_t const cfh_static_size = 46;
+
+// local file header
+
+constexpr uint32_t const lfh_signature = 0x04034b50;
+constexpr size_t const lfh_version_needed_offset = 4;
+constexpr size_t const lfh_flags_offset = 6;
+constexpr size_t const lfh_compression_method_offset = 8;
+constexpr size_t const lfh_last_mod_time_offset = 10;
+constexpr size_t const lfh_last_mod_date_offset = 12;
+constexpr size_t const lfh_checksum_offset = 14;
+constexpr size_t const lfh_compressed_size_offset = 18;
+constexpr size_t const lfh_uncompressed_size_offset = 22;
+constexpr size_t const lfh_filename_length_offset = 26;
+constexpr size_t const lfh_extra_length_offset = 28;
+constexpr size_t const lfh_static_size = 30;
+
+// zip64 extended information extra field
+
+constexpr uint16_t const zip64_extra_id = 0x0001;
+constexpr uint32_t const zip64_marker = 0xffffffff;
+constexpr uint16_t const zip64_disk_marker = 0xffff;
+
+// sidecar file of the name index
+
+constexpr char const index_magic[8] = {'Z', 'S', 'N', 'I', 'D', 'X', '0', '2'};
+constexpr size_t const index_fingerprint_size = 5;
+
+}
+
+class reader::detail
+{
+public:
+    explicit detail(std::string const & path)
+    : file(path)
+    , eocd_offset(find_end_of_central_directory())
+    {
+        entry_count = file.read_u16(eocd_offset + eocd_total_entries_offset);
+        toc_size = file.read_u32(eocd_offset + eocd_toc_size_offset);
+        toc_offset = file.read_u32(eocd_offset + eocd_toc_offset_offset);
+        uint16_t const comment_length = file.read_u16(eocd_offset + eocd_comment_length_offset);
+        comment = file.view(eocd_offset + eocd_static_size, comment_length);
+
+        if ((eocd_offset >= eocd64_locator_size)
+            && (file.read_u32(eocd_offset - eocd64_locator_size) == eocd64_locator_signature))
+        {
+            uint64_t const record = file.read_u64(eocd_offset - eocd64_locator_size + eocd64_locator_record_offset);
+            if (file.read_u32(record) != eocd64_signature)
+            {
+                throw std::runtime_error("invalid file format: zip64 end of central directory not found");
+            }
+
+            entry_count = file.read_u64(record + eocd64_total_entries_offset);
+            toc_size = file.read_u64(record + eocd64_toc_size_offset);
+            toc_offset = file.read_u64(record + eocd64_toc_offset_offset);
+        }
+    }
+
+    size_t find_end_of_central_directory() const
+    {
+        size_t const size = file.get_size();
+        if (size < eocd_static_size)
+        {
+            throw std::runtime_error("invalid file format: end of central directory not found");
+        }
+
+        // the record is followed by a comment of at most 64 KiB
+        size_t const last = size - eocd_static_size;
+        size_t const first = (last > max_comment_length) ? last - max_comment_length : 0;
+        auto const region = file.view(first, last + 4 - first);
+        size_t const pos = find_last_signature(region.data(), region.size(), eocd_signature);
+        if (pos == region.size())
+        {
+            throw std::runtime_error("invalid file format: end of central directory not found");
+        }
+
+        return first + pos;
+    }
+
+    // offsets of all central file headers, built on first use
+    std::vector<uint64_t> const & header_offsets() const
+    {
+        std::call_once(index_once, [this]() {
+            std::vector<uint64_t> offsets;
+            offsets.reserve(std::min<uint64_t>(entry_count, file.get_size() / cfh_static_size));
+
+            uint64_t offset = toc_offset;
+            for(uint64_t i = 0; i < entry_count; i++)
+            {
+                if (file.read_u32(offset) != cfh_signature)
+                {
+                    throw std::runtime_error("invalid central file header signature");
+                }
+
+                offsets.push_back(offset);
+                offset += cfh_static_size
+                    + file.read_u16(offset + cfh_filename_length_offset)
+                    + file.read_u16(offset + cfh_extra_field_length_offset)
+                    + file.read_u16(offset + cfh_comment_offset);
+            }
+
+            offsets_by_index = std::move(offsets);
+        });
+
+        return offsets_by_index;
+    }
+
+    // uses offsets loaded from a sidecar unless the index is already built
+    void adopt_header_offsets(std::vector<uint64_t> && offsets) const
+    {
+        std::call_once(index_once, [&]() {
+            offsets_by_index = std::move(offsets);
+        });
+    }
+
+    uint64_t header_offset(size_t index) const
+    {
+        auto const & offsets = header_offsets();
+        if (index >= offsets.size())
+        {
+            throw std::out_of_range("invalid entry index");
+        }
+
+        return offsets[index];
+    }
+
+    std::string_view name(size_t index) const
+    {
+        uint64_t const offset = header_offset(index);
+        return file.view(offset + cfh_static_size, file.read_u16(offset + cfh_filename_length_offset));
+    }
+
+    entry_info entry(size_t index) const
+    {
+        uint64_t const offset = header_offset(index);
+        entry_info info;
+        info.version_made_by = file.read_u16(offset + cfh_version_made_by_offset);
+        info.version_needed = file.read_u16(offset + cfh_version_needed_offset);
+        info.flags = file.read_u16(offset + cfh_flags_offset);
+        info.compression_method = file.read_u16(offset + cfh_compression_method_offset);
+        info.last_mod_time = file.read_u16(offset + cfh_last_mod_time_offset);
+        info.last_mod_date = file.read_u16(offset + cfh_last_mod_date_offset);
+        info.crc32 = file.read_u32(offset + cfh_checksum_offset);
+        info.compressed_size = file.read_u32(offset + cfh_compressed_size_offset);
+        info.uncompressed_size = file.read_u32(offset + cfh_uncompressed_size_offset);
+        info.disk_number_start = file.read_u16(offset + cfh_start_disk_offset);
+        info.internal_attributes = file.read_u16(offset + cfh_internal_attributes_offset);
+        info.external_attributes = file.read_u32(offset + cfh_external_attributes_offset);
+        info.local_header_offset = file.read_u32(offset + cfh_local_header_offset_offset);
+
+        uint16_t const filename_length = file.read_u16(offset + cfh_filename_length_offset);
+        uint16_t const extra_length = file.read_u16(offset + cfh_extra_field_length_offset);
+        uint16_t const comment_length = file.read_u16(offset + cfh_comment_offset);
+        size_t const extra_offset = offset + cfh_static_size + filename_length;
+        info.name = file.view(offset + cfh_static_size, filename_length);
+        info.extra = file.view(extra_offset, extra_length);
+        info.comment = file.view(extra_offset + extra_length, comment_length);
+
+        read_zip64_extra(extra_offset, extra_length, info);
+        return info;
+    }
+
+    // replaces 32 bit fields marked as overflown by their zip64 values
+    void read_zip64_extra(size_t offset, size_t length, entry_info & info) const
+    {
+        size_t const end = offset + length;
+        while ((offset + 4) <= end)
+        {
+            uint16_t const id = file.read_u16(offset);
+            uint16_t const size = file.read_u16(offset + 2);
+            size_t pos = offset + 4;
+            offset = pos + size;
+            if ((id != zip64_extra_id) || (offset > end))
+            {
+                continue;
+            }
+
+            if (info.uncompressed_size == zip64_marker)
+            {
+                info.uncompressed_size = read_extra_u64(pos, offset);
+            }
+            if (info.compressed_size == zip64_marker)
+            {
+                info.compressed_size = read_extra_u64(pos, offset);
+            }
+            if (info.local_header_offset == zip64_marker)
+            {
+                info.local_header_offset = read_extra_u64(pos, offset);
+            }
+            if ((info.disk_number_start == zip64_disk_marker) && ((pos + 4) <= offset))
+            {
+                info.disk_number_start = file.read_u32(pos);
+            }
+            return;
+        }
+    }
+
+    uint64_t read_extra_u64(size_t & pos, size_t end) const
+    {
+        if ((pos + 8) > end)
+        {
+            throw std::runtime_error("invalid zip64 extra field");
+        }
+
+        uint64_t const value = file.read_u64(pos);
+        pos += 8;
+        return value;
+    }
+
+    local_header_info local_header(uint64_t offset) const
+    {
+        if (file.read_u32(offset) != lfh_signature)
+        {
+            throw std::runtime_error("invalid local file header signature");
+        }
+
+        local_header_info info;
+        info.version_needed = file.read_u16(offset + lfh_version_needed_offset);
+        info.flags = file.read_u16(offset + lfh_flags_offset);
+        info.compression_method = file.read_u16(offset + lfh_compression_method_offset);
+        info.last_mod_time = file.read_u16(offset + lfh_last_mod_time_offset);
+        info.last_mod_date = file.read_u16(offset + lfh_last_mod_date_offset);
+        info.crc32 = file.read_u32(offset + lfh_checksum_offset);
+        info.compressed_size = file.read_u32(offset + lfh_compressed_size_offset);
+        info.uncompressed_size = file.read_u32(offset + lfh_uncompressed_size_offset);
+
+        uint16_t const filename_length = file.read_u16(offset + lfh_filename_length_offset);
+        uint16_t const extra_length = file.read_u16(offset + lfh_extra_length_offset);
+        info.name = file.view(offset + lfh_static_size, filename_length);
+        info.extra = file.view(offset + lfh_static_size + filename_length, extra_length);
+        info.data_offset = offset + lfh_static_size + filename_length + extra_length;
+
+        return info;
+    }
+
+    // identifies the archive an index sidecar belongs to; the CRC of the
+    // central directory tells archives of the same layout apart
+    void fingerprint(uint64_t (&values)[index_fingerprint_size]) const
+    {
+        auto const toc = file.view(toc_offset, toc_size);
+        crc32sum toc_crc32;
+        toc_crc32.update(toc.data(), toc.size());
+
+        values[0] = file.get_size();
+        values[1] = entry_count;
+        values[2] = toc_offset;
+        values[3] = toc_size;
+        values[4] = toc_crc32.get_value();
+    }
+
+    mmap_file file;
+    size_t eocd_offset;
+    uint64_t entry_count;
+    uint64_t toc_offset;
+    uint64_t toc_size;
+    std::string_view comment;
+    name_index names;
+
+    mutable std::once_flag index_once;
+    mutable std::vector<uint64_t> offsets_by_index;
+};
+
+reader::reader(std::string const & path)
+: d(new detail(path))
+{
+}
+
+reader::~reader()
+{
+    delete d;
+}
+
+reader::reader(reader && other)
+: d(other.d)
+{
+    other.d = nullptr;
+}
+
+reader& reader::operator=(reader && other)
+{
+    if (this != &other)
+    {
+        delete d;
+        this->d = other.d;
+        other.d = nullptr;
+    }
+
+    return *this;
+}
+
+size_t reader::size() const
+{
+    return d->file.get_size();
+}
+
+size_t reader::count() const
+{
+    return d->entry_count;
+}
+
+uint64_t reader::toc_offset() const
+{
+    return d->toc_offset;
+}
+
+std::string_view reader::bytes() const
+{
+    return d->file.view(0, d->file.get_size());
+}
+
+std::string_view reader::toc() const
+{
+    return d->file.view(d->toc_offset, d->toc_size);
+}
+
+std::string_view reader::comment() const
+{
+    return d->comment;
+}
+
+entry_info reader::entry(size_t index) const
+{
+    return d->entry(index);
+}
+
+std::string_view reader::name(size_t index) const
+{
+    return d->name(index);
+}
+
+std::optional<size_t> reader::find(std::string_view name) const
+{
+    if (!d->names.empty())
+    {
+        return d->names.find(name, [this](size_t index) { return d->name(index); });
+    }
+
+    size_t const entry_count = d->header_offsets().size();
+    for(size_t index = 0; index < entry_count; index++)
+    {
+        if (d->name(index) == name)
+        {
+            return index;
+        }
+    }
+
+    return std::nullopt;
+}
+
+local_header_info reader::local_header(size_t index) const
+{
+    return d->local_header(d->entry(index).local_header_offset);
+}
+
+std::string_view reader::data(size_t index) const
+{
+    auto const info = d->entry(index);
+    auto const header = d->local_header(info.local_header_offset);
+
+    return d->file.view(header.data_offset, info.compressed_size);
+}
+
+void reader::build_index()
+{
+    size_t const entry_count = d->header_offsets().size();
+    d->names.build(entry_count, [this](size_t index) { return d->name(index); });
+}
+
+void reader::save_index(std::string const & path)
+{
+    if (d->names.empty())
+    {
+        build_index();
+    }
+
+    uint64_t fingerprint[index_fingerprint_size];
+    d->fingerprint(fingerprint);
+
+    std::ofstream file(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    file.write(index_magic, sizeof(index_magic));
+    file.write(reinterpret_cast<char const *>(fingerprint), sizeof(fingerprint));
+    auto const & offsets = d->header_offsets();
+    file.write(reinterpret_cast<char const *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    d->names.save(file);
+    if (!file.flush())
+    {
+        throw std::runtime_error("failed to write index");
+    }
+}
+
+bool reader::load_index(std::string const & path)
+{
+    std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+    char magic[sizeof(index_magic)];
+    uint64_t stored[index_fingerprint_size];
+    uint64_t fingerprint[index_fingerprint_size];
+    d->fingerprint(fingerprint);
+
+    if ((!file.read(magic, sizeof(magic))) || (0 != memcmp(magic, index_magic, sizeof(magic)))
+        || (!file.read(reinterpret_cast<char *>(stored), sizeof(stored)))
+        || (0 != memcmp(stored, fingerprint, sizeof(stored))))
+    {
+        return false;
+    }
+
+    if (d->entry_count > (d->file.get_size() / cfh_static_size))
+    {
+        return false;
+    }
+
+    std::vector<uint64_t> offsets(d->entry_count);
+    if (!file.read(reinterpret_cast<char *>(offsets.data()), offsets.size() * sizeof(uint64_t)))
+    {
+        return false;
+    }
+
+    for(auto const offset: offsets)
+    {
+        if ((offset < d->toc_offset) || ((offset - d->toc_offset) >= d->toc_size))
+        {
+            return false;
+        }
+    }
+
+    if (!d->names.load(file, d->entry_count))
+    {
+        return false;
+    }
+
+    d->adopt_header_offsets(std::move(offsets));
+    return true;
+}
+
+}
@@ -0,0 +1,408 @@
+#include "zipstream/reader.hpp"
+#include "zipstream/mmap_file.hpp"
+#include "zipstream/signature_scanner.hpp"
+#include "zipstream/crc32sum.hpp"
+#include "zipstream/buffer.hpp"
+#include "zipstream/fd_writer.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace zipstream
+{
+
+namespace
+{
+
+constexpr uint32_t const local_header_signature = 0x04034b50;
+constexpr uint32_t const data_descriptor_signature = 0x08074b50;
+
+constexpr size_t const local_file_header_size = 30;
+constexpr size_t const toc_entry_size = 46;
+constexpr size_t const toc_end_size = 22;
+
+constexpr uint16_t const flag_data_descriptor = 0x08;
+constexpr uint16_t const method_store = 0;
+constexpr uint16_t const method_deflate = 8;
+constexpr uint16_t const zip64_extra_id = 0x0001;
+constexpr uint32_t const zip64_marker = 0xffffffff;
+
+// version made by: MS-DOS, so that missing file attributes are acceptable
+constexpr uint16_t const version_made_by = 20;
+constexpr uint32_t const directory_attribute = 0x10;
+
+constexpr size_t const inflate_buffer_size = 64 * 1024;
+
+struct recovered_entry
+{
+    uint64_t offset;
+    uint16_t version_needed;
+    uint16_t flags;
+    uint16_t compression_method;
+    uint16_t last_mod_time;
+    uint16_t last_mod_date;
+    uint32_t crc32;
+    uint64_t compressed_size;
+    uint64_t size;
+    std::string_view name;
+};
+
+// result of inflating a deflate stream
+struct inflate_result
+{
+    bool ok;
+    uint64_t compressed_size;
+    uint64_t size;
+    uint32_t crc32;
+};
+
+inflate_result inflate_data(std::string_view data)
+{
+    inflate_result result = {false, 0, 0, 0};
+    z_stream inflater = {};
+    if (Z_OK != inflateInit2(&inflater, -MAX_WBITS))
+    {
+        throw std::runtime_error("failed to initialize inflate");
+    }
+
+    std::vector<char> buffer(inflate_buffer_size);
+    crc32sum checksum;
+    size_t pos = 0;
+    int rc = Z_OK;
+    while (rc == Z_OK)
+    {
+        size_t const input_size = std::min<size_t>(data.size() - pos, std::numeric_limits<uInt>::max());
+        inflater.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(&data.data()[pos]));
+        inflater.avail_in = static_cast<uInt>(input_size);
+        inflater.next_out = reinterpret_cast<Bytef *>(buffer.data());
+        inflater.avail_out = static_cast<uInt>(buffer.size());
+
+        rc = inflate(&inflater, Z_NO_FLUSH);
+        pos += input_size - inflater.avail_in;
+        size_t const produced = buffer.size() - inflater.avail_out;
+        checksum.update(buffer.data(), produced);
+        result.size += produced;
+
+        if ((rc == Z_OK) && (produced == 0) && (pos == data.size()))
+        {
+            // truncated stream
+            break;
+        }
+    }
+    inflateEnd(&inflater);
+
+    result.ok = (rc == Z_STREAM_END);
+    result.compressed_size = pos;
+    result.crc32 = checksum.get_value();
+    return result;
+}
+
+class recovery_scanner
+{
+public:
+    explicit recovery_scanner(mmap_file const & file)
+    : m_file(file)
+    , m_data(reinterpret_cast<char const *>(file.get_address()))
+    , m_size(file.get_size())
+    {
+    }
+
+    // checks the entry at offset; end is set to the end of its data
+    bool parse_entry(uint64_t offset, recovered_entry & entry, uint64_t & end) const
+    {
+        if ((m_size - offset) < local_file_header_size)
+        {
+            return false;
+        }
+
+        entry.offset = offset;
+        entry.version_needed = m_file.read_u16(offset + 4);
+        entry.flags = m_file.read_u16(offset + 6);
+        entry.compression_method = m_file.read_u16(offset + 8);
+        entry.last_mod_time = m_file.read_u16(offset + 10);
+        entry.last_mod_date = m_file.read_u16(offset + 12);
+        entry.crc32 = m_file.read_u32(offset + 14);
+        entry.compressed_size = m_file.read_u32(offset + 18);
+        entry.size = m_file.read_u32(offset + 22);
+        size_t const name_length = m_file.read_u16(offset + 26);
+        size_t const extra_length = m_file.read_u16(offset + 28);
+        uint64_t const data_start = offset + local_file_header_size + name_length + extra_length;
+        if (data_start > m_size)
+        {
+            return false;
+        }
+
+        entry.name = m_file.view(offset + local_file_header_size, name_length);
+        bool const zip64 = read_zip64_extra(offset + local_file_header_size + name_length, extra_length, entry);
+
+        if ((entry.flags & flag_data_descriptor) == 0)
+        {
+            return check_sized_data(data_start, entry, end);
+        }
+
+        if (entry.compression_method == method_store)
+        {
+            return scan_stored_data(data_start, zip64, entry, end);
+        }
+
+        if (entry.compression_method == method_deflate)
+        {
+            auto const result = inflate_data(m_file.view(data_start, m_size - data_start));
+            if (!result.ok)
+            {
+                return false;
+            }
+
+            entry.crc32 = result.crc32;
+            entry.compressed_size = result.compressed_size;
+            entry.size = result.size;
+            return check_descriptor(data_start + result.compressed_size, zip64, entry, end);
+        }
+
+        // the end of data with unknown size cannot be found for other methods
+        return false;
+    }
+
+private:
+    bool read_zip64_extra(uint64_t offset, size_t length, recovered_entry & entry) const
+    {
+        size_t pos = 0;
+        while ((pos + 4) <= length)
+        {
+            uint16_t const id = m_file.read_u16(offset + pos);
+            size_t const size = m_file.read_u16(offset + pos + 2);
+            size_t field = pos + 4;
+            pos = field + size;
+            if ((id != zip64_extra_id) || (pos > length))
+            {
+                continue;
+            }
+
+            if ((entry.size == zip64_marker) && ((field + 8) <= pos))
+            {
+                entry.size = m_file.read_u64(offset + field);
+                field += 8;
+            }
+            if ((entry.compressed_size == zip64_marker) && ((field + 8) <= pos))
+            {
+                entry.compressed_size = m_file.read_u64(offset + field);
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    bool check_sized_data(uint64_t data_start, recovered_entry const & entry, uint64_t & end) const
+    {
+        if (entry.compressed_size > (m_size - data_start))
+        {
+            return false;
+        }
+
+        auto const data = m_file.view(data_start, entry.compressed_size);
+        end = data_start + entry.compressed_size;
+        if (entry.compression_method == method_store)
+        {
+            crc32sum checksum;
+            checksum.update(data.data(), data.size());
+            return (entry.size == entry.compressed_size) && (checksum.get_value() == entry.crc32);
+        }
+
+        if (entry.compression_method == method_deflate)
+        {
+            auto const result = inflate_data(data);
+            return (result.ok) && (result.compressed_size == entry.compressed_size)
+                && (result.size == entry.size) && (result.crc32 == entry.crc32);
+        }
+
+        // data of other methods is taken as is
+        return true;
+    }
+
+    // stored data ends at the first data descriptor matching the data before it
+    bool scan_stored_data(uint64_t data_start, bool zip64, recovered_entry & entry, uint64_t & end) const
+    {
+        crc32sum checksum;
+        uint64_t checked = data_start;
+        uint64_t pos = data_start;
+        while (pos < m_size)
+        {
+            size_t const found = find_signature(&m_data[pos], m_size - pos, data_descriptor_signature);
+            if (found == (m_size - pos))
+            {
+                return false;
+            }
+
+            uint64_t const candidate = pos + found;
+            checksum.update(&m_data[checked], candidate - checked);
+            checked = candidate;
+
+            entry.crc32 = checksum.get_value();
+            entry.compressed_size = candidate - data_start;
+            entry.size = entry.compressed_size;
+            if (check_descriptor(candidate, zip64, entry, end))
+            {
+                return true;
+            }
+
+            pos = candidate + 1;
+        }
+
+        return false;
+    }
+
+    // the descriptor signature is optional
+    bool check_descriptor(uint64_t offset, bool zip64, recovered_entry const & entry, uint64_t & end) const
+    {
+        if ((m_size - offset) < 4)
+        {
+            return false;
+        }
+
+        size_t const signature_size = (m_file.read_u32(offset) == data_descriptor_signature) ? 4 : 0;
+        size_t const size = signature_size + ((zip64) ? 20 : 12);
+        if ((m_size - offset) < size)
+        {
+            return false;
+        }
+
+        uint64_t const pos = offset + signature_size;
+        uint64_t const compressed_size = (zip64) ? m_file.read_u64(pos + 4) : m_file.read_u32(pos + 4);
+        uint64_t const uncompressed_size = (zip64) ? m_file.read_u64(pos + 12) : m_file.read_u32(pos + 8);
+        end = offset + size;
+
+        return (m_file.read_u32(pos) == entry.crc32) && (compressed_size == entry.compressed_size)
+            && (uncompressed_size == entry.size);
+    }
+
+    mmap_file const & m_file;
+    char const * m_data;
+    uint64_t m_size;
+};
+
+void write_toc_entry(buffer & target, recovered_entry const & entry)
+{
+    bool const is_directory = ((!entry.name.empty()) && (entry.name.back() == '/'));
+    target.write_u32(0x02014b50);               // central file header signature
+    target.write_u16(version_made_by);          // version made by
+    target.write_u16(entry.version_needed);     // version needed to extract
+    target.write_u16(entry.flags);              // flags
+    target.write_u16(entry.compression_method); // compression method
+    target.write_u16(entry.last_mod_time);      // last mod file time
+    target.write_u16(entry.last_mod_date);      // last mod file date
+    target.write_u32(entry.crc32);              // crc32
+    target.write_u32(entry.compressed_size);    // compressed size
+    target.write_u32(entry.size);               // uncompressed size
+    target.write_u16(entry.name.size());        // filename length
+    target.write_u16(0);                        // extra field length
+    target.write_u16(0);                        // comment length
+    target.write_u16(0);                        // disk number start
+    target.write_u16(0);                        // internal attributes (none)
+    target.write_u32((is_directory) ? directory_attribute : 0); // external attributes
+    target.write_u32(entry.offset);             // offset of local file header
+    target.write_str(entry.name);
+}
+
+}
+
+size_t recover_archive(std::string const & path, std::string const & output)
+{
+    mmap_file file(path);
+    recovery_scanner scanner(file);
+    char const * const data = reinterpret_cast<char const *>(file.get_address());
+    uint64_t const size = file.get_size();
+
+    std::vector<recovered_entry> entries;
+    uint64_t valid_end = 0;
+    uint64_t pos = 0;
+    while (pos < size)
+    {
+        size_t const found = find_signature(&data[pos], size - pos, local_header_signature);
+        if (found == (size - pos))
+        {
+            break;
+        }
+
+        uint64_t const offset = pos + found;
+        recovered_entry entry;
+        uint64_t end;
+        if (scanner.parse_entry(offset, entry, end))
+        {
+            entries.push_back(entry);
+            valid_end = end;
+            pos = end;
+        }
+        else
+        {
+            // not an intact entry; continue behind its signature
+            pos = offset + 1;
+        }
+    }
+
+    uint64_t toc_size = 0;
+    for(auto const & entry: entries)
+    {
+        toc_size += toc_entry_size + entry.name.size();
+        if ((entry.compressed_size > zip64_marker) || (entry.size > zip64_marker))
+        {
+            throw std::runtime_error("archive too large");
+        }
+    }
+
+    if (((valid_end + toc_size + toc_end_size) > zip64_marker) || (entries.size() > 0xffff))
+    {
+        throw std::runtime_error("archive too large");
+    }
+
+    // the central directory is assembled in memory and written at once
+    buffer record(toc_size + toc_end_size);
+    for(auto const & entry: entries)
+    {
+        write_toc_entry(record, entry);
+    }
+
+    record.write_u32(0x06054b50);               // end of central directory record signature
+    record.write_u16(0);                        // number of this disk
+    record.write_u16(0);                        // number of disk with start of eocd
+    record.write_u16(entries.size());           // number of entries in this disk
+    record.write_u16(entries.size());           // total number of entries
+    record.write_u32(toc_size);                 // size of central directory
+    record.write_u32(valid_end);                // start of central directory
+    record.write_u16(0);                        // comment length
+    std::vector<char> bytes(record.size());
+    record.read(bytes.data(), bytes.size());
+
+    int const target = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (target < 0)
+    {
+        throw std::runtime_error("failed to open recovered archive");
+    }
+
+    try
+    {
+        write_all(target, data, valid_end);
+        write_all(target, bytes.data(), bytes.size());
+    }
+    catch (...)
+    {
+        close(target);
+        throw;
+    }
+
+    // delayed write errors are reported by close
+    if (0 != close(target))
+    {
+        throw std::runtime_error("failed to write recovered archive");
+    }
+
+    return entries.size();
+}
+
+}
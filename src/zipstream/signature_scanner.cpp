@@ -0,0 +1,311 @@
+#include "zipstream/signature_scanner.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ZIPSTREAM_SCAN_X86
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define ZIPSTREAM_SCAN_NEON
+#endif
+
+namespace zipstream
+{
+
+namespace
+{
+
+using scan_function = size_t (*)(char const * data, size_t size, uint32_t signature);
+
+bool matches(char const * data, uint32_t signature)
+{
+    uint8_t const * const bytes = reinterpret_cast<uint8_t const *>(data);
+    uint32_t const value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+    return (value == signature);
+}
+
+// scalar search of candidate positions [first, last)
+size_t find_scalar(char const * data, size_t first, size_t last, uint32_t signature, size_t not_found)
+{
+    for(size_t pos = first; pos < last; pos++)
+    {
+        if (matches(&data[pos], signature))
+        {
+            return pos;
+        }
+    }
+
+    return not_found;
+}
+
+size_t find_last_scalar(char const * data, size_t first, size_t last, uint32_t signature, size_t not_found)
+{
+    for(size_t pos = last; pos > first; pos--)
+    {
+        if (matches(&data[pos - 1], signature))
+        {
+            return pos - 1;
+        }
+    }
+
+    return not_found;
+}
+
+#if defined(ZIPSTREAM_SCAN_X86)
+
+// Each block compares 16 (32) candidate positions at once: a candidate
+// matches its first two bytes if both comparisons are set. Full matches
+// are confirmed with a scalar comparison.
+
+size_t find_sse2(char const * data, size_t size, uint32_t signature)
+{
+    if (size < 4)
+    {
+        return size;
+    }
+
+    size_t const candidates = size - 3;
+    __m128i const first = _mm_set1_epi8(static_cast<char>(signature & 0xff));
+    __m128i const second = _mm_set1_epi8(static_cast<char>((signature >> 8) & 0xff));
+
+    size_t block = 0;
+    for(; (block + 16) <= candidates; block += 16)
+    {
+        __m128i const v0 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&data[block]));
+        __m128i const v1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&data[block + 1]));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(v0, first), _mm_cmpeq_epi8(v1, second)));
+        while (mask != 0)
+        {
+            size_t const pos = block + __builtin_ctz(mask);
+            if (matches(&data[pos], signature))
+            {
+                return pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    return find_scalar(data, block, candidates, signature, size);
+}
+
+size_t find_last_sse2(char const * data, size_t size, uint32_t signature)
+{
+    if (size < 4)
+    {
+        return size;
+    }
+
+    __m128i const first = _mm_set1_epi8(static_cast<char>(signature & 0xff));
+    __m128i const second = _mm_set1_epi8(static_cast<char>((signature >> 8) & 0xff));
+
+    size_t block_end = size - 3;
+    for(; block_end >= 16; block_end -= 16)
+    {
+        size_t const block = block_end - 16;
+        __m128i const v0 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&data[block]));
+        __m128i const v1 = _mm_loadu_si128(reinterpret_cast<__m128i const *>(&data[block + 1]));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(v0, first), _mm_cmpeq_epi8(v1, second)));
+        while (mask != 0)
+        {
+            unsigned const bit = 31 - __builtin_clz(mask);
+            if (matches(&data[block + bit], signature))
+            {
+                return block + bit;
+            }
+            mask &= ~(1u << bit);
+        }
+    }
+
+    return find_last_scalar(data, 0, block_end, signature, size);
+}
+
+__attribute__((target("avx2")))
+size_t find_avx2(char const * data, size_t size, uint32_t signature)
+{
+    if (size < 4)
+    {
+        return size;
+    }
+
+    size_t const candidates = size - 3;
+    __m256i const first = _mm256_set1_epi8(static_cast<char>(signature & 0xff));
+    __m256i const second = _mm256_set1_epi8(static_cast<char>((signature >> 8) & 0xff));
+
+    size_t block = 0;
+    for(; (block + 32) <= candidates; block += 32)
+    {
+        __m256i const v0 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(&data[block]));
+        __m256i const v1 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(&data[block + 1]));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(v0, first), _mm256_cmpeq_epi8(v1, second)));
+        while (mask != 0)
+        {
+            size_t const pos = block + __builtin_ctz(mask);
+            if (matches(&data[pos], signature))
+            {
+                return pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    return find_scalar(data, block, candidates, signature, size);
+}
+
+__attribute__((target("avx2")))
+size_t find_last_avx2(char const * data, size_t size, uint32_t signature)
+{
+    if (size < 4)
+    {
+        return size;
+    }
+
+    __m256i const first = _mm256_set1_epi8(static_cast<char>(signature & 0xff));
+    __m256i const second = _mm256_set1_epi8(static_cast<char>((signature >> 8) & 0xff));
+
+    size_t block_end = size - 3;
+    for(; block_end >= 32; block_end -= 32)
+    {
+        size_t const block = block_end - 32;
+        __m256i const v0 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(&data[block]));
+        __m256i const v1 = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(&data[block + 1]));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(v0, first), _mm256_cmpeq_epi8(v1, second)));
+        while (mask != 0)
+        {
+            unsigned const bit = 31 - __builtin_clz(mask);
+            if (matches(&data[block + bit], signature))
+            {
+                return block + bit;
+            }
+            mask &= ~(1u << bit);
+        }
+    }
+
+    return find_last_scalar(data, 0, block_end, signature, size);
+}
+
+scan_function select_find()
+{
+    return (__builtin_cpu_supports("avx2")) ? find_avx2 : find_sse2;
+}
+
+scan_function select_find_last()
+{
+    return (__builtin_cpu_supports("avx2")) ? find_last_avx2 : find_last_sse2;
+}
+
+#elif defined(ZIPSTREAM_SCAN_NEON)
+
+// NEON lacks a cheap movemask; blocks without a candidate are skipped
+// and the few remaining blocks are checked with the scalar loop.
+
+bool has_candidate(char const * data, uint8x16_t first, uint8x16_t second)
+{
+    uint8x16_t const v0 = vld1q_u8(reinterpret_cast<uint8_t const *>(data));
+    uint8x16_t const v1 = vld1q_u8(reinterpret_cast<uint8_t const *>(&data[1]));
+    return (0 != vmaxvq_u8(vandq_u8(vceqq_u8(v0, first), vceqq_u8(v1, second))));
+}
+
+size_t find_neon(char const * data, size_t size, uint32_t signature)
+{
+    if (size < 4)
+    {
+        return size;
+    }
+
+    size_t const candidates = size - 3;
+    uint8x16_t const first = vdupq_n_u8(signature & 0xff);
+    uint8x16_t const second = vdupq_n_u8((signature >> 8) & 0xff);
+
+    size_t block = 0;
+    for(; (block + 16) <= candidates; block += 16)
+    {
+        if (has_candidate(&data[block], first, second))
+        {
+            size_t const pos = find_scalar(data, block, block + 16, signature, size);
+            if (pos != size)
+            {
+                return pos;
+            }
+        }
+    }
+
+    return find_scalar(data, block, candidates, signature, size);
+}
+
+size_t find_last_neon(char const * data, size_t size, uint32_t signature)
+{
+    if (size < 4)
+    {
+        return size;
+    }
+
+    uint8x16_t const first = vdupq_n_u8(signature & 0xff);
+    uint8x16_t const second = vdupq_n_u8((signature >> 8) & 0xff);
+
+    size_t block_end = size - 3;
+    for(; block_end >= 16; block_end -= 16)
+    {
+        size_t const block = block_end - 16;
+        if (has_candidate(&data[block], first, second))
+        {
+            size_t const pos = find_last_scalar(data, block, block_end, signature, size);
+            if (pos != size)
+            {
+                return pos;
+            }
+        }
+    }
+
+    return find_last_scalar(data, 0, block_end, signature, size);
+}
+
+scan_function select_find()
+{
+    return find_neon;
+}
+
+scan_function select_find_last()
+{
+    return find_last_neon;
+}
+
+#else
+
+size_t find_generic(char const * data, size_t size, uint32_t signature)
+{
+    return (size < 4) ? size : find_scalar(data, 0, size - 3, signature, size);
+}
+
+size_t find_last_generic(char const * data, size_t size, uint32_t signature)
+{
+    return (size < 4) ? size : find_last_scalar(data, 0, size - 3, signature, size);
+}
+
+scan_function select_find()
+{
+    return find_generic;
+}
+
+scan_function select_find_last()
+{
+    return find_last_generic;
+}
+
+#endif
+
+}
+
+size_t find_signature(char const * data, size_t size, uint32_t signature)
+{
+    static scan_function const find = select_find();
+    return find(data, size, signature);
+}
+
+size_t find_last_signature(char const * data, size_t size, uint32_t signature)
+{
+    static scan_function const find_last = select_find_last();
+    return find_last(data, size, signature);
+}
+
+}
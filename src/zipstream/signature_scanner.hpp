@@ -0,0 +1,19 @@
+#ifndef ZIPSTREAM_SIGNATURE_SCANNER_HPP
+#define ZIPSTREAM_SIGNATURE_SCANNER_HPP
+
+#include <cinttypes>
+#include <cstddef>
+
+namespace zipstream
+{
+
+// Searches for little endian 32 bit record signatures.
+// Uses AVX2, SSE2 or NEON when available and a scalar loop otherwise.
+// Both functions return size if the signature is not found.
+
+size_t find_signature(char const * data, size_t size, uint32_t signature);
+size_t find_last_signature(char const * data, size_t size, uint32_t signature);
+
+}
+
+#endif
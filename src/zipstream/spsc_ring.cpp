@@ -0,0 +1,73 @@
+#include "zipstream/spsc_ring.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace zipstream
+{
+
+// read and write positions increase monotonically,
+// the position within the ring is pos % capacity
+
+spsc_ring::spsc_ring(size_t capacity)
+: m_data(new char[capacity])
+, m_capacity(capacity)
+, m_read_pos(0)
+, m_write_pos(0)
+{
+    if (capacity == 0)
+    {
+        throw std::runtime_error("invalid ring capacity");
+    }
+}
+
+size_t spsc_ring::capacity() const
+{
+    return m_capacity;
+}
+
+size_t spsc_ring::available() const
+{
+    // sequentially consistent, since waiting threads re-check available after announcing to wait
+    return m_write_pos.load() - m_read_pos.load();
+}
+
+size_t spsc_ring::write_window(char * & window)
+{
+    size_t const write_pos = m_write_pos.load(std::memory_order_relaxed);
+    size_t const read_pos = m_read_pos.load(std::memory_order_acquire);
+    size_t const offset = write_pos % m_capacity;
+    size_t const free_space = m_capacity - (write_pos - read_pos);
+
+    window = &m_data[offset];
+    return std::min(free_space, m_capacity - offset);
+}
+
+void spsc_ring::commit(size_t count)
+{
+    m_write_pos.fetch_add(count);
+}
+
+size_t spsc_ring::read(char * buffer, size_t buffer_size)
+{
+    size_t const read_pos = m_read_pos.load(std::memory_order_relaxed);
+    size_t const write_pos = m_write_pos.load(std::memory_order_acquire);
+    size_t const count = std::min(buffer_size, write_pos - read_pos);
+
+    size_t const offset = read_pos % m_capacity;
+    size_t const first = std::min(count, m_capacity - offset);
+    memcpy(buffer, &m_data[offset], first);
+    memcpy(&buffer[first], m_data.get(), count - first);
+
+    m_read_pos.store(read_pos + count);
+    return count;
+}
+
+void spsc_ring::clear()
+{
+    m_read_pos = 0;
+    m_write_pos = 0;
+}
+
+}
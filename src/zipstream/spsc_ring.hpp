@@ -0,0 +1,44 @@
+#ifndef ZIPSTREAM_SPSC_RING_HPP
+#define ZIPSTREAM_SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace zipstream
+{
+
+// Lock-free single producer / single consumer byte ring.
+// The producer writes directly into the ring using write_window and
+// commit, the consumer copies ready bytes out using read.
+class spsc_ring
+{
+    spsc_ring(spsc_ring const &) = delete;
+    spsc_ring& operator=(spsc_ring const &) = delete;
+public:
+    explicit spsc_ring(size_t capacity);
+    ~spsc_ring() = default;
+
+    size_t capacity() const;
+    size_t available() const;
+
+    // producer side
+    size_t write_window(char * & window);
+    void commit(size_t count);
+
+    // consumer side
+    size_t read(char * buffer, size_t buffer_size);
+
+    // neither producer nor consumer must be active
+    void clear();
+
+private:
+    std::unique_ptr<char[]> m_data;
+    size_t const m_capacity;
+    alignas(64) std::atomic<size_t> m_read_pos;
+    alignas(64) std::atomic<size_t> m_write_pos;
+};
+
+}
+
+#endif
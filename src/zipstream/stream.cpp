@@ -1,48 +1,320 @@
 #include "zipstream/stream.hpp"
+#include "zipstream/buffer_pool.hpp"
+#include "zipstream/compressibility.hpp"
+#include "zipstream/fd_writer.hpp"
 #include <zipstream/crc32sum.hpp>
 
 #include <cstring>
 
-#include <fstream>
 #include <stdexcept>
 #include <filesystem>
 #include <algorithm>
+#include <limits>
+#include <vector>
 
 namespace zipstream
 {
 
-constexpr size_t const buffer_size = 100 * 1024;
+constexpr size_t const io_buffer_size = 128 * 1024;
+constexpr size_t const toc_memory_limit = 1024 * 1024;
 
-stream::stream(std::vector<entry> && entries)
+// entries up to this size are compressed at once, larger ones incrementally
+constexpr size_t const one_shot_limit = 256 * 1024;
+constexpr size_t const compress_input_size = 64 * 1024;
+
+constexpr size_t const local_file_header_size = 30;
+constexpr size_t const data_descriptor_size = 16;
+constexpr size_t const toc_entry_size = 46;
+constexpr size_t const toc_end_size = 22;
+constexpr size_t const zip64_toc_end_size = 56;
+constexpr size_t const zip64_locator_size = 20;
+
+// extra field carrying the alignment, as written by zipalign
+constexpr uint16_t const alignment_extra_id = 0xd935;
+constexpr size_t const alignment_extra_size = 6;
+constexpr size_t const max_extra_field_size = 0xffff;
+
+namespace
+{
+
+// version needed to extract an entry of the given compression method
+uint16_t version_needed(uint16_t method)
+{
+    switch (method)
+    {
+        case 0:
+            return 10;                          // store (1.0)
+        case 8:
+            return 20;                          // deflate (2.0)
+        default:
+            return 63;                          // newer methods (6.3)
+    }
+}
+
+// the end of central directory record counts up to 65535 entries; more
+// entries are counted by a zip64 record and its locator in front of it
+size_t toc_end_size_of(size_t entry_count)
+{
+    bool const zip64 = (entry_count > std::numeric_limits<uint16_t>::max());
+    return toc_end_size + ((zip64) ? zip64_toc_end_size + zip64_locator_size : 0);
+}
+
+// pool buffers are rounded down to a size class
+size_t size_class(size_t size)
+{
+    size_t result = buffer_pool::min_buffer_size;
+    while (result < size)
+    {
+        result *= 2;
+    }
+
+    return result;
+}
+
+class table_sink: public entry_sink_i
+{
+public:
+    table_sink(entry_table & entries, std::atomic<bool> const & cancelled)
+    : m_entries(entries)
+    , m_cancelled(cancelled)
+    {
+    }
+
+    ~table_sink() override = default;
+
+    void add_directory(std::string const & name) override
+    {
+        m_entries.add_directory(name);
+    }
+
+    void add_file_with_content(std::string const & name, std::string const & content) override
+    {
+        m_entries.add_file_with_content(name, content);
+    }
+
+    void add_file_from_path(std::string const & name, std::string const & path) override
+    {
+        m_entries.add_file_from_path(name, path);
+    }
+
+    bool cancelled() const override
+    {
+        return m_cancelled;
+    }
+
+private:
+    entry_table & m_entries;
+    std::atomic<bool> const & m_cancelled;
+};
+
+}
+
+stream::stream(entry_table && entries, size_t alignment)
+: m_entries(std::make_shared<entry_table>(std::move(entries)))
+, m_buffer(toc_entry_size + m_entries->max_name_length())
+, m_pos(0)
+, m_begin(0)
+, m_end(std::numeric_limits<size_t>::max())
+, m_state(state::init)
+, m_current_entry(0)
+, m_entry_count(0)
+, m_data_pos(0)
+, m_toc_start(0)
+, m_pooled(0)
+, m_alignment(alignment)
+, m_input_pos(0)
+, m_input_size(0)
+, m_output_size(0)
+, m_compressed_pos(0)
+, m_cached_entry(0)
+, m_extent{0, 0, false}
+, m_extent_entry(std::numeric_limits<size_t>::max())
+, m_cancelled(false)
+{
+
+}
+
+stream::stream(entry_table && entries, entry_generator generator, size_t alignment)
+: stream(std::move(entries), alignment)
+{
+    m_generator = std::move(generator);
+    m_spool = std::make_unique<toc_spool>(toc_memory_limit);
+}
+
+stream::stream(entry_table && entries, archive_prefix && prefix, size_t alignment)
+: stream(std::move(entries), alignment)
+{
+    if (prefix.toc_start > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::runtime_error("archive too large");
+    }
+
+    m_buffer.reserve(toc_end_size_of(prefix.entry_count + m_entries->count()) + prefix.comment.size());
+    m_prefix = std::move(prefix);
+}
+
+stream::stream(std::shared_ptr<entry_table> entries, archive_layout const & layout, size_t begin, size_t end)
 : m_entries(std::move(entries))
-, m_buffer(buffer_size)
+, m_layout(layout)
+, m_buffer(toc_entry_size + m_entries->max_name_length())
 , m_pos(0)
+, m_begin(std::min(begin, layout.size))
+, m_end(std::min(end, layout.size))
 , m_state(state::init)
 , m_current_entry(0)
+, m_entry_count(0)
 , m_data_pos(0)
+, m_toc_start(0)
+, m_pooled(0)
+, m_alignment(layout.alignment)
+, m_input_pos(0)
+, m_input_size(0)
+, m_output_size(0)
+, m_compressed_pos(0)
+, m_cached_entry(0)
+, m_extent{0, 0, false}
+, m_extent_entry(std::numeric_limits<size_t>::max())
+{
+    if (m_begin > m_end)
+    {
+        throw std::runtime_error("invalid range");
+    }
+
+    seek(m_begin);
+}
+
+archive_layout stream::compute_layout(entry_table & entries, size_t alignment)
 {
+    size_t pos = 0;
+    for(size_t index = 0; index < entries.count(); index++)
+    {
+        if (entries.data_descriptor_needed(index))
+        {
+            throw std::runtime_error("layout requires known crc32");
+        }
+
+        entries.set_offset(index, pos);
+        pos += local_file_header_size + entries.name(index).size() + padding_size(entries, index, pos, alignment)
+            + entries.compressed_size(index);
+    }
+
+    archive_layout layout;
+    layout.alignment = alignment;
+    layout.toc_start = pos;
+    for(size_t index = 0; index < entries.count(); index++)
+    {
+        pos += toc_entry_size + entries.name(index).size();
+    }
+    layout.toc_size = pos - layout.toc_start;
+    layout.size = pos + toc_end_size_of(entries.count());
+
+    if (layout.size > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::runtime_error("archive too large");
+    }
 
+    return layout;
 }
 
-void stream::write_to_file(std::string const & path)
+size_t stream::padding_size(entry_table const & entries, size_t index, size_t offset, size_t alignment)
 {
-    std::ofstream file(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
-    char buffer[buffer_size];
+    // only stored data can be mapped directly
+    if ((alignment <= 1) || (entries.type(index) == entry_type::directory) || (entries.compression_method(index) != 0))
+    {
+        return 0;
+    }
+
+    size_t const data_start = offset + local_file_header_size + entries.name(index).size();
+    size_t padding = (alignment - (data_start % alignment)) % alignment;
+    // make room for the alignment extra field; at 64 KiB the extra field
+    // cannot hold another 64 KiB, so the data is aligned to the next 32 KiB
+    // boundary instead
+    size_t const step = ((padding + alignment) <= max_extra_field_size) ? alignment : alignment / 2;
+    while ((padding > 0) && (padding < alignment_extra_size))
+    {
+        padding += step;
+    }
 
+    return padding;
+}
+
+void stream::write_to_fd(int fd)
+{
     reset();
-    size_t count = read(buffer, buffer_size);
-    while (count > 0)
+    fd_writer writer(fd, m_pooled);
+    auto const size = expected_size();
+    if (size)
+    {
+        writer.preallocate(size.value());
+    }
+    writer.write(*this);
+}
+
+std::optional<size_t> stream::expected_size() const
+{
+    if (m_layout)
+    {
+        return m_end - m_begin;
+    }
+
+    if ((m_generator) || (m_prefix))
+    {
+        return std::nullopt;
+    }
+
+    // sizes of compressed entries are only known once they are compressed
+    auto & entries = *m_entries;
+    size_t pos = 0;
+    size_t toc_size = 0;
+    for(size_t index = 0; index < entries.count(); index++)
     {
-        file.write(buffer, count);
-        count = read(buffer, buffer_size);
+        bool const data_descriptor_needed = entries.data_descriptor_needed(index);
+        if ((data_descriptor_needed) && (entries.compression_method(index) != 0))
+        {
+            return std::nullopt;
+        }
+
+        pos += local_file_header_size + entries.name(index).size() + padding_size(entries, index, pos, m_alignment)
+            + entries.compressed_size(index) + ((data_descriptor_needed) ? data_descriptor_size : 0);
+        toc_size += toc_entry_size + entries.name(index).size();
     }
+
+    return pos + toc_size + toc_end_size_of(entries.count());
 }
 
 size_t stream::read(char * buffer, size_t buffer_size)
 {
+    if (m_controller)
+    {
+        m_controller->begin_read();
+    }
+
+    size_t const count = produce(buffer, buffer_size);
+    if ((m_controller) && (m_controller->end_read()))
+    {
+        apply_level();
+    }
+
+    return count;
+}
+
+size_t stream::produce(char * buffer, size_t buffer_size)
+{
+    if ((m_state != state::init) && ((m_end - m_pos) < buffer_size))
+    {
+        buffer_size = m_end - m_pos;
+    }
+
     size_t pos = 0;
     while ((m_state != state::done) && (pos < buffer_size))
     {
+        if ((pos > 0) && (m_state == state::file_header) && (m_generator)
+            && (m_current_entry == m_entries->count()))
+        {
+            // return available data before waiting for further entries
+            break;
+        }
+
         switch (m_state)
         {
             case state::init:
@@ -75,13 +347,19 @@ size_t stream::read(char * buffer, size_t buffer_size)
 
 void stream::skip(size_t count)
 {
-    char buffer[buffer_size];
+    if (m_layout)
+    {
+        seek(m_pos + std::min(count, m_end - m_pos));
+        return;
+    }
+
+    auto buffer = buffer_pool::instance().acquire(io_buffer_size, m_pooled);
 
     size_t remaining = count;
     while (remaining > 0)
     {
-        size_t const chunk_size = std::min(remaining, buffer_size);
-        size_t const bytes_read = read(buffer, chunk_size);
+        size_t const chunk_size = std::min(remaining, buffer.size());
+        size_t const bytes_read = read(buffer.data(), chunk_size);
         if (bytes_read == 0)
         {
             // end of stream
@@ -90,12 +368,43 @@ void stream::skip(size_t count)
 
         remaining -= bytes_read;
     }
+}
 
-    throw std::runtime_error("not implemented");
+stream_statistics stream::statistics() const
+{
+    std::lock_guard<std::mutex> lock(m_statistics_mutex);
+    return m_statistics;
+}
+
+size_t stream::memory_usage() const
+{
+    // the entries of range streams are shared and not accounted here
+    size_t const entries = (m_layout) ? 0 : m_entries->memory_usage();
+    size_t const spool = (m_spool) ? m_spool->memory_usage() : 0;
+    size_t const prefix = (m_prefix) ? m_prefix->toc.capacity() + m_prefix->comment.capacity() : 0;
+
+    return sizeof(stream) + m_buffer.capacity() + m_pooled + entries + spool + prefix;
+}
+
+void stream::cancel()
+{
+    m_cancelled = true;
 }
 
 void stream::reset()
 {
+    if ((m_generator) && (m_state != state::init))
+    {
+        throw std::runtime_error("generated stream cannot be reset");
+    }
+
+    m_cancelled = false;
+    if (m_layout)
+    {
+        seek(m_begin);
+        return;
+    }
+
     m_state = state::init;
     m_buffer.reset();
     m_current_entry = 0;
@@ -106,47 +415,45 @@ void stream::reset()
 void stream::process_init()
 {
     m_buffer.reset();
-    m_pos = 0;
+    m_pos = (m_prefix) ? m_prefix->toc_start : 0;
     m_state = state::file_header;
     m_current_entry = 0;
+    m_entry_count = 0;
     m_data_pos = 0;
     m_toc_start = 0;
+    m_input.reset();
+    m_output.reset();
+    m_cached.reset();
+
+    std::lock_guard<std::mutex> lock(m_statistics_mutex);
+    int const level = m_statistics.compression_level;
+    m_statistics = stream_statistics();
+    m_statistics.compression_level = level;
 }
 
 void stream::process_file_header(char * buffer, size_t buffer_size, size_t & pos)
 {
-    if (m_current_entry == m_entries.size())
+    if ((m_current_entry == m_entries->count()) && (!fetch_entries()))
     {
         m_buffer.reset();
         m_state = state::toc_entry;
         m_current_entry = 0;
         m_data_pos = 0;
         m_toc_start = m_pos;
+        if (m_spool)
+        {
+            m_spool->rewind();
+        }
         return;
     }
 
     if (m_buffer.empty())
     {
-        auto & entry = m_entries.at(m_current_entry);
-        entry.offset = m_pos;
-        bool data_descriptor_needed = entry.data_descriptor_needed();
-        uint16_t const flags = (data_descriptor_needed) ? 0x08 : 0x00;
-        uint32_t const crc32 = (data_descriptor_needed) ? 0 : entry.crc32();
-        uint32_t const size = (data_descriptor_needed) ? 0 : entry.size();
-        
-
-        m_buffer.write_u32(0x04034b50);             // signatue
-        m_buffer.write_u16(10);                     // version needed (default=1.0)
-        m_buffer.write_u16(flags);                  // flags 
-        m_buffer.write_u16(0);                      // compression method (store)
-        m_buffer.write_u16(0);                      // ToDo: file time
-        m_buffer.write_u16(0);                      // ToDo: file data
-        m_buffer.write_u32(crc32);                  // crc32
-        m_buffer.write_u32(size);                   // compressesd size
-        m_buffer.write_u32(size);                   // uncompressed size
-        m_buffer.write_u16(entry.name().size());    // filename length
-        m_buffer.write_u16(0);                      // extra field length
-        m_buffer.write_str(entry.name());           // filename                                        
+        if (!m_layout)
+        {
+            prepare_compression(m_current_entry);
+        }
+        write_file_header(m_current_entry);
     }
 
     size_t const count = m_buffer.read(&buffer[pos], buffer_size - pos);
@@ -158,21 +465,169 @@ void stream::process_file_header(char * buffer, size_t buffer_size, size_t & pos
         m_buffer.reset();
         m_state = state::file_data;
         m_data_pos = 0;
+        m_crc32 = crc32sum();
     }
 }
 
 void stream::process_file_data(char * buffer, size_t buffer_size, size_t & pos)
 {
-    auto & entry = m_entries.at(m_current_entry);
+    if ((m_layout) && (m_entries->compression(m_current_entry) != compression::store))
+    {
+        load_cached(m_current_entry);
+    }
+
+    if ((m_input) || (m_output) || ((m_cached) && (m_cached_entry == m_current_entry)))
+    {
+        process_compressed_data(buffer, buffer_size, pos);
+        return;
+    }
 
-    auto const count = entry.read_at(m_data_pos, &buffer[pos], buffer_size - pos);
-    entry.computed_crc32.update(&buffer[pos], count);
+    // holes of sparse files are not read
+    auto const extent = current_extent();
+    size_t const available = std::min(buffer_size - pos, (extent.offset + extent.length) - m_data_pos);
+    size_t count = available;
+    if (extent.hole)
+    {
+        memset(&buffer[pos], 0, count);
+    }
+    else
+    {
+        count = m_entries->read_at(m_current_entry, m_data_pos, &buffer[pos], available);
+    }
+
+    if (m_entries->data_descriptor_needed(m_current_entry))
+    {
+        if (extent.hole)
+        {
+            m_crc32.update_zeros(count);
+        }
+        else
+        {
+            m_crc32.update(&buffer[pos], count);
+        }
+    }
     pos += count;
     m_pos += count;
     m_data_pos += count;
 
     if (count == 0)
     {
+        if (m_entries->data_descriptor_needed(m_current_entry))
+        {
+            m_entries->set_crc32(m_current_entry, m_crc32.get_value());
+        }
+        m_buffer.reset();
+        m_state = state::data_descriptor;
+    }
+}
+
+void stream::process_compressed_data(char * buffer, size_t buffer_size, size_t & pos)
+{
+    size_t const index = m_current_entry;
+    bool finished;
+    if ((m_cached) && (m_cached_entry == index))
+    {
+        size_t const count = std::min(buffer_size - pos, m_cached->size() - m_data_pos);
+        memcpy(&buffer[pos], &m_cached->data()[m_data_pos], count);
+        pos += count;
+        m_pos += count;
+        m_data_pos += count;
+        finished = (m_data_pos == m_cached->size());
+    }
+    else if (m_output)
+    {
+        size_t const count = std::min(buffer_size - pos, m_output_size - m_compressed_pos);
+        memcpy(&buffer[pos], &m_output->data()[m_compressed_pos], count);
+        pos += count;
+        m_pos += count;
+        m_compressed_pos += count;
+        finished = (m_compressed_pos == m_output_size);
+    }
+    else
+    {
+        size_t const size = m_entries->size(index);
+        auto & compressor = compressor_for(m_entries->compression(index));
+        if ((m_input_pos == m_input_size) && (m_data_pos < size))
+        {
+            // the previous input is consumed; holes are neither read nor compressed byte by byte
+            auto const extent = current_extent();
+            size_t const available = std::min(m_input->size(), (extent.offset + extent.length) - m_data_pos);
+            size_t const zeros = (extent.hole) ? compressor.add_zeros(extent.offset + extent.length - m_data_pos) : 0;
+            m_input_pos = 0;
+            m_input_size = 0;
+            if (zeros > 0)
+            {
+                m_crc32.update_zeros(zeros);
+                m_data_pos += zeros;
+            }
+            else if (extent.hole)
+            {
+                memset(m_input->data(), 0, available);
+                m_input_size = available;
+                m_crc32.update_zeros(m_input_size);
+                m_data_pos += m_input_size;
+            }
+            else
+            {
+                m_input_size = m_entries->read_at(index, m_data_pos, m_input->data(), available);
+                if (m_input_size == 0)
+                {
+                    throw std::runtime_error("failed to read file");
+                }
+
+                m_crc32.update(m_input->data(), m_input_size);
+                m_data_pos += m_input_size;
+            }
+        }
+
+        char const * input = &m_input->data()[m_input_pos];
+        size_t input_size = m_input_size - m_input_pos;
+        char * output = &buffer[pos];
+        size_t output_size = buffer_size - pos;
+        finished = compressor.compress(input, input_size, output, output_size, m_data_pos == size);
+
+        size_t const count = (buffer_size - pos) - output_size;
+        if (m_cache_key)
+        {
+            if ((m_fill.size() + count) <= m_cache->max_payload_size())
+            {
+                m_fill.append(&buffer[pos], count);
+            }
+            else
+            {
+                // too large to be cached
+                m_cache_key.reset();
+                std::string().swap(m_fill);
+            }
+        }
+
+        m_input_pos = m_input_size - input_size;
+        pos += count;
+        m_pos += count;
+        m_compressed_pos += count;
+        if ((finished) && (m_compressed_pos > std::numeric_limits<uint32_t>::max()))
+        {
+            throw std::runtime_error("archive too large");
+        }
+    }
+
+    if (finished)
+    {
+        if (m_input)
+        {
+            m_entries->set_crc32(index, m_crc32.get_value());
+            m_entries->set_compressed_size(index, static_cast<uint32_t>(m_compressed_pos));
+            if (m_cache_key)
+            {
+                m_cache->insert(m_cache_key.value(), m_crc32.get_value(), std::move(m_fill));
+            }
+        }
+
+        m_input.reset();
+        m_output.reset();
+        m_cached.reset();
+        m_cache_key.reset();
+        m_fill.clear();
         m_buffer.reset();
         m_state = state::data_descriptor;
     }
@@ -180,20 +635,19 @@ void stream::process_file_data(char * buffer, size_t buffer_size, size_t & pos)
 
 void stream::process_data_descriptor(char * buffer, size_t buffer_size, size_t & pos)
 {
-    auto & entry = m_entries.at(m_current_entry);
-    if (!entry.data_descriptor_needed())
+    size_t const index = m_current_entry;
+    if (!m_entries->data_descriptor_needed(index))
     {
-        m_current_entry++;
-        m_state = state::file_header;    
+        complete_entry();
         return;
     }
 
     if (m_buffer.empty())
     {
         m_buffer.write_u32(0x08074b50);
-        m_buffer.write_u32(entry.computed_crc32.get_value());
-        m_buffer.write_u32(entry.size());
-        m_buffer.write_u32(entry.size());
+        m_buffer.write_u32(m_entries->crc32(index));
+        m_buffer.write_u32(m_entries->compressed_size(index));
+        m_buffer.write_u32(m_entries->size(index));
     }
 
     size_t const count = m_buffer.read(&buffer[pos], buffer_size - pos);
@@ -202,14 +656,37 @@ void stream::process_data_descriptor(char * buffer, size_t buffer_size, size_t &
 
     if (m_buffer.empty())
     {
-        m_current_entry++;
-        m_state = state::file_header;    
+        complete_entry();
     }
 }
 
 void stream::process_toc_entry(char * buffer, size_t buffer_size, size_t & pos)
 {
-    if (m_current_entry >= m_entries.size())
+    if ((m_prefix) && (m_data_pos < m_prefix->toc.size()))
+    {
+        // central directory records of the existing entries come first
+        size_t const count = std::min(buffer_size - pos, m_prefix->toc.size() - m_data_pos);
+        memcpy(&buffer[pos], &m_prefix->toc[m_data_pos], count);
+        pos += count;
+        m_pos += count;
+        m_data_pos += count;
+        return;
+    }
+
+    if (m_spool)
+    {
+        size_t const count = m_spool->read(&buffer[pos], buffer_size - pos);
+        pos += count;
+        m_pos += count;
+
+        if (count == 0)
+        {
+            m_state = state::toc_end;
+        }
+        return;
+    }
+
+    if (m_current_entry >= m_entries->count())
     {
         m_buffer.reset();
         m_state = state::toc_end;
@@ -219,25 +696,7 @@ void stream::process_toc_entry(char * buffer, size_t buffer_size, size_t & pos)
 
     if (m_buffer.empty())
     {
-        auto const & entry = m_entries.at(m_current_entry);
-        m_buffer.write_u32(0x02014b50);             // central file header signature
-        m_buffer.write_u16(0x031e);                 // version made by (unix=3, 30 [same as zip utility])
-        m_buffer.write_u16(10);                     // version needed to extract (default=1.0)
-        m_buffer.write_u16(0);                      // flags (none)
-        m_buffer.write_u16(0);                      // compression method (store)
-        m_buffer.write_u16(0);                      // ToDo: last mod file time
-        m_buffer.write_u16(0);                      // ToDo: last mod file date
-        m_buffer.write_u32(entry.computed_crc32.get_value());          // crc32
-        m_buffer.write_u32(entry.size());           // compressed size
-        m_buffer.write_u32(entry.size());           // uncompressed size
-        m_buffer.write_u16(entry.name().size());    // filename length
-        m_buffer.write_u16(0);                      // entry length
-        m_buffer.write_u16(0);                      // comment length
-        m_buffer.write_u16(0);                      // disk number start
-        m_buffer.write_u16(0);                      // internal attributes (none)
-        m_buffer.write_u32(0x81b40000);             // ToDo: external attributes (reg file)
-        m_buffer.write_u32(entry.offset);           // offset of local file header
-        m_buffer.write_str(entry.name());                
+        write_toc_entry(toc_index(m_current_entry));
     }
 
     size_t const count = m_buffer.read(&buffer[pos], buffer_size - pos);
@@ -255,16 +714,7 @@ void stream::process_toc_end(char * buffer, size_t buffer_size, size_t & pos)
 {
     if (m_buffer.empty())
     {
-        size_t const toc_end = m_pos;
-        size_t const toc_size = toc_end - m_toc_start;
-        m_buffer.write_u32(0x06054b50);         // end of central directory record signature
-        m_buffer.write_u16(0);                  // number of this disk
-        m_buffer.write_u16(0);                  // number of disk with start of eocd
-        m_buffer.write_u16(m_entries.size());   // number of entries in this disk
-        m_buffer.write_u16(m_entries.size());   // total number of entries
-        m_buffer.write_u32(toc_size);           // size of central directory
-        m_buffer.write_u32(m_toc_start);        // start of central directory
-        m_buffer.write_u16(0);                  // comment length
+        write_toc_end();
     }
 
     size_t const count = m_buffer.read(&buffer[pos], buffer_size - pos);
@@ -278,4 +728,550 @@ void stream::process_toc_end(char * buffer, size_t buffer_size, size_t & pos)
 }
 
 
+bool stream::fetch_entries()
+{
+    if (!m_generator)
+    {
+        return false;
+    }
+
+    // entries of the current window are completed and already spooled
+    m_entries->clear();
+    m_current_entry = 0;
+
+    table_sink sink(*m_entries, m_cancelled);
+    while (m_entries->count() == 0)
+    {
+        bool const more = m_generator(sink);
+        if (m_cancelled)
+        {
+            throw std::runtime_error("stream cancelled");
+        }
+
+        if (!more)
+        {
+            break;
+        }
+    }
+
+    return (m_entries->count() > 0);
+}
+
+void stream::complete_entry()
+{
+    if (m_spool)
+    {
+        write_toc_entry(m_current_entry);
+        m_spool->append(m_buffer);
+        m_buffer.reset();
+    }
+
+    {
+        auto & entries = *m_entries;
+        std::lock_guard<std::mutex> lock(m_statistics_mutex);
+        m_statistics.entries++;
+        if (entries.compression(m_current_entry) != compression::store)
+        {
+            m_statistics.compressed_entries++;
+        }
+        m_statistics.uncompressed_bytes += entries.size(m_current_entry);
+        m_statistics.compressed_bytes += entries.compressed_size(m_current_entry);
+    }
+
+    m_current_entry++;
+    m_entry_count++;
+    m_extent_entry = std::numeric_limits<size_t>::max();
+    m_state = state::file_header;
+}
+
+// Small entries are compressed before their header is written, so that
+// the header carries sizes and CRC and no data descriptor is needed.
+// With a compression policy, entries that do not compress well enough
+// are stored instead; large entries are judged by their first block.
+void stream::prepare_compression(size_t index)
+{
+    auto & entries = *m_entries;
+    auto const backend = entries.compression(index);
+    m_input.reset();
+    m_output.reset();
+    m_input_pos = 0;
+    m_input_size = 0;
+    m_output_size = 0;
+    m_compressed_pos = 0;
+    m_cached.reset();
+    m_cache_key.reset();
+    m_fill.clear();
+    if (backend == compression::store)
+    {
+        return;
+    }
+
+    if ((m_cache) && (entries.type(index) == entry_type::file_from_path))
+    {
+        m_cache_key = content_cache::key_of(entries.path(index), backend, current_level());
+        auto const cached = m_cache->find(m_cache_key.value());
+        if ((cached) && (cached->size == entries.size(index))
+            && (cached->data->size() <= std::numeric_limits<uint32_t>::max()))
+        {
+            entries.set_known_crc32(index, cached->crc32);
+            entries.set_known_compressed_size(index, static_cast<uint32_t>(cached->data->size()));
+            m_cached = cached->data;
+            m_cached_entry = index;
+            m_cache_key.reset();
+            return;
+        }
+    }
+
+    auto const * policy = (entries.compression_forced(index)) ? nullptr : entries.policy();
+    auto const pays_off = [policy](size_t size, size_t compressed) {
+        return (compressed > 0) && (static_cast<double>(compressed) <= ((1.0 - policy->min_savings) * size));
+    };
+
+    auto & pool = buffer_pool::instance();
+    auto & compressor = compressor_for(backend);
+    compressor.reset();
+
+    size_t const size = entries.size(index);
+    size_t const bound = compressor.bound(size);
+    if (size <= one_shot_limit)
+    {
+        auto input = pool.acquire(size_class(size), m_pooled);
+        auto output = pool.acquire(size_class(bound), m_pooled);
+        if ((input.size() >= size) && (output.size() >= bound))
+        {
+            size_t count = 0;
+            while (count < size)
+            {
+                size_t const bytes_read = entries.read_at(index, count, &input.data()[count], size - count);
+                if (bytes_read == 0)
+                {
+                    throw std::runtime_error("failed to read file");
+                }
+                count += bytes_read;
+            }
+
+            crc32sum checksum;
+            checksum.update(input.data(), size);
+            auto const estimate = (policy != nullptr)
+                ? estimate_compressibility(input.data(), size, policy->min_savings) : compressibility::compress;
+            if (estimate != compressibility::store)
+            {
+                m_output_size = compressor.compress_all(input.data(), size, output.data(), output.size());
+            }
+
+            if ((estimate == compressibility::store)
+                || ((estimate == compressibility::unknown) && (!pays_off(size, m_output_size))))
+            {
+                m_cache_key.reset();
+                entries.set_stored(index);
+                entries.set_known_crc32(index, checksum.get_value());
+                count_incompressible();
+                return;
+            }
+
+            if (m_output_size > 0)
+            {
+                entries.set_known_crc32(index, checksum.get_value());
+                entries.set_known_compressed_size(index, static_cast<uint32_t>(m_output_size));
+                if (m_cache_key)
+                {
+                    m_cache->insert(m_cache_key.value(), checksum.get_value(),
+                        std::string(output.data(), m_output_size));
+                    m_cache_key.reset();
+                }
+                m_output.emplace(std::move(output));
+                return;
+            }
+        }
+    }
+
+    auto input = pool.acquire(compress_input_size, m_pooled);
+    if (policy != nullptr)
+    {
+        size_t const sample_size = entries.read_at(index, 0, input.data(), std::min(input.size(), size));
+        auto estimate = estimate_compressibility(input.data(), sample_size, policy->min_savings);
+        if (estimate == compressibility::unknown)
+        {
+            size_t const sample_bound = compressor.bound(sample_size);
+            auto output = pool.acquire(size_class(sample_bound), m_pooled);
+            size_t const compressed = (output.size() >= sample_bound)
+                ? compressor.compress_all(input.data(), sample_size, output.data(), output.size()) : 0;
+            estimate = (pays_off(sample_size, compressed)) ? compressibility::compress : compressibility::store;
+        }
+
+        if (estimate == compressibility::store)
+        {
+            m_cache_key.reset();
+            entries.set_stored(index);
+            count_incompressible();
+            return;
+        }
+    }
+
+    m_input.emplace(std::move(input));
+}
+
+void stream::set_level_range(int min_level, int max_level)
+{
+    m_controller = std::make_unique<level_controller>(min_level, max_level);
+    apply_level();
+}
+
+void stream::apply_level()
+{
+    int const level = m_controller->level();
+    for(auto & compressor: m_compressors)
+    {
+        if (compressor)
+        {
+            compressor->set_level(level);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_statistics_mutex);
+    m_statistics.compression_level = level;
+}
+
+void stream::count_incompressible()
+{
+    std::lock_guard<std::mutex> lock(m_statistics_mutex);
+    m_statistics.incompressible_entries++;
+}
+
+compressor_i & stream::compressor_for(compression backend)
+{
+    auto & compressor = m_compressors[static_cast<size_t>(backend)];
+    if (!compressor)
+    {
+        compressor = make_compressor(backend, current_level());
+    }
+
+    return *compressor;
+}
+
+file_extent stream::current_extent()
+{
+    if ((m_extent_entry != m_current_entry) || (m_data_pos < m_extent.offset)
+        || (m_data_pos >= (m_extent.offset + m_extent.length)))
+    {
+        m_extent = m_entries->extent_at(m_current_entry, m_data_pos);
+        m_extent_entry = m_current_entry;
+    }
+
+    return m_extent;
+}
+
+int stream::current_level() const
+{
+    return (m_controller) ? m_controller->level() : m_entries->compression_level();
+}
+
+void stream::set_toc_order(std::shared_ptr<std::vector<uint32_t> const> order)
+{
+    if ((order) && ((m_spool) || (order->size() != m_entries->count())))
+    {
+        throw std::runtime_error("invalid entry order");
+    }
+
+    m_toc_order = std::move(order);
+    if (m_layout)
+    {
+        // the range may start within the central directory
+        seek(m_begin);
+    }
+}
+
+size_t stream::toc_index(size_t position) const
+{
+    return (m_toc_order) ? (*m_toc_order)[position] : position;
+}
+
+void stream::set_content_cache(std::shared_ptr<content_cache> cache)
+{
+    m_cache = std::move(cache);
+}
+
+// range streams emit compressed entries from the cache; their sizes
+// were determined by range_source using the same cache
+void stream::load_cached(size_t index)
+{
+    if ((m_cached) && (m_cached_entry == index))
+    {
+        return;
+    }
+
+    auto & entries = *m_entries;
+    auto const content = cached_content_of(entries, index, *m_cache, compressor_for(entries.compression(index)),
+        current_level());
+    if ((content.crc32 != entries.crc32(index)) || (content.data->size() != entries.compressed_size(index)))
+    {
+        throw std::runtime_error("cached content changed");
+    }
+
+    m_cached = content.data;
+    m_cached_entry = index;
+}
+
+cached_content stream::cached_content_of(entry_table & entries, size_t index, content_cache & cache,
+    compressor_i & compressor, int level)
+{
+    size_t const size = entries.size(index);
+    auto const key = content_cache::key_of(entries.path(index), entries.compression(index), level);
+    auto cached = cache.find(key);
+    if ((cached) && (cached->size == size))
+    {
+        return cached.value();
+    }
+
+    // compressed as a whole, in chunks
+    std::vector<char> input(compress_input_size);
+    std::string output(compressor.bound(std::min(size, compress_input_size)), '\0');
+    size_t output_size = 0;
+    size_t offset = 0;
+    crc32sum checksum;
+    compressor.reset();
+    bool finished = false;
+    while (!finished)
+    {
+        size_t const count = (offset < size)
+            ? entries.read_at(index, offset, input.data(), std::min(input.size(), size - offset)) : 0;
+        if ((count == 0) && (offset < size))
+        {
+            throw std::runtime_error("failed to read file");
+        }
+        checksum.update(input.data(), count);
+        offset += count;
+
+        char const * in = input.data();
+        size_t in_size = count;
+        do
+        {
+            if (output_size == output.size())
+            {
+                output.resize(output.size() * 2);
+            }
+
+            char * out = &output[output_size];
+            size_t out_size = output.size() - output_size;
+            finished = compressor.compress(in, in_size, out, out_size, offset == size);
+            output_size = output.size() - out_size;
+        } while ((in_size > 0) || ((offset == size) && (!finished)));
+    }
+    compressor.reset();
+
+    output.resize(output_size);
+    if (output.size() > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::runtime_error("archive too large");
+    }
+
+    return cache.insert(key, checksum.get_value(), std::move(output));
+}
+
+void stream::seek(size_t position)
+{
+    auto & entries = *m_entries;
+    auto const & layout = m_layout.value();
+    m_buffer.reset();
+    m_data_pos = 0;
+    m_toc_start = layout.toc_start;
+
+    if (position >= layout.size)
+    {
+        m_pos = layout.size;
+        m_state = state::done;
+        return;
+    }
+
+    if (position < layout.toc_start)
+    {
+        // find the last entry starting at or before position; offsets are ascending
+        size_t first = 0;
+        size_t last = entries.count();
+        while ((last - first) > 1)
+        {
+            size_t const middle = first + ((last - first) / 2);
+            if (entries.offset(middle) <= position)
+            {
+                first = middle;
+            }
+            else
+            {
+                last = middle;
+            }
+        }
+
+        m_current_entry = first;
+        m_entry_count = first;
+        m_pos = entries.offset(first);
+        size_t const header_size = local_file_header_size + entries.name(first).size()
+            + padding_size(entries, first, m_pos, m_alignment);
+        size_t const relative = position - m_pos;
+        if (relative < header_size)
+        {
+            m_state = state::file_header;
+            if (relative > 0)
+            {
+                write_file_header(first);
+                m_buffer.skip(relative);
+            }
+        }
+        else
+        {
+            m_state = state::file_data;
+            m_data_pos = relative - header_size;
+        }
+
+        m_pos = position;
+        return;
+    }
+
+    m_entry_count = entries.count();
+    size_t const toc_end = layout.toc_start + layout.toc_size;
+    if (position < toc_end)
+    {
+        size_t index = 0;
+        size_t offset = layout.toc_start;
+        while ((offset + toc_entry_size + entries.name(toc_index(index)).size()) <= position)
+        {
+            offset += toc_entry_size + entries.name(toc_index(index)).size();
+            index++;
+        }
+
+        m_state = state::toc_entry;
+        m_current_entry = index;
+        if (position > offset)
+        {
+            write_toc_entry(toc_index(index));
+            m_buffer.skip(position - offset);
+        }
+    }
+    else
+    {
+        m_state = state::toc_end;
+        m_pos = toc_end;
+        write_toc_end();
+        m_buffer.skip(position - toc_end);
+    }
+
+    m_pos = position;
+}
+
+void stream::write_file_header(size_t index)
+{
+    auto & entries = *m_entries;
+    if (!m_layout)
+    {
+        if (m_pos > std::numeric_limits<uint32_t>::max())
+        {
+            throw std::runtime_error("archive too large");
+        }
+        entries.set_offset(index, m_pos);
+    }
+
+    bool data_descriptor_needed = entries.data_descriptor_needed(index);
+    uint16_t const flags = (data_descriptor_needed) ? 0x08 : 0x00;
+    uint32_t const crc32 = (data_descriptor_needed) ? 0 : entries.crc32(index);
+    uint32_t const size = (data_descriptor_needed) ? 0 : entries.size(index);
+    uint32_t const compressed_size = (data_descriptor_needed) ? 0 : entries.compressed_size(index);
+    uint16_t const method = entries.compression_method(index);
+    auto const name = entries.name(index);
+    size_t const offset = (m_layout) ? entries.offset(index) : m_pos;
+    size_t const padding = padding_size(entries, index, offset, m_alignment);
+
+    m_buffer.reserve(local_file_header_size + name.size() + padding);
+    m_buffer.write_u32(0x04034b50);             // signatue
+    m_buffer.write_u16(version_needed(method)); // version needed
+    m_buffer.write_u16(flags);                  // flags 
+    m_buffer.write_u16(method);                 // compression method
+    m_buffer.write_u16(0);                      // ToDo: file time
+    m_buffer.write_u16(0);                      // ToDo: file data
+    m_buffer.write_u32(crc32);                  // crc32
+    m_buffer.write_u32(compressed_size);        // compressesd size
+    m_buffer.write_u32(size);                   // uncompressed size
+    m_buffer.write_u16(name.size());            // filename length
+    m_buffer.write_u16(padding);                // extra field length
+    m_buffer.write_str(name);                   // filename
+    if (padding > 0)
+    {
+        // padding is never smaller than the extra field header
+        size_t const data_start = offset + local_file_header_size + name.size() + padding;
+        size_t const aligned = ((data_start % m_alignment) == 0) ? m_alignment : m_alignment / 2;
+        m_buffer.write_u16(alignment_extra_id); // alignment extra field
+        m_buffer.write_u16(padding - 4);        // size of extra field data
+        m_buffer.write_u16((aligned <= 0xffff) ? aligned : 0);
+        m_buffer.write_zeros(padding - alignment_extra_size);
+    }
+}
+
+void stream::write_toc_entry(size_t index)
+{
+    auto const name = m_entries->name(index);
+    uint16_t const method = m_entries->compression_method(index);
+    uint16_t const flags = (m_entries->data_descriptor_needed(index)) ? 0x08 : 0x00;
+    m_buffer.reserve(toc_entry_size + name.size());
+    m_buffer.write_u32(0x02014b50);             // central file header signature
+    m_buffer.write_u16(0x031e);                 // version made by (unix=3, 30 [same as zip utility])
+    m_buffer.write_u16(version_needed(method)); // version needed to extract
+    m_buffer.write_u16(flags);                  // flags
+    m_buffer.write_u16(method);                 // compression method
+    m_buffer.write_u16(0);                      // ToDo: last mod file time
+    m_buffer.write_u16(0);                      // ToDo: last mod file date
+    m_buffer.write_u32(m_entries->crc32(index)); // crc32
+    m_buffer.write_u32(m_entries->compressed_size(index)); // compressed size
+    m_buffer.write_u32(m_entries->size(index));  // uncompressed size
+    m_buffer.write_u16(name.size());            // filename length
+    m_buffer.write_u16(0);                      // entry length
+    m_buffer.write_u16(0);                      // comment length
+    m_buffer.write_u16(0);                      // disk number start
+    m_buffer.write_u16(0);                      // internal attributes (none)
+    m_buffer.write_u32(0x81b40000);             // ToDo: external attributes (reg file)
+    m_buffer.write_u32(m_entries->offset(index)); // offset of local file header
+    m_buffer.write_str(name);
+}
+
+void stream::write_toc_end()
+{
+    size_t const toc_end = m_pos;
+    size_t const toc_size = toc_end - m_toc_start;
+    size_t const entry_count = m_entry_count + ((m_prefix) ? m_prefix->entry_count : 0);
+    std::string_view const comment = (m_prefix) ? m_prefix->comment : std::string_view();
+    if (toc_end > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::runtime_error("archive too large");
+    }
+
+    bool const zip64 = (entry_count > std::numeric_limits<uint16_t>::max());
+    m_buffer.reserve(toc_end_size_of(entry_count) + comment.size());
+    if (zip64)
+    {
+        m_buffer.write_u32(0x06064b50);     // zip64 end of central directory record signature
+        m_buffer.write_u64(44);             // size of the remaining record
+        m_buffer.write_u16(0x032d);         // version made by (unix=3, 4.5)
+        m_buffer.write_u16(45);             // version needed to extract (zip64 = 4.5)
+        m_buffer.write_u32(0);              // number of this disk
+        m_buffer.write_u32(0);              // number of disk with start of central directory
+        m_buffer.write_u64(entry_count);    // number of entries in this disk
+        m_buffer.write_u64(entry_count);    // total number of entries
+        m_buffer.write_u64(toc_size);       // size of central directory
+        m_buffer.write_u64(m_toc_start);    // start of central directory
+
+        m_buffer.write_u32(0x07064b50);     // zip64 end of central directory locator signature
+        m_buffer.write_u32(0);              // number of disk with start of zip64 record
+        m_buffer.write_u64(toc_end);        // start of zip64 record
+        m_buffer.write_u32(1);              // total number of disks
+    }
+
+    uint16_t const eocd_entry_count = (zip64) ? 0xffff : static_cast<uint16_t>(entry_count);
+    m_buffer.write_u32(0x06054b50);         // end of central directory record signature
+    m_buffer.write_u16(0);                  // number of this disk
+    m_buffer.write_u16(0);                  // number of disk with start of eocd
+    m_buffer.write_u16(eocd_entry_count);   // number of entries in this disk
+    m_buffer.write_u16(eocd_entry_count);   // total number of entries
+    m_buffer.write_u32(toc_size);           // size of central directory
+    m_buffer.write_u32(m_toc_start);        // start of central directory
+    m_buffer.write_u16(comment.size());     // comment length
+    m_buffer.write_str(comment);            // comment
+}
+
 }
\ No newline at end of file
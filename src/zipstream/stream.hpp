@@ -1,10 +1,22 @@
 #ifndef ZIPSTREAM_STREAM_HPP
 #define ZIPSTREAM_STREAM_HPP
 
-#include "zipstream/entry.hpp"
+#include "zipstream/entry_table.hpp"
 #include "zipstream/stream_i.hpp"
 #include "zipstream/buffer.hpp"
+#include "zipstream/crc32sum.hpp"
+#include "zipstream/toc_spool.hpp"
+#include "zipstream/compressor.hpp"
+#include "zipstream/buffer_pool.hpp"
+#include "zipstream/level_controller.hpp"
+#include <zipstream/content_cache.hpp>
+#include "zipstream/entry_generator.hpp"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <vector>
 
 namespace zipstream
@@ -21,32 +33,132 @@ enum class state
     done
 };
 
+// positions of an archive whose entries have known sizes and CRCs
+struct archive_layout
+{
+    size_t toc_start;
+    size_t toc_size;
+    size_t size;
+    size_t alignment;
+};
+
+// existing archive extended by a stream; the stream starts at toc_start
+struct archive_prefix
+{
+    size_t toc_start;
+    std::string toc;
+    size_t entry_count;
+    std::string comment;
+};
+
 class stream: public stream_i
 {
 public:
-    explicit stream(std::vector<entry> && entries);
+    explicit stream(entry_table && entries, size_t alignment = 0);
+    stream(entry_table && entries, entry_generator generator, size_t alignment = 0);
+    stream(entry_table && entries, archive_prefix && prefix, size_t alignment = 0);
+    stream(std::shared_ptr<entry_table> entries, archive_layout const & layout, size_t begin, size_t end);
     ~stream() override = default;
-    void write_to_file(std::string const & path) override;
+    void write_to_fd(int fd) override;
     size_t read(char * buffer, size_t buffer_size) override;
     void skip(size_t count) override;
     void reset() override;
+    size_t memory_usage() const override;
+    stream_statistics statistics() const override;
+    std::optional<size_t> expected_size() const override;
+    void cancel() override;
+
+    // adapts the compression level within the range to the consumer speed
+    void set_level_range(int min_level, int max_level);
+
+    // record i of the central directory describes entry order[i]
+    void set_toc_order(std::shared_ptr<std::vector<uint32_t> const> order);
+
+    // compressed files are taken from and added to the cache
+    void set_content_cache(std::shared_ptr<content_cache> cache);
+
+    // compressed payload of a file_from_path entry, compressed on a miss
+    static cached_content cached_content_of(entry_table & entries, size_t index, content_cache & cache,
+        compressor_i & compressor, int level);
+
+    // sets the offsets of all entries; all sizes and CRCs must be known
+    static archive_layout compute_layout(entry_table & entries, size_t alignment = 0);
+
+    // size of the local header extra field that aligns the data of an entry
+    static size_t padding_size(entry_table const & entries, size_t index, size_t offset, size_t alignment);
 
 private:
+    size_t produce(char * buffer, size_t buffer_size);
     void process_init();
     void process_file_header(char * buffer, size_t buffer_size, size_t & pos);
     void process_file_data(char * buffer, size_t buffer_size, size_t & pos);
+    void process_compressed_data(char * buffer, size_t buffer_size, size_t & pos);
     void process_data_descriptor(char * buffer, size_t buffer_size, size_t & pos);
     void process_toc_entry(char * buffer, size_t buffer_size, size_t & pos);
     void process_toc_end(char * buffer, size_t buffer_size, size_t & pos);
+    bool fetch_entries();
+    void complete_entry();
+    void prepare_compression(size_t index);
+    compressor_i & compressor_for(compression backend);
+    void count_incompressible();
+    void apply_level();
+    int current_level() const;
+    void load_cached(size_t index);
+    file_extent current_extent();
+    size_t toc_index(size_t position) const;
+    void seek(size_t position);
+    void write_file_header(size_t index);
+    void write_toc_entry(size_t index);
+    void write_toc_end();
 
-    std::vector<entry> m_entries;
+    std::shared_ptr<entry_table> m_entries;
+    entry_generator m_generator;
+    std::unique_ptr<toc_spool> m_spool;
+    std::optional<archive_layout> m_layout;
 
     buffer m_buffer;
     size_t m_pos;
+    size_t m_begin;
+    size_t m_end;
     state m_state;
     size_t m_current_entry;
+    size_t m_entry_count;
     size_t m_data_pos;
+    crc32sum m_crc32;
     size_t m_toc_start;
+    size_t m_pooled;
+    size_t m_alignment;
+    std::optional<archive_prefix> m_prefix;
+    std::shared_ptr<std::vector<uint32_t> const> m_toc_order;
+
+    // compression of the current entry; small entries are compressed
+    // into m_output at once, others are compressed from m_input
+    std::unique_ptr<compressor_i> m_compressors[4];
+    std::optional<pooled_buffer> m_input;
+    std::optional<pooled_buffer> m_output;
+    size_t m_input_pos;
+    size_t m_input_size;
+    size_t m_output_size;
+    size_t m_compressed_pos;
+    std::unique_ptr<level_controller> m_controller;
+
+    // payload of a cached entry; m_fill collects the output of a miss
+    std::shared_ptr<content_cache> m_cache;
+    std::optional<content_key> m_cache_key;
+    std::shared_ptr<std::string const> m_cached;
+    size_t m_cached_entry;
+    std::string m_fill;
+
+    // data or hole of the current entry at m_data_pos
+    file_extent m_extent;
+    size_t m_extent_entry;
+
+    // read by other threads, e.g. the consumer of a pipelined stream
+    mutable std::mutex m_statistics_mutex;
+    stream_statistics m_statistics;
+
+    // set by cancel() from another thread
+    std::atomic<bool> m_cancelled;
 
 };
 
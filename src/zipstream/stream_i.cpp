@@ -0,0 +1,45 @@
+#include <zipstream/stream_i.hpp>
+#include "zipstream/fd_writer.hpp"
+
+namespace zipstream
+{
+
+void stream_i::write_to_file(std::string const & path)
+{
+    write_to_file(path, write_mode::buffered);
+}
+
+void stream_i::write_to_file(std::string const & path, write_mode mode)
+{
+    write_to_path(*this, path, mode);
+}
+
+void stream_i::write_to_fd(int fd)
+{
+    reset();
+    size_t pooled = 0;
+    fd_writer writer(fd, pooled);
+    auto const size = expected_size();
+    if (size)
+    {
+        writer.preallocate(size.value());
+    }
+    writer.write(*this);
+}
+
+size_t stream_i::memory_usage() const
+{
+    return 0;
+}
+
+stream_statistics stream_i::statistics() const
+{
+    return stream_statistics();
+}
+
+std::optional<size_t> stream_i::expected_size() const
+{
+    return std::nullopt;
+}
+
+}
@@ -0,0 +1,79 @@
+#include "zipstream/string_arena.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace zipstream
+{
+
+// position = chunk index (upper 32 bits) | offset within chunk (lower 32 bits)
+
+uint64_t string_arena::add(std::string_view value)
+{
+    size_t const needed = value.size() + 1;
+
+    size_t index = m_current;
+    if ((index >= m_chunks.size()) || ((m_chunks[index].capacity - m_chunks[index].used) < needed))
+    {
+        // large strings get a dedicated chunk and do not replace the current one
+        size_t const standard_size = std::min(chunk_size, initial_chunk_size << std::min<size_t>(m_chunks.size(), 16));
+        size_t const capacity = (needed > standard_size) ? needed : standard_size;
+        m_chunks.push_back({std::unique_ptr<char[]>(new char[capacity]), capacity, 0});
+        index = m_chunks.size() - 1;
+        if (capacity == standard_size)
+        {
+            m_current = index;
+        }
+    }
+
+    auto & target = m_chunks[index];
+    size_t const offset = target.used;
+    memcpy(&target.data[offset], value.data(), value.size());
+    target.data[offset + value.size()] = '\0';
+    target.used += needed;
+
+    return (static_cast<uint64_t>(index) << 32) | offset;
+}
+
+std::string_view string_arena::get(uint64_t position, size_t length) const
+{
+    return std::string_view(c_str(position), length);
+}
+
+char const * string_arena::c_str(uint64_t position) const
+{
+    size_t const index = static_cast<size_t>(position >> 32);
+    size_t const offset = static_cast<size_t>(position & 0xffffffff);
+
+    return &m_chunks.at(index).data[offset];
+}
+
+void string_arena::clear()
+{
+    // keep the current chunk for reuse
+    if (m_current < m_chunks.size())
+    {
+        chunk current = std::move(m_chunks[m_current]);
+        current.used = 0;
+        m_chunks.clear();
+        m_chunks.push_back(std::move(current));
+    }
+    else
+    {
+        m_chunks.clear();
+    }
+    m_current = 0;
+}
+
+size_t string_arena::memory_usage() const
+{
+    size_t result = m_chunks.capacity() * sizeof(chunk);
+    for(auto const & item: m_chunks)
+    {
+        result += item.capacity;
+    }
+
+    return result;
+}
+
+}
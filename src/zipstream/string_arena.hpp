@@ -0,0 +1,51 @@
+#ifndef ZIPSTREAM_STRING_ARENA_HPP
+#define ZIPSTREAM_STRING_ARENA_HPP
+
+#include <cinttypes>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace zipstream
+{
+
+// Append-only storage for many small strings.
+// Strings are stored null-terminated in chunks, so that growing the
+// arena never moves already stored strings. Chunks start small and
+// double in size up to chunk_size.
+class string_arena
+{
+    string_arena(string_arena const &) = delete;
+    string_arena& operator=(string_arena const &) = delete;
+public:
+    static constexpr size_t const initial_chunk_size = 1024;
+    static constexpr size_t const chunk_size = 256 * 1024;
+
+    string_arena() = default;
+    ~string_arena() = default;
+    string_arena(string_arena &&) = default;
+    string_arena& operator=(string_arena &&) = default;
+
+    uint64_t add(std::string_view value);
+    std::string_view get(uint64_t position, size_t length) const;
+    char const * c_str(uint64_t position) const;
+    void clear();
+
+    size_t memory_usage() const;
+
+private:
+    struct chunk
+    {
+        std::unique_ptr<char[]> data;
+        size_t capacity;
+        size_t used;
+    };
+
+    std::vector<chunk> m_chunks;
+    size_t m_current = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,109 @@
+#include "zipstream/toc_spool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace zipstream
+{
+
+toc_spool::toc_spool(size_t memory_limit)
+: m_memory_limit(memory_limit)
+, m_file(nullptr)
+, m_file_size(0)
+, m_read_pos(0)
+{
+
+}
+
+toc_spool::~toc_spool()
+{
+    if (m_file != nullptr)
+    {
+        fclose(m_file);
+    }
+}
+
+void toc_spool::append(buffer & source)
+{
+    size_t const count = source.size();
+    if ((m_memory.size() + count) > m_memory_limit)
+    {
+        flush();
+    }
+
+    size_t const offset = m_memory.size();
+    m_memory.resize(offset + count);
+    source.read(&m_memory[offset], count);
+}
+
+size_t toc_spool::size() const
+{
+    return m_file_size + m_memory.size();
+}
+
+size_t toc_spool::memory_usage() const
+{
+    return m_memory.capacity();
+}
+
+void toc_spool::rewind()
+{
+    m_read_pos = 0;
+    if (m_file != nullptr)
+    {
+        if ((0 != fflush(m_file)) || (0 != fseek(m_file, 0, SEEK_SET)))
+        {
+            throw std::runtime_error("failed to rewind central directory spool");
+        }
+    }
+}
+
+size_t toc_spool::read(char * buffer, size_t buffer_size)
+{
+    if (m_read_pos < m_file_size)
+    {
+        size_t const count = std::min(buffer_size, m_file_size - m_read_pos);
+        if (count != fread(buffer, 1, count, m_file))
+        {
+            throw std::runtime_error("failed to read central directory spool");
+        }
+
+        m_read_pos += count;
+        return count;
+    }
+
+    size_t const offset = m_read_pos - m_file_size;
+    size_t const count = std::min(buffer_size, m_memory.size() - offset);
+    memcpy(buffer, &m_memory.data()[offset], count);
+    m_read_pos += count;
+
+    return count;
+}
+
+void toc_spool::flush()
+{
+    if (m_memory.empty())
+    {
+        return;
+    }
+
+    if (m_file == nullptr)
+    {
+        m_file = tmpfile();
+        if (m_file == nullptr)
+        {
+            throw std::runtime_error("failed to create central directory spool");
+        }
+    }
+
+    if (m_memory.size() != fwrite(m_memory.data(), 1, m_memory.size(), m_file))
+    {
+        throw std::runtime_error("failed to write central directory spool");
+    }
+
+    m_file_size += m_memory.size();
+    m_memory.clear();
+}
+
+}
@@ -0,0 +1,43 @@
+#ifndef ZIPSTREAM_TOC_SPOOL_HPP
+#define ZIPSTREAM_TOC_SPOOL_HPP
+
+#include "zipstream/buffer.hpp"
+
+#include <cstdio>
+#include <cstddef>
+#include <vector>
+
+namespace zipstream
+{
+
+// Collects central directory records of completed entries.
+// Records are kept in memory up to memory_limit bytes and spilled
+// to an anonymous temporary file beyond that.
+class toc_spool
+{
+    toc_spool(toc_spool const &) = delete;
+    toc_spool& operator=(toc_spool const &) = delete;
+public:
+    explicit toc_spool(size_t memory_limit);
+    ~toc_spool();
+
+    void append(buffer & source);
+    size_t size() const;
+    size_t memory_usage() const;
+
+    void rewind();
+    size_t read(char * buffer, size_t buffer_size);
+
+private:
+    void flush();
+
+    std::vector<char> m_memory;
+    size_t const m_memory_limit;
+    FILE * m_file;
+    size_t m_file_size;
+    size_t m_read_pos;
+};
+
+}
+
+#endif
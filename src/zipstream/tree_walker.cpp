@@ -0,0 +1,307 @@
+#include "zipstream/tree_walker.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace zipstream
+{
+
+namespace
+{
+
+constexpr size_t const max_worker_count = 8;
+constexpr size_t const dirent_buffer_size = 32 * 1024;
+
+struct linux_dirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+struct node;
+
+struct child
+{
+    std::string name;
+    bool is_directory;
+    bool included;      // matches an include pattern, or there are none
+    uint64_t size;
+    std::unique_ptr<node> dir;
+};
+
+struct node
+{
+    std::string name;   // relative path of the directory, empty or ending with '/'
+    std::vector<child> children;
+};
+
+bool matches_any(std::vector<std::string> const & patterns, std::string const & name)
+{
+    for(auto const & pattern: patterns)
+    {
+        if (0 == fnmatch(pattern.c_str(), name.c_str(), 0))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+class directory
+{
+    directory(directory const &) = delete;
+    directory& operator=(directory const &) = delete;
+public:
+    explicit directory(std::string const & path)
+    : fd(openat(AT_FDCWD, path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC))
+    {
+        if (fd < 0)
+        {
+            throw std::runtime_error("failed to open directory: " + path);
+        }
+    }
+
+    ~directory()
+    {
+        close(fd);
+    }
+
+    int const fd;
+};
+
+class walk_context
+{
+public:
+    walk_context(std::string const & root, tree_filter const & filter)
+    : root_dir((!root.empty() && root.back() == '/') ? root : root + '/')
+    , filter(filter)
+    {
+    }
+
+    // directories are scanned level by level; the workers of a level
+    // pick directories using a shared index
+    void run(node & root, size_t worker_count)
+    {
+        std::vector<node*> level = {&root};
+        while (!level.empty())
+        {
+            std::atomic<size_t> next(0);
+            auto const work = [this, &level, &next]() {
+                for(size_t i = next++; (i < level.size()) && (!failed); i = next++)
+                {
+                    try
+                    {
+                        scan(*level[i]);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (!error)
+                        {
+                            error = std::current_exception();
+                        }
+                        failed = true;
+                    }
+                }
+            };
+
+            std::vector<std::thread> workers;
+            for(size_t i = 1; i < std::min(worker_count, level.size()); i++)
+            {
+                workers.emplace_back(work);
+            }
+            work();
+            for(auto & worker: workers)
+            {
+                worker.join();
+            }
+
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+
+            std::vector<node*> next_level;
+            for(auto * dir: level)
+            {
+                for(auto & item: dir->children)
+                {
+                    if (item.is_directory)
+                    {
+                        next_level.push_back(item.dir.get());
+                    }
+                }
+            }
+            level.swap(next_level);
+        }
+    }
+
+    std::string const root_dir;
+
+private:
+    void scan(node & current)
+    {
+        directory dir(root_dir + current.name);
+
+        // read all directory entries first, then stat them one by one
+        // relative to the directory descriptor; d_type saves the stat of
+        // directories and of regular files that are not included
+        std::vector<std::pair<std::string, unsigned char>> names;
+        char buffer[dirent_buffer_size];
+        while (true)
+        {
+            long const count = syscall(SYS_getdents64, dir.fd, buffer, dirent_buffer_size);
+            if (count < 0)
+            {
+                throw std::runtime_error("failed to read directory: " + root_dir + current.name);
+            }
+            if (count == 0)
+            {
+                break;
+            }
+
+            for(long pos = 0; pos < count;)
+            {
+                auto const * dirent = reinterpret_cast<linux_dirent64 const *>(&buffer[pos]);
+                pos += dirent->d_reclen;
+
+                if ((0 == strcmp(dirent->d_name, ".")) || (0 == strcmp(dirent->d_name, "..")))
+                {
+                    continue;
+                }
+
+                names.emplace_back(dirent->d_name, dirent->d_type);
+            }
+        }
+
+        for(auto & [name, type]: names)
+        {
+            std::string const relative_name = current.name + name;
+            if (matches_any(filter.exclude, relative_name))
+            {
+                continue;
+            }
+
+            if (type == DT_DIR)
+            {
+                add_directory(current, name);
+                continue;
+            }
+
+            bool const included = filter.include.empty() || matches_any(filter.include, relative_name);
+            if ((type == DT_REG) && (!included))
+            {
+                continue;
+            }
+
+            struct statx info;
+            int const rc = statx(dir.fd, name.c_str(), AT_STATX_DONT_SYNC, STATX_TYPE | STATX_SIZE, &info);
+            if (rc != 0)
+            {
+                // file vanished or dangling symlink
+                continue;
+            }
+
+            if (S_ISDIR(info.stx_mode))
+            {
+                // do not follow symlinks to directories to avoid cycles
+                if (type != DT_LNK)
+                {
+                    add_directory(current, name);
+                }
+            }
+            else if ((S_ISREG(info.stx_mode)) && (included))
+            {
+                current.children.push_back({std::move(name), false, true, info.stx_size, nullptr});
+            }
+        }
+    }
+
+    void add_directory(node & current, std::string & name)
+    {
+        auto dir = std::make_unique<node>();
+        dir->name = current.name + name + '/';
+        bool const included = filter.include.empty() || matches_any(filter.include, current.name + name);
+        current.children.push_back({std::move(name), true, included, 0, std::move(dir)});
+    }
+
+    tree_filter const & filter;
+    std::mutex mutex;
+    std::atomic<bool> failed = false;
+    std::exception_ptr error;
+};
+
+// returns false if nothing was added below current
+bool collect(std::string const & root_dir, node & current, std::vector<tree_item> & items)
+{
+    std::sort(current.children.begin(), current.children.end(), [](child const & lhs, child const & rhs) {
+        return lhs.name < rhs.name;
+    });
+
+    bool added = false;
+    for(auto & item: current.children)
+    {
+        if (item.is_directory)
+        {
+            items.push_back({item.dir->name, root_dir + item.dir->name, true, 0});
+            if ((!collect(root_dir, *item.dir, items)) && (!item.included))
+            {
+                items.pop_back();
+            }
+            else
+            {
+                added = true;
+            }
+            item.dir.reset();
+        }
+        else
+        {
+            std::string name = current.name + item.name;
+            items.push_back({name, root_dir + name, false, item.size});
+            added = true;
+        }
+    }
+
+    return added;
+}
+
+}
+
+tree_walker::tree_walker(std::string const & root, tree_filter const & filter, size_t worker_count)
+: m_root(root)
+, m_filter(filter)
+, m_worker_count((worker_count > 0) ? worker_count
+    : std::clamp<size_t>(std::thread::hardware_concurrency(), 1, max_worker_count))
+{
+
+}
+
+std::vector<tree_item> tree_walker::walk()
+{
+    walk_context context(m_root, m_filter);
+    node root;
+    context.run(root, m_worker_count);
+
+    std::vector<tree_item> items;
+    collect(context.root_dir, root, items);
+    return items;
+}
+
+}
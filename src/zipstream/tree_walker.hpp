@@ -0,0 +1,43 @@
+#ifndef ZIPSTREAM_TREE_WALKER_HPP
+#define ZIPSTREAM_TREE_WALKER_HPP
+
+#include "zipstream/tree_filter.hpp"
+
+#include <string>
+#include <vector>
+#include <cinttypes>
+#include <cstddef>
+
+namespace zipstream
+{
+
+struct tree_item
+{
+    std::string name;       // path relative to root, directories end with '/'
+    std::string path;       // path on the filesystem
+    bool is_directory;
+    uint64_t size;
+};
+
+// Walks a directory tree using a small pool of worker threads.
+// Directories are read using getdents64 and stat'ed relative to
+// their directory descriptor; the result is ordered depth first
+// with siblings sorted by name, independent of the worker count.
+class tree_walker
+{
+    tree_walker(tree_walker const &) = delete;
+    tree_walker& operator=(tree_walker const &) = delete;
+public:
+    tree_walker(std::string const & root, tree_filter const & filter, size_t worker_count = 0);
+    ~tree_walker() = default;
+    std::vector<tree_item> walk();
+
+private:
+    std::string const m_root;
+    tree_filter const m_filter;
+    size_t const m_worker_count;
+};
+
+}
+
+#endif
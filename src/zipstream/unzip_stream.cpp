@@ -0,0 +1,578 @@
+#include "zipstream/unzip_stream.hpp"
+#include "zipstream/crc32sum.hpp"
+#include "zipstream/compressor.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace zipstream
+{
+
+namespace
+{
+
+constexpr uint32_t const local_header_signature = 0x04034b50;
+constexpr uint32_t const central_header_signature = 0x02014b50;
+constexpr uint32_t const toc_end_signature = 0x06054b50;
+constexpr uint32_t const data_descriptor_signature = 0x08074b50;
+
+constexpr size_t const local_file_header_size = 30;
+constexpr size_t const lfh_flags_offset = 6;
+constexpr size_t const lfh_compression_method_offset = 8;
+constexpr size_t const lfh_checksum_offset = 14;
+constexpr size_t const lfh_compressed_size_offset = 18;
+constexpr size_t const lfh_uncompressed_size_offset = 22;
+constexpr size_t const lfh_filename_length_offset = 26;
+constexpr size_t const lfh_extra_length_offset = 28;
+
+constexpr uint16_t const flag_data_descriptor = 0x08;
+constexpr uint16_t const method_store = 0;
+constexpr uint16_t const method_deflate = 8;
+constexpr uint16_t const method_zstd = 93;
+constexpr uint16_t const zip64_extra_id = 0x0001;
+constexpr uint32_t const zip64_marker = 0xffffffff;
+
+// used to skip the rest of an entry
+constexpr size_t const skip_buffer_size = 4 * 1024;
+
+uint16_t get_u16(char const * data)
+{
+    uint8_t const * const bytes = reinterpret_cast<uint8_t const *>(data);
+    return bytes[0] | (bytes[1] << 8);
+}
+
+uint32_t get_u32(char const * data)
+{
+    return get_u16(data) | (static_cast<uint32_t>(get_u16(&data[2])) << 16);
+}
+
+uint64_t get_u64(char const * data)
+{
+    return get_u32(data) | (static_cast<uint64_t>(get_u32(&data[4])) << 32);
+}
+
+enum class unzip_state
+{
+    header,
+    data,
+    descriptor,
+    end
+};
+
+}
+
+class unzip_stream::detail
+{
+    detail(detail const &) = delete;
+    detail& operator=(detail const &) = delete;
+public:
+    explicit detail(size_t buffer_size)
+    : input(std::max<size_t>(buffer_size, local_file_header_size))
+    , begin(0)
+    , end(0)
+    , finished(false)
+    , need_input(false)
+    , state(unzip_state::header)
+    , zip64(false)
+    , size_known(false)
+    , compressed_count(0)
+    , count(0)
+    , decompressor_method(method_store)
+    , decompress_done(false)
+    {
+    }
+
+    size_t available() const
+    {
+        return end - begin;
+    }
+
+    char const * data() const
+    {
+        return &input[begin];
+    }
+
+    size_t feed(char const * source, size_t size)
+    {
+        if (state == unzip_state::end)
+        {
+            // the central directory is not needed
+            return size;
+        }
+
+        if ((begin > 0) && ((input.size() - end) < size))
+        {
+            memmove(input.data(), data(), available());
+            end -= begin;
+            begin = 0;
+        }
+
+        size_t const accepted = std::min(size, input.size() - end);
+        memcpy(&input[end], source, accepted);
+        end += accepted;
+        need_input = false;
+
+        return accepted;
+    }
+
+    // checks that size bytes are buffered; otherwise more input is needed
+    bool require(size_t size)
+    {
+        if (available() >= size)
+        {
+            return true;
+        }
+
+        if (finished)
+        {
+            throw std::runtime_error("truncated archive");
+        }
+
+        if (size > input.size())
+        {
+            // a single local header may exceed the buffer size
+            memmove(input.data(), data(), available());
+            end -= begin;
+            begin = 0;
+            input.resize(size);
+        }
+
+        need_input = true;
+        return false;
+    }
+
+    bool read_header()
+    {
+        if (!require(4))
+        {
+            return false;
+        }
+
+        uint32_t const signature = get_u32(data());
+        if ((signature == central_header_signature) || (signature == toc_end_signature))
+        {
+            state = unzip_state::end;
+            begin = end;
+            return false;
+        }
+
+        if (signature != local_header_signature)
+        {
+            throw std::runtime_error("invalid local file header signature");
+        }
+
+        if (!require(local_file_header_size))
+        {
+            return false;
+        }
+
+        size_t const name_length = get_u16(&data()[lfh_filename_length_offset]);
+        size_t const extra_length = get_u16(&data()[lfh_extra_length_offset]);
+        size_t const header_size = local_file_header_size + name_length + extra_length;
+        if (!require(header_size))
+        {
+            return false;
+        }
+
+        char const * const header = data();
+        entry.flags = get_u16(&header[lfh_flags_offset]);
+        entry.compression_method = get_u16(&header[lfh_compression_method_offset]);
+        entry.crc32 = get_u32(&header[lfh_checksum_offset]);
+        entry.compressed_size = get_u32(&header[lfh_compressed_size_offset]);
+        entry.size = get_u32(&header[lfh_uncompressed_size_offset]);
+        entry.name.assign(&header[local_file_header_size], name_length);
+        read_zip64_extra(&header[local_file_header_size + name_length], extra_length);
+
+        if ((entry.compression_method != method_store) && (entry.compression_method != method_deflate)
+            && (entry.compression_method != method_zstd))
+        {
+            throw std::runtime_error("unsupported compression method");
+        }
+
+        bool const descriptor = ((entry.flags & flag_data_descriptor) != 0);
+        size_known = (!descriptor) || (entry.compressed_size > 0);
+        compressed_count = 0;
+        count = 0;
+        checksum = crc32sum();
+        decompress_done = false;
+        if (entry.compression_method != method_store)
+        {
+            reset_decompressor();
+        }
+
+        begin += header_size;
+        state = unzip_state::data;
+        return true;
+    }
+
+    void read_zip64_extra(char const * extra, size_t length)
+    {
+        zip64 = false;
+        size_t pos = 0;
+        while ((pos + 4) <= length)
+        {
+            uint16_t const id = get_u16(&extra[pos]);
+            size_t const size = get_u16(&extra[pos + 2]);
+            size_t field = pos + 4;
+            pos = field + size;
+            if ((id != zip64_extra_id) || (pos > length))
+            {
+                continue;
+            }
+
+            zip64 = true;
+            if ((entry.size == zip64_marker) && ((field + 8) <= pos))
+            {
+                entry.size = get_u64(&extra[field]);
+                field += 8;
+            }
+            if ((entry.compressed_size == zip64_marker) && ((field + 8) <= pos))
+            {
+                entry.compressed_size = get_u64(&extra[field]);
+            }
+            return;
+        }
+    }
+
+    // decompressors are reused by consecutive entries of the same method
+    void reset_decompressor()
+    {
+        if ((decompressor) && (decompressor_method == entry.compression_method))
+        {
+            decompressor->reset();
+            return;
+        }
+
+        decompressor = make_decompressor(entry.compression_method);
+        if (!decompressor)
+        {
+            throw std::runtime_error("compression method not available");
+        }
+        decompressor_method = entry.compression_method;
+    }
+
+    size_t read(char * buffer, size_t buffer_size)
+    {
+        need_input = false;
+        while ((state == unzip_state::data) || (state == unzip_state::descriptor))
+        {
+            if (state == unzip_state::data)
+            {
+                size_t const produced = read_data(buffer, buffer_size);
+                if ((produced > 0) || (need_input))
+                {
+                    return produced;
+                }
+            }
+            else if (!read_descriptor())
+            {
+                return 0;
+            }
+        }
+
+        return 0;
+    }
+
+    size_t read_data(char * buffer, size_t buffer_size)
+    {
+        if (buffer_size == 0)
+        {
+            return 0;
+        }
+
+        size_t produced;
+        if (entry.compression_method != method_store)
+        {
+            produced = read_compressed(buffer, buffer_size);
+        }
+        else if (size_known)
+        {
+            produced = read_stored(buffer, buffer_size);
+        }
+        else
+        {
+            produced = scan_stored(buffer, buffer_size);
+        }
+
+        checksum.update(buffer, produced);
+        count += produced;
+        return produced;
+    }
+
+    size_t read_stored(char * buffer, size_t buffer_size)
+    {
+        uint64_t const remaining = entry.compressed_size - compressed_count;
+        if (remaining == 0)
+        {
+            complete_data();
+            return 0;
+        }
+
+        if (!require(1))
+        {
+            return 0;
+        }
+
+        size_t const size = std::min<uint64_t>({remaining, available(), buffer_size});
+        copy_input(buffer, size);
+        return size;
+    }
+
+    // stored data of unknown size ends at a data descriptor matching CRC and size
+    size_t scan_stored(char * buffer, size_t buffer_size)
+    {
+        size_t const descriptor_size = (zip64) ? 24 : 16;
+        char const * const start = data();
+        size_t const size = available();
+
+        size_t candidate = 0;
+        while (((candidate + 4) <= size) && (get_u32(&start[candidate]) != data_descriptor_signature))
+        {
+            void const * const next = memchr(&start[candidate + 1], 'P', size - candidate - 1);
+            candidate = (next != nullptr) ? static_cast<char const *>(next) - start : size;
+        }
+
+        if ((candidate + 4) > size)
+        {
+            // the last bytes may be the start of a descriptor
+            size_t const safe = (size > 3) ? size - 3 : 0;
+            if (safe == 0)
+            {
+                require(size + 1);
+                return 0;
+            }
+
+            size_t const chunk = std::min(safe, buffer_size);
+            copy_input(buffer, chunk);
+            return chunk;
+        }
+
+        if (candidate > 0)
+        {
+            size_t const chunk = std::min(candidate, buffer_size);
+            copy_input(buffer, chunk);
+            return chunk;
+        }
+
+        if (!require(descriptor_size))
+        {
+            return 0;
+        }
+
+        if (matches_descriptor(data(), descriptor_size))
+        {
+            complete_data();
+            return 0;
+        }
+
+        copy_input(buffer, 1);
+        return 1;
+    }
+
+    size_t read_compressed(char * buffer, size_t buffer_size)
+    {
+        if (decompress_done)
+        {
+            complete_data();
+            return 0;
+        }
+
+        size_t input_size = available();
+        if (size_known && ((entry.compressed_size - compressed_count) < input_size))
+        {
+            input_size = entry.compressed_size - compressed_count;
+        }
+
+        char const * input = data();
+        size_t const pending = input_size;
+        char * output = buffer;
+        size_t output_size = buffer_size;
+        decompress_done = decompressor->decompress(input, input_size, output, output_size);
+        size_t const consumed = pending - input_size;
+        size_t const produced = buffer_size - output_size;
+        begin += consumed;
+        compressed_count += consumed;
+
+        if ((!decompress_done) && (consumed == 0) && (produced == 0))
+        {
+            require(available() + 1);
+        }
+
+        return produced;
+    }
+
+    void copy_input(char * buffer, size_t size)
+    {
+        memcpy(buffer, data(), size);
+        begin += size;
+        compressed_count += size;
+    }
+
+    bool matches_descriptor(char const * descriptor, size_t size) const
+    {
+        if (get_u32(&descriptor[4]) != checksum.get_value())
+        {
+            return false;
+        }
+
+        if (size == 24)
+        {
+            return (get_u64(&descriptor[8]) == compressed_count) && (get_u64(&descriptor[16]) == count);
+        }
+
+        return (get_u32(&descriptor[8]) == compressed_count) && (get_u32(&descriptor[12]) == count);
+    }
+
+    void complete_data()
+    {
+        if ((entry.flags & flag_data_descriptor) != 0)
+        {
+            state = unzip_state::descriptor;
+            return;
+        }
+
+        validate(entry.crc32, entry.compressed_size, entry.size);
+        state = unzip_state::header;
+    }
+
+    // the descriptor signature is optional
+    bool read_descriptor()
+    {
+        if (!require(4))
+        {
+            return false;
+        }
+
+        size_t const signature_size = (get_u32(data()) == data_descriptor_signature) ? 4 : 0;
+        size_t const size = signature_size + ((zip64) ? 20 : 12);
+        if (!require(size))
+        {
+            return false;
+        }
+
+        char const * const descriptor = &data()[signature_size];
+        uint32_t const crc32 = get_u32(descriptor);
+        uint64_t const compressed_size = (zip64) ? get_u64(&descriptor[4]) : get_u32(&descriptor[4]);
+        uint64_t const size_value = (zip64) ? get_u64(&descriptor[12]) : get_u32(&descriptor[8]);
+        validate(crc32, compressed_size, size_value);
+
+        begin += size;
+        state = unzip_state::header;
+        return true;
+    }
+
+    void validate(uint32_t crc32, uint64_t compressed_size, uint64_t size) const
+    {
+        if (checksum.get_value() != crc32)
+        {
+            throw std::runtime_error("crc32 mismatch");
+        }
+
+        if ((compressed_count != compressed_size) || (count != size))
+        {
+            throw std::runtime_error("size mismatch");
+        }
+    }
+
+    std::vector<char> input;
+    size_t begin;
+    size_t end;
+    bool finished;
+    bool need_input;
+    unzip_state state;
+
+    unzip_entry entry;
+    bool zip64;
+    bool size_known;
+    uint64_t compressed_count;
+    uint64_t count;
+    crc32sum checksum;
+
+    std::unique_ptr<decompressor_i> decompressor;
+    uint16_t decompressor_method;
+    bool decompress_done;
+};
+
+unzip_stream::unzip_stream(size_t buffer_size)
+: d(new detail(buffer_size))
+{
+}
+
+unzip_stream::~unzip_stream()
+{
+    delete d;
+}
+
+unzip_stream::unzip_stream(unzip_stream && other)
+: d(other.d)
+{
+    other.d = nullptr;
+}
+
+unzip_stream& unzip_stream::operator=(unzip_stream && other)
+{
+    if (this != &other)
+    {
+        delete d;
+        this->d = other.d;
+        other.d = nullptr;
+    }
+
+    return *this;
+}
+
+size_t unzip_stream::feed(char const * data, size_t size)
+{
+    return d->feed(data, size);
+}
+
+void unzip_stream::finish()
+{
+    d->finished = true;
+    d->need_input = false;
+}
+
+bool unzip_stream::next_entry(unzip_entry & entry)
+{
+    if ((d->state == unzip_state::data) || (d->state == unzip_state::descriptor))
+    {
+        char buffer[skip_buffer_size];
+        while (d->read(buffer, skip_buffer_size) > 0)
+        {
+        }
+
+        if (d->need_input)
+        {
+            return false;
+        }
+    }
+
+    d->need_input = false;
+    if ((d->state == unzip_state::end) || (!d->read_header()))
+    {
+        return false;
+    }
+
+    entry = d->entry;
+    return true;
+}
+
+size_t unzip_stream::read(char * buffer, size_t buffer_size)
+{
+    return d->read(buffer, buffer_size);
+}
+
+bool unzip_stream::need_input() const
+{
+    return d->need_input;
+}
+
+bool unzip_stream::done() const
+{
+    return (d->state == unzip_state::end);
+}
+
+}
@@ -0,0 +1,160 @@
+#include <zipstream/zipstream.hpp>
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+void add_entries(zipstream::builder & builder)
+{
+    builder.add_directory("a/");
+    for(size_t i = 0; i < 10; i++)
+    {
+        builder.add_file_with_content("a/" + std::string(i + 1, 'x'), std::string(i * 1000 + 1, 'a' + i));
+    }
+}
+
+uint32_t get_u16(std::string const & data, size_t pos)
+{
+    return static_cast<uint8_t>(data[pos]) | (static_cast<uint8_t>(data[pos + 1]) << 8);
+}
+
+uint32_t get_u32(std::string const & data, size_t pos)
+{
+    return get_u16(data, pos) | (get_u16(data, pos + 2) << 16);
+}
+
+// checks that the data of each file referenced by the central directory is aligned
+void check_alignment(std::string const & archive, size_t alignment)
+{
+    size_t const eocd = archive.size() - 22;
+    ASSERT_EQ(0x06054b50u, get_u32(archive, eocd));
+    size_t const count = get_u16(archive, eocd + 10);
+    size_t pos = get_u32(archive, eocd + 16);
+
+    for(size_t i = 0; i < count; i++)
+    {
+        ASSERT_EQ(0x02014b50u, get_u32(archive, pos));
+        size_t const name_length = get_u16(archive, pos + 28);
+        size_t const offset = get_u32(archive, pos + 42);
+        std::string const name = archive.substr(pos + 46, name_length);
+        pos += 46 + name_length + get_u16(archive, pos + 30) + get_u16(archive, pos + 32);
+
+        ASSERT_EQ(0x04034b50u, get_u32(archive, offset));
+        ASSERT_EQ(name, archive.substr(offset + 30, name_length));
+        size_t const extra_length = get_u16(archive, offset + 28);
+        size_t const data_start = offset + 30 + name_length + extra_length;
+        if (extra_length > 0)
+        {
+            // padding is always a single valid extra field
+            ASSERT_EQ(0xd935u, get_u16(archive, data_start - extra_length)) << name;
+            ASSERT_EQ(extra_length - 4, get_u16(archive, data_start - extra_length + 2)) << name;
+        }
+
+        if (get_u16(archive, offset + 8) != 0)
+        {
+            ASSERT_EQ(0u, extra_length) << name;
+        }
+        else if (name.back() != '/')
+        {
+            ASSERT_EQ(0u, data_start % alignment) << name;
+        }
+    }
+}
+
+}
+
+TEST(alignment, aligns_stored_data)
+{
+    for(size_t alignment: {4, 4096, 65536})
+    {
+        zipstream::builder builder;
+        add_entries(builder);
+        builder.set_alignment(alignment);
+        check_alignment(read_all(*builder.build(), 1000), alignment);
+    }
+}
+
+TEST(alignment, pads_short_gaps_at_64k)
+{
+    // the data of "b" starts 1 to 5 bytes before a 64 KiB boundary, which is
+    // too little for the extra field and 64 KiB more does not fit
+    for(size_t gap = 1; gap <= 5; gap++)
+    {
+        zipstream::builder builder;
+        builder.add_file_with_content("a", std::string(65536 - 31 - gap, 'a'));
+        builder.add_file_with_content("b", "contents of b");
+        builder.set_alignment(65536);
+        auto const archive = read_all(*builder.build(), 1000);
+        check_alignment(archive, 32 * 1024);
+
+        size_t const offset = 65536 + 65536 - 31 - gap;
+        ASSERT_EQ(0x04034b50u, get_u32(archive, offset));
+        ASSERT_EQ(32 * 1024 + gap, get_u16(archive, offset + 28));
+        ASSERT_EQ(32 * 1024u, get_u16(archive, offset + 31 + 4));
+
+        std::string const path = temp_path("gap.zip");
+        std::ofstream(path, std::ios_base::binary) << archive;
+        {
+            zipstream::reader reader(path);
+            ASSERT_EQ("contents of b", reader.data(1));
+        }
+        std::remove(path.c_str());
+    }
+}
+
+TEST(alignment, skips_compressed_entries)
+{
+    zipstream::builder builder;
+    builder.set_compression(zipstream::compression::zlib);
+    add_entries(builder);
+    builder.set_alignment(4096);
+    check_alignment(read_all(*builder.build(), 1000), 4096);
+}
+
+TEST(alignment, ranges_match_stream)
+{
+    zipstream::builder builder;
+    add_entries(builder);
+    builder.set_alignment(4096);
+    auto const expected = read_all(*builder.build(), 1000);
+
+    zipstream::builder range_builder;
+    add_entries(range_builder);
+    range_builder.set_alignment(4096);
+    auto source = range_builder.build_ranges();
+    ASSERT_EQ(expected.size(), source->size());
+
+    for(size_t begin = 0; begin < expected.size(); begin += 3001)
+    {
+        auto range = source->open_range(begin, expected.size());
+        ASSERT_EQ(expected.substr(begin), read_all(*range, 1000));
+    }
+}
+
+TEST(alignment, no_alignment_by_default)
+{
+    zipstream::builder builder;
+    add_entries(builder);
+    auto const plain = read_all(*builder.build(), 1000);
+
+    zipstream::builder aligned_builder;
+    add_entries(aligned_builder);
+    aligned_builder.set_alignment(1);
+    ASSERT_EQ(plain, read_all(*aligned_builder.build(), 1000));
+}
+
+TEST(alignment, rejects_invalid_alignment)
+{
+    zipstream::builder builder;
+    ASSERT_THROW(builder.set_alignment(3000), std::runtime_error);
+    ASSERT_THROW(builder.set_alignment(128 * 1024), std::runtime_error);
+}
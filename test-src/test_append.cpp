@@ -0,0 +1,143 @@
+#include <zipstream/zipstream.hpp>
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace zipstream_test;
+
+TEST(append, keeps_existing_entries)
+{
+    std::string const path = temp_path("archive.zip");
+    zipstream::builder builder;
+    builder.add_directory("old/");
+    builder.add_file_with_content("old/a.txt", "contents of a");
+    builder.build()->write_to_file(path);
+    std::string const original = read_file(path);
+
+    std::string toc_start;
+    {
+        zipstream::reader reader(path);
+        toc_start = std::to_string(reader.toc_offset());
+    }
+
+    zipstream::builder appender;
+    appender.add_file_with_content("new/b.txt", "contents of b");
+    appender.add_file_with_content("new/c.txt", std::string(1000, 'c'));
+    appender.append_to_file(path);
+
+    zipstream::builder expected_builder;
+    expected_builder.add_directory("old/");
+    expected_builder.add_file_with_content("old/a.txt", "contents of a");
+    expected_builder.add_file_with_content("new/b.txt", "contents of b");
+    expected_builder.add_file_with_content("new/c.txt", std::string(1000, 'c'));
+    std::string const expected_path = temp_path("expected.zip");
+    expected_builder.build()->write_to_file(expected_path);
+
+    auto const appended = read_file(path);
+    ASSERT_EQ(read_file(expected_path), appended);
+    ASSERT_EQ(original.substr(0, std::stoul(toc_start)), appended.substr(0, std::stoul(toc_start)));
+
+    std::remove(expected_path.c_str());
+    std::remove(path.c_str());
+}
+
+TEST(append, appends_repeatedly)
+{
+    std::string const path = temp_path("rolling.zip");
+    zipstream::builder builder;
+    builder.add_file_with_content("0.txt", "0");
+    builder.build()->write_to_file(path);
+
+    for(size_t i = 1; i < 5; i++)
+    {
+        zipstream::builder appender;
+        appender.add_file_with_content(std::to_string(i) + ".txt", std::to_string(i));
+        appender.append_to_file(path);
+    }
+
+    {
+        zipstream::reader reader(path);
+        ASSERT_EQ(5u, reader.count());
+        for(size_t i = 0; i < 5; i++)
+        {
+            ASSERT_EQ(std::to_string(i) + ".txt", reader.name(i));
+            ASSERT_EQ(std::to_string(i), reader.data(i));
+        }
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST(append, rejects_invalid_archive)
+{
+    std::string const path = temp_path("invalid.zip");
+    std::ofstream(path) << "not an archive";
+
+    zipstream::builder appender;
+    appender.add_file_with_content("a.txt", "a");
+    ASSERT_THROW(appender.append_to_file(path), std::runtime_error);
+    ASSERT_EQ("not an archive", read_file(path));
+
+    std::remove(path.c_str());
+}
+
+TEST(append, failure_keeps_archive_intact)
+{
+    std::string const path = temp_path("intact.zip");
+    zipstream::builder builder;
+    builder.add_file_with_content("a.txt", "contents of a");
+    builder.build()->write_to_file(path);
+    std::string const original = read_file(path);
+
+    zipstream::builder appender;
+    appender.add_file_with_content("b.txt", std::string(100000, 'b'));
+    appender.add_file_from_path("missing.txt", temp_path("missing.txt"));
+    ASSERT_THROW(appender.append_to_file(path), std::exception);
+
+    ASSERT_EQ(original, read_file(path));
+    {
+        zipstream::reader reader(path);
+        ASSERT_EQ(1u, reader.count());
+        ASSERT_EQ("contents of a", reader.data(0));
+    }
+
+    // no staged tail is left behind
+    for(auto const & item: std::filesystem::directory_iterator("."))
+    {
+        ASSERT_NE(0u, item.path().filename().string().rfind(path + ".", 0));
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST(append, keeps_file_mode)
+{
+    std::string const path = temp_path("mode.zip");
+    zipstream::builder builder;
+    builder.add_file_with_content("a.txt", "a");
+    builder.build()->write_to_file(path);
+    ASSERT_EQ(0, chmod(path.c_str(), 0640));
+
+    zipstream::builder appender;
+    appender.add_file_with_content("b.txt", "b");
+    appender.append_to_file(path);
+
+    struct stat info;
+    ASSERT_EQ(0, stat(path.c_str(), &info));
+    ASSERT_EQ(0640u, info.st_mode & 0777);
+    {
+        zipstream::reader reader(path);
+        ASSERT_EQ(2u, reader.count());
+        ASSERT_EQ("b", reader.data(1));
+    }
+
+    std::remove(path.c_str());
+}
@@ -104,3 +104,35 @@ TEST(buffer, reset_after_exhaustive_read)
     ASSERT_STREQ("56", out);
 }
 
+TEST(buffer, skip)
+{
+    zipstream::buffer buf(8);
+    buf.write_u32(0x34333231);
+
+    char out[3] = {0,0,0};
+    buf.skip(2);
+    buf.read(out, 2);
+    ASSERT_STREQ("34", out);
+    ASSERT_TRUE(buf.empty());
+
+    buf.write_u16(0x3231);
+    buf.skip(5);
+    ASSERT_TRUE(buf.empty());
+}
+
+TEST(buffer, reserve)
+{
+    zipstream::buffer buf(4);
+    buf.write_u32(0x34333231);
+    char out[7] = {0,0,0,0,0,0,0};
+    buf.read(out, 1);
+
+    buf.reserve(2);
+    ASSERT_EQ(4, buf.capacity());
+
+    buf.reserve(6);
+    ASSERT_EQ(6, buf.capacity());
+    buf.write_str("56");
+    buf.read(out, 5);
+    ASSERT_STREQ("23456", out);
+}
@@ -0,0 +1,107 @@
+#include "zipstream/buffer_pool.hpp"
+#include <zipstream/zipstream.hpp>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using zipstream::buffer_pool;
+
+TEST(buffer_pool, acquire_and_reuse)
+{
+    buffer_pool pool(1024 * 1024, 256 * 1024);
+    size_t account = 0;
+
+    char * data = nullptr;
+    {
+        auto buffer = pool.acquire(64 * 1024, account);
+        ASSERT_EQ(64 * 1024, buffer.size());
+        ASSERT_EQ(64 * 1024, account);
+        ASSERT_EQ(64 * 1024, pool.usage());
+        data = buffer.data();
+    }
+    ASSERT_EQ(0, account);
+
+    auto buffer = pool.acquire(64 * 1024, account);
+    ASSERT_EQ(data, buffer.data());
+    ASSERT_EQ(64 * 1024, pool.usage());
+}
+
+TEST(buffer_pool, round_down_to_size_class)
+{
+    buffer_pool pool(1024 * 1024, 1024 * 1024);
+    size_t account = 0;
+
+    ASSERT_EQ(64 * 1024, pool.acquire(100 * 1024, account).size());
+    ASSERT_EQ(buffer_pool::max_buffer_size, pool.acquire(10 * 1024 * 1024, account).size());
+    ASSERT_EQ(buffer_pool::min_buffer_size, pool.acquire(1, account).size());
+}
+
+TEST(buffer_pool, page_aligned)
+{
+    buffer_pool pool(1024 * 1024, 1024 * 1024);
+    size_t account = 0;
+
+    for(size_t size: {size_t(1), size_t(4096), size_t(100 * 1024)})
+    {
+        auto buffer = pool.acquire(size, account);
+        ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(buffer.data()) % buffer_pool::buffer_alignment);
+        ASSERT_EQ(0u, buffer.size() % buffer_pool::buffer_alignment);
+    }
+}
+
+TEST(buffer_pool, respect_stream_limit)
+{
+    buffer_pool pool(1024 * 1024, 96 * 1024);
+    size_t account = 0;
+
+    auto first = pool.acquire(64 * 1024, account);
+    auto second = pool.acquire(64 * 1024, account);
+    ASSERT_EQ(64 * 1024, first.size());
+    ASSERT_EQ(32 * 1024, second.size());
+
+    // always grant the minimum
+    auto third = pool.acquire(64 * 1024, account);
+    ASSERT_EQ(buffer_pool::min_buffer_size, third.size());
+}
+
+TEST(buffer_pool, respect_global_limit)
+{
+    buffer_pool pool(64 * 1024, 64 * 1024);
+    size_t first_account = 0;
+    size_t second_account = 0;
+
+    auto first = pool.acquire(32 * 1024, first_account);
+    auto second = pool.acquire(64 * 1024, second_account);
+    ASSERT_EQ(32 * 1024, second.size());
+    ASSERT_EQ(64 * 1024, pool.usage());
+}
+
+TEST(buffer_pool, limit_idle_buffers)
+{
+    buffer_pool pool(64 * 1024 * 1024, 64 * 1024 * 1024);
+    size_t account = 0;
+    {
+        std::vector<zipstream::pooled_buffer> buffers;
+        for(size_t i = 0; i < 16; i++)
+        {
+            buffers.push_back(pool.acquire(buffer_pool::max_buffer_size, account));
+            buffers.push_back(pool.acquire(buffer_pool::min_buffer_size, account));
+        }
+        ASSERT_EQ(16 * (buffer_pool::max_buffer_size + buffer_pool::min_buffer_size), pool.usage());
+    }
+
+    // all small buffers fit into the idle limit, only 4 large ones do
+    ASSERT_EQ(0, account);
+    ASSERT_EQ(buffer_pool::max_idle_size + (16 * buffer_pool::min_buffer_size), pool.usage());
+}
+
+TEST(buffer_pool, stream_reports_memory_usage)
+{
+    zipstream::builder builder;
+    builder.add_file_with_content(std::string(100, 'x'), "content");
+    auto stream = builder.build();
+
+    // staging buffer is sized to the largest record, not to a fixed size
+    ASSERT_GT(stream->memory_usage(), 146);
+    ASSERT_LT(stream->memory_usage(), 4 * 1024);
+}
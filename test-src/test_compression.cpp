@@ -0,0 +1,345 @@
+#include <zipstream/zipstream.hpp>
+#include "zipstream/compressor.hpp"
+#include "zipstream/crc32sum.hpp"
+#include "zipstream/entry_table.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+constexpr uint16_t const flag_data_descriptor = 0x08;
+
+// compressible, but not trivially
+std::string make_content(size_t size)
+{
+    std::string content;
+    content.reserve(size);
+    uint32_t value = 1;
+    while (content.size() < size)
+    {
+        value = value * 1103515245 + 12345;
+        content += "line " + std::to_string((value >> 16) % 1000) + "\n";
+    }
+    content.resize(size);
+
+    return content;
+}
+
+std::string extract(zipstream::reader const & zip, size_t index)
+{
+    auto const info = zip.entry(index);
+    std::vector<char> data(info.uncompressed_size);
+    if (!zipstream::decompress(info.compression_method, zip.data(index), data.data(), data.size()))
+    {
+        throw std::runtime_error("failed to decompress");
+    }
+
+    zipstream::crc32sum checksum;
+    checksum.update(data.data(), data.size());
+    if (checksum.get_value() != info.crc32)
+    {
+        throw std::runtime_error("crc32 mismatch");
+    }
+
+    return std::string(data.data(), data.size());
+}
+
+// decompresses through small output chunks, as a reader of large entries would
+std::string extract_in_chunks(zipstream::reader const & zip, size_t index)
+{
+    auto const info = zip.entry(index);
+    auto decompressor = zipstream::make_decompressor(info.compression_method);
+    if (!decompressor)
+    {
+        throw std::runtime_error("unsupported method");
+    }
+
+    auto const data = zip.data(index);
+    char const * input = data.data();
+    size_t input_size = data.size();
+    std::string result;
+    bool done = false;
+    while (!done)
+    {
+        char chunk[1000];
+        char * output = chunk;
+        size_t output_size = sizeof(chunk);
+        done = decompressor->decompress(input, input_size, output, output_size);
+        result.append(chunk, sizeof(chunk) - output_size);
+    }
+
+    return result;
+}
+
+uint32_t crc32sum_of(std::string const & data)
+{
+    zipstream::crc32sum checksum;
+    checksum.update(data.data(), data.size());
+    return checksum.get_value();
+}
+
+void check_backend(zipstream::compression backend, uint16_t method)
+{
+    std::string const small = make_content(100 * 1024);
+    std::string const large = make_content(1024 * 1024);
+    std::string const file_path = temp_path("large.txt");
+    std::ofstream(file_path, std::ios_base::binary) << large;
+
+    zipstream::builder builder;
+    builder.add_file_with_content("stored.txt", small);
+    builder.set_compression(backend);
+    builder.add_directory("dir/");
+    builder.add_file_with_content("dir/empty.txt", "");
+    builder.add_file_with_content("dir/small.txt", small);
+    builder.add_file_with_content("dir/large.txt", large);
+    builder.add_file_from_path("dir/file.txt", file_path);
+    std::string const archive_path = temp_path("archive.zip");
+    builder.build()->write_to_file(archive_path);
+
+    {
+        zipstream::reader zip(archive_path);
+        ASSERT_EQ(6u, zip.count());
+        ASSERT_EQ(0, zip.entry(0).compression_method);
+        ASSERT_EQ(0, zip.entry(1).compression_method);
+        for(size_t index = 2; index < zip.count(); index++)
+        {
+            ASSERT_EQ(method, zip.entry(index).compression_method);
+        }
+        ASSERT_EQ(small, extract(zip, 0));
+        ASSERT_EQ("", extract(zip, 2));
+        ASSERT_EQ(small, extract(zip, 3));
+        ASSERT_EQ(large, extract(zip, 4));
+        ASSERT_EQ(large, extract(zip, 5));
+        ASSERT_LT(zip.entry(4).compressed_size, large.size() / 2);
+        for(size_t index = 2; index < zip.count(); index++)
+        {
+            ASSERT_EQ(extract(zip, index), extract_in_chunks(zip, index));
+        }
+
+        // small entries are compressed at once and need no data descriptor
+        ASSERT_EQ(0, zip.local_header(3).flags & flag_data_descriptor);
+        ASSERT_NE(0, zip.local_header(4).flags & flag_data_descriptor);
+    }
+
+    std::remove(archive_path.c_str());
+    std::remove(file_path.c_str());
+}
+
+}
+
+TEST(compression, zlib)
+{
+    check_backend(zipstream::compression::zlib, 8);
+}
+
+TEST(compression, libdeflate)
+{
+    if (!zipstream::compression_available(zipstream::compression::libdeflate))
+    {
+        GTEST_SKIP() << "libdeflate not available";
+    }
+
+    check_backend(zipstream::compression::libdeflate, 8);
+}
+
+TEST(compression, zstd)
+{
+    if (!zipstream::compression_available(zipstream::compression::zstd))
+    {
+        GTEST_SKIP() << "zstd not available";
+    }
+
+    check_backend(zipstream::compression::zstd, 93);
+}
+
+TEST(compression, deflated_entries_can_be_unzipped_while_streaming)
+{
+    std::string const content = make_content(500 * 1024);
+    zipstream::builder builder;
+    builder.set_compression(zipstream::compression::zlib, 9);
+    builder.add_file_with_content("a.txt", content);
+    builder.add_file_with_content("b.txt", "b");
+    auto stream = builder.build();
+
+    std::string archive;
+    char buffer[1000];
+    for(size_t count = stream->read(buffer, 1000); count > 0; count = stream->read(buffer, 1000))
+    {
+        archive.append(buffer, count);
+    }
+
+    zipstream::unzip_stream unzip;
+    size_t fed = 0;
+    auto const feed = [&]() {
+        fed += unzip.feed(&archive[fed], archive.size() - fed);
+        if (fed == archive.size())
+        {
+            unzip.finish();
+        }
+    };
+
+    zipstream::unzip_entry entry;
+    std::vector<std::string> contents;
+    while (!unzip.done())
+    {
+        if (!unzip.next_entry(entry))
+        {
+            feed();
+            continue;
+        }
+
+        std::string data;
+        size_t count = unzip.read(buffer, 1000);
+        while ((count > 0) || (unzip.need_input()))
+        {
+            data.append(buffer, count);
+            if (count == 0)
+            {
+                feed();
+            }
+            count = unzip.read(buffer, 1000);
+        }
+        contents.push_back(data);
+    }
+
+    ASSERT_EQ(2u, contents.size());
+    ASSERT_EQ(content, contents[0]);
+    ASSERT_EQ("b", contents[1]);
+}
+
+TEST(compression, sparse_files)
+{
+    std::string const file_path = temp_path("sparse.bin");
+    std::string const text = make_content(100 * 1024);
+    {
+        std::ofstream file(file_path, std::ios_base::binary);
+        file.seekp(5 * 1024 * 1024 + 17);
+        file << text;
+        file.seekp(12 * 1024 * 1024);
+        file << text;
+    }
+    std::string expected(12 * 1024 * 1024 + text.size(), '\0');
+    expected.replace(5 * 1024 * 1024 + 17, text.size(), text);
+    expected.replace(12 * 1024 * 1024, text.size(), text);
+
+    zipstream::builder builder;
+    builder.add_file_from_path("stored.bin", file_path);
+    builder.set_compression(zipstream::compression::zlib);
+    builder.add_file_from_path("zlib.bin", file_path);
+    if (zipstream::compression_available(zipstream::compression::zstd))
+    {
+        builder.set_compression(zipstream::compression::zstd);
+        builder.add_file_from_path("zstd.bin", file_path);
+    }
+    std::string const archive_path = temp_path("sparse.zip");
+    builder.build()->write_to_file(archive_path);
+
+    {
+        zipstream::reader zip(archive_path);
+        ASSERT_EQ(expected.size(), zip.entry(0).uncompressed_size);
+        ASSERT_EQ(expected, std::string(zip.data(0)));
+        ASSERT_EQ(crc32sum_of(expected), zip.entry(0).crc32);
+        for(size_t index = 1; index < zip.count(); index++)
+        {
+            ASSERT_EQ(expected, extract(zip, index));
+            ASSERT_LT(zip.entry(index).compressed_size, 2 * text.size());
+        }
+    }
+
+    std::remove(archive_path.c_str());
+    std::remove(file_path.c_str());
+}
+
+TEST(compression, rejects_files_beyond_4_gib)
+{
+    // sizes are 32 bit without zip64, so the entry must not be truncated silently
+    std::string const file_path = temp_path("huge.bin");
+    int const fd = open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(0, ftruncate(fd, (off_t(1) << 32) + 1));
+    close(fd);
+
+    zipstream::builder builder;
+    builder.add_file_from_path("huge.bin", file_path);
+    auto stream = builder.build();
+    std::vector<char> buffer(4096);
+    ASSERT_THROW(stream->read(buffer.data(), buffer.size()), std::runtime_error);
+
+    zipstream::entry_table entries;
+    ASSERT_THROW(entries.add_file_from_path("huge.bin", file_path, (uint64_t(1) << 32) + 1), std::runtime_error);
+
+    std::remove(file_path.c_str());
+}
+
+TEST(compression, rejects_invalid_levels_and_ranges)
+{
+    zipstream::builder builder;
+    ASSERT_THROW(builder.set_compression(zipstream::compression::zlib, 10), std::runtime_error);
+    builder.set_compression(zipstream::compression::zlib);
+    builder.add_file_with_content("a.txt", "a");
+    ASSERT_THROW(builder.build_ranges(), std::runtime_error);
+}
+
+TEST(compression, policy_stores_incompressible_entries)
+{
+    std::string random(400 * 1024, '\0');
+    uint32_t value = 1;
+    for(auto & c: random)
+    {
+        value = value * 1103515245 + 12345;
+        c = static_cast<char>(value >> 24);
+    }
+    std::string const jpeg = "\xff\xd8\xff\xe0" + make_content(10000);
+    std::string const text = make_content(400 * 1024);
+
+    zipstream::compression_policy policy;
+    policy.extensions[".log"] = zipstream::compression::store;
+    policy.extensions[".bin"] = zipstream::compression::zlib;
+
+    zipstream::builder builder;
+    builder.set_compression(zipstream::compression::zlib);
+    builder.set_compression_policy(policy);
+    builder.add_file_with_content("small.txt", text.substr(0, 1000));
+    builder.add_file_with_content("small.dat", random.substr(0, 1000));
+    builder.add_file_with_content("image.jpg", jpeg);
+    builder.add_file_with_content("large.txt", text);
+    builder.add_file_with_content("large.dat", random);
+    builder.add_file_with_content("app.LOG", text);
+    builder.add_file_with_content("forced.bin", random);
+    builder.add_file_with_content("empty.txt", "");
+    auto stream = builder.build();
+    std::string const archive_path = temp_path("policy.zip");
+    stream->write_to_file(archive_path);
+
+    auto const statistics = stream->statistics();
+    ASSERT_EQ(8u, statistics.entries);
+    ASSERT_EQ(3u, statistics.compressed_entries);
+    ASSERT_EQ(4u, statistics.incompressible_entries);
+    ASSERT_LT(statistics.compressed_bytes, statistics.uncompressed_bytes);
+
+    {
+        zipstream::reader zip(archive_path);
+        std::vector<uint16_t> const expected = {8, 0, 0, 8, 0, 0, 8, 0};
+        for(size_t index = 0; index < zip.count(); index++)
+        {
+            ASSERT_EQ(expected[index], zip.entry(index).compression_method) << zip.name(index);
+        }
+        ASSERT_EQ(random, extract(zip, 4));
+        ASSERT_EQ(text, extract(zip, 5));
+        ASSERT_EQ(random, extract(zip, 6));
+    }
+
+    std::remove(archive_path.c_str());
+}
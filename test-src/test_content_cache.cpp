@@ -0,0 +1,265 @@
+#include <zipstream/zipstream.hpp>
+#include "zipstream/compressor.hpp"
+#include "zipstream/reader.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+constexpr size_t const data_descriptor_size = 16;
+
+std::string make_content(size_t size, uint32_t seed)
+{
+    std::string content;
+    content.reserve(size);
+    uint32_t value = seed;
+    while (content.size() < size)
+    {
+        value = value * 1103515245 + 12345;
+        content += "line " + std::to_string((value >> 16) % 1000) + "\n";
+    }
+    content.resize(size);
+
+    return content;
+}
+
+std::string extract(zipstream::reader const & zip, size_t index)
+{
+    auto const info = zip.entry(index);
+    std::vector<char> data(info.uncompressed_size);
+    if (!zipstream::decompress(info.compression_method, zip.data(index), data.data(), data.size()))
+    {
+        return "<corrupt>";
+    }
+
+    return std::string(data.data(), data.size());
+}
+
+zipstream::content_key key_of(uint64_t inode)
+{
+    return zipstream::content_key{1, inode, 1000, 0, zipstream::compression::zlib, 6};
+}
+
+class content_cache_test: public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        directory = temp_path("dir");
+        small_path = temp_path("small.txt");
+        large_path = temp_path("large.txt");
+        small = make_content(100 * 1024, 1);
+        large = make_content(1024 * 1024, 2);
+        std::ofstream(small_path, std::ios_base::binary) << small;
+        std::ofstream(large_path, std::ios_base::binary) << large;
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(directory);
+        std::filesystem::remove(small_path);
+        std::filesystem::remove(large_path);
+    }
+
+    zipstream::builder make_builder(std::shared_ptr<zipstream::content_cache> cache)
+    {
+        zipstream::builder builder;
+        builder.set_content_cache(cache);
+        builder.add_file_with_content("stored.txt", "stored");
+        builder.set_compression(zipstream::compression::zlib);
+        builder.add_file_from_path("small.txt", small_path);
+        builder.add_file_from_path("large.txt", large_path);
+        builder.add_file_with_content("content.txt", small);
+        return builder;
+    }
+
+    void check_archive(std::string const & archive)
+    {
+        std::string const path = temp_path("archive.zip");
+        std::ofstream(path, std::ios_base::binary) << archive;
+        {
+            zipstream::reader zip(path);
+            ASSERT_EQ(4u, zip.count());
+            ASSERT_EQ(0, zip.entry(0).compression_method);
+            ASSERT_EQ(8, zip.entry(1).compression_method);
+            ASSERT_EQ(small, extract(zip, 1));
+            ASSERT_EQ(large, extract(zip, 2));
+            ASSERT_EQ(small, extract(zip, 3));
+        }
+        std::filesystem::remove(path);
+    }
+
+    std::string directory;
+    std::string small_path;
+    std::string large_path;
+    std::string small;
+    std::string large;
+};
+
+}
+
+TEST_F(content_cache_test, second_build_uses_cached_payloads)
+{
+    auto cache = std::make_shared<zipstream::content_cache>(directory, 16 * 1024 * 1024);
+
+    std::string const first = read_all(*make_builder(cache).build(), 10000);
+    ASSERT_EQ(0u, cache->hits());
+    ASSERT_EQ(2u, cache->misses());
+    ASSERT_GT(cache->memory_usage(), 0u);
+    ASSERT_GT(cache->disk_usage(), 0u);
+    check_archive(first);
+
+    // sizes of cached payloads are known up front, so no data descriptor is needed
+    std::string const second = read_all(*make_builder(cache).build(), 10000);
+    ASSERT_EQ(2u, cache->hits());
+    ASSERT_EQ(first.size() - data_descriptor_size, second.size());
+    check_archive(second);
+}
+
+TEST_F(content_cache_test, payloads_persist_on_disk)
+{
+    std::string first;
+    {
+        auto cache = std::make_shared<zipstream::content_cache>(directory, 16 * 1024 * 1024);
+        first = read_all(*make_builder(cache).build(), 10000);
+    }
+
+    auto cache = std::make_shared<zipstream::content_cache>(directory, 16 * 1024 * 1024);
+    ASSERT_GT(cache->disk_usage(), 0u);
+    ASSERT_EQ(0u, cache->memory_usage());
+    std::string const second = read_all(*make_builder(cache).build(), 10000);
+    ASSERT_EQ(2u, cache->hits());
+    ASSERT_EQ(first.size() - data_descriptor_size, second.size());
+    check_archive(second);
+}
+
+TEST_F(content_cache_test, modified_files_miss)
+{
+    auto cache = std::make_shared<zipstream::content_cache>(directory, 16 * 1024 * 1024);
+    read_all(*make_builder(cache).build(), 10000);
+
+    small = make_content(50 * 1024, 3);
+    std::ofstream(small_path, std::ios_base::binary | std::ios_base::trunc) << small;
+    std::string const archive = read_all(*make_builder(cache).build(), 10000);
+    ASSERT_EQ(1u, cache->hits());
+    ASSERT_EQ(3u, cache->misses());
+    check_archive(archive);
+}
+
+TEST_F(content_cache_test, evicts_least_recently_used)
+{
+    zipstream::content_cache cache(directory, 5000, 2500);
+    cache.insert(key_of(1), 1, std::string(1000, 'a'));
+    cache.insert(key_of(2), 2, std::string(1000, 'b'));
+    ASSERT_TRUE(cache.find(key_of(1)));
+    cache.insert(key_of(3), 3, std::string(1000, 'c'));
+    ASSERT_EQ(2000u, cache.memory_usage());
+
+    // the second payload is still on disk
+    auto const found = cache.find(key_of(2));
+    ASSERT_TRUE(found);
+    ASSERT_EQ(2u, found->crc32);
+    ASSERT_EQ(std::string(1000, 'b'), *found->data);
+
+    cache.insert(key_of(4), 4, std::string(1000, 'd'));
+    cache.insert(key_of(5), 5, std::string(1000, 'e'));
+    ASSERT_LE(cache.disk_usage(), 5000u);
+    ASSERT_FALSE(cache.find(key_of(1)));
+    ASSERT_TRUE(cache.find(key_of(5)));
+
+    // too large to be cached
+    cache.insert(key_of(6), 6, std::string(3000, 'f'));
+    ASSERT_FALSE(cache.find(key_of(6)));
+}
+
+TEST_F(content_cache_test, concurrent_inserts_and_lookups)
+{
+    // small enough to evict while other threads read and write files
+    zipstream::content_cache cache(directory, 20 * 1024, 8 * 1024);
+    std::vector<std::thread> threads;
+    std::atomic<size_t> corrupt(0);
+    for(uint32_t thread = 0; thread < 4; thread++)
+    {
+        threads.emplace_back([&cache, &corrupt, thread]() {
+            for(uint32_t i = 0; i < 200; i++)
+            {
+                uint64_t const inode = (i + thread) % 16;
+                auto const found = cache.find(key_of(inode));
+                if ((found) && ((found->crc32 != inode) || (*found->data != std::string(1000, 'a' + inode))))
+                {
+                    corrupt++;
+                }
+                cache.insert(key_of(inode), static_cast<uint32_t>(inode), std::string(1000, 'a' + inode));
+            }
+        });
+    }
+    for(auto & thread: threads)
+    {
+        thread.join();
+    }
+
+    ASSERT_EQ(0u, corrupt.load());
+    ASSERT_EQ(800u, cache.hits() + cache.misses());
+    ASSERT_GT(cache.hits(), 0u);
+    ASSERT_LE(cache.memory_usage(), 8u * 1024);
+    ASSERT_LE(cache.disk_usage(), 20u * 1024);
+
+    // every indexed payload is still on disk, no evicted file is left
+    size_t disk_usage = 0;
+    for(auto const & item: std::filesystem::directory_iterator(directory))
+    {
+        ASSERT_EQ(".zsc", item.path().extension().string()) << item.path();
+        disk_usage += item.file_size();
+    }
+    ASSERT_EQ(cache.disk_usage(), disk_usage);
+}
+
+TEST_F(content_cache_test, range_sources_serve_compressed_files)
+{
+    auto cache = std::make_shared<zipstream::content_cache>(directory, 16 * 1024 * 1024);
+    zipstream::builder builder;
+    builder.set_content_cache(cache);
+    builder.add_file_with_content("stored.txt", "stored");
+    builder.set_compression(zipstream::compression::zlib);
+    builder.add_file_from_path("small.txt", small_path);
+    builder.add_file_from_path("large.txt", large_path);
+    builder.add_file_from_path("copy.txt", small_path);
+    auto source = builder.build_ranges();
+
+    std::string const archive = read_all(*source->open_range(0, source->size()), 10000);
+    ASSERT_EQ(source->size(), archive.size());
+    ASSERT_LT(archive.size(), large.size() / 2);
+    for(size_t begin: {size_t(0), size_t(1), size_t(100), archive.size() / 3, archive.size() - 10})
+    {
+        size_t const end = std::min(archive.size(), begin + 70000);
+        ASSERT_EQ(archive.substr(begin, end - begin), read_all(*source->open_range(begin, end), 10000));
+    }
+
+    std::string const path = temp_path("ranges.zip");
+    std::ofstream(path, std::ios_base::binary) << archive;
+    {
+        zipstream::reader zip(path);
+        ASSERT_EQ(4u, zip.count());
+        ASSERT_EQ(small, extract(zip, 1));
+        ASSERT_EQ(large, extract(zip, 2));
+        ASSERT_EQ(small, extract(zip, 3));
+    }
+    std::filesystem::remove(path);
+
+    zipstream::builder uncached;
+    uncached.set_compression(zipstream::compression::zlib);
+    uncached.add_file_from_path("small.txt", small_path);
+    ASSERT_THROW(uncached.build_ranges(), std::runtime_error);
+}
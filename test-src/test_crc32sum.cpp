@@ -1,8 +1,57 @@
 #include "zipstream/crc32sum.hpp"
 #include <gtest/gtest.h>
 
+#include <string>
+
 TEST(crc32sum, from_string)
 {
     ASSERT_EQ(0x00000000, zipstream::crc32sum::from_string(""));
     ASSERT_EQ(0x3224b088, zipstream::crc32sum::from_string("42"));
 }
+
+TEST(crc32sum, check_value)
+{
+    ASSERT_EQ(0xcbf43926, zipstream::crc32sum::from_string("123456789"));
+}
+
+TEST(crc32sum, chunked_updates_match)
+{
+    std::string data;
+    for(size_t i = 0; i < 1000; i++)
+    {
+        data.push_back(static_cast<char>((i * 131) ^ (i >> 3)));
+    }
+
+    // single byte updates never take the word-wise path
+    zipstream::crc32sum bytewise;
+    for(char const c: data)
+    {
+        bytewise.update(&c, 1);
+    }
+
+    for(size_t offset = 0; offset < 16; offset++)
+    {
+        zipstream::crc32sum checksum;
+        checksum.update(data.data(), offset);
+        checksum.update(&data[offset], data.size() - offset);
+        ASSERT_EQ(bytewise.get_value(), checksum.get_value());
+    }
+}
+
+TEST(crc32sum, zero_runs_match_zero_bytes)
+{
+    std::string const zeros(100000, '\0');
+    for(size_t count: {size_t(0), size_t(1), size_t(7), size_t(64), size_t(4096), size_t(65537), zeros.size()})
+    {
+        zipstream::crc32sum expected;
+        expected.update("data", 4);
+        expected.update(zeros.data(), count);
+        expected.update("tail", 4);
+
+        zipstream::crc32sum checksum;
+        checksum.update("data", 4);
+        checksum.update_zeros(count);
+        checksum.update("tail", 4);
+        ASSERT_EQ(expected.get_value(), checksum.get_value());
+    }
+}
@@ -0,0 +1,179 @@
+#include <zipstream/zipstream.hpp>
+#include "zipstream/entry_sorter.hpp"
+#include "zipstream/reader.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+uint64_t inode_of(std::string const & path)
+{
+    struct stat info;
+    stat(path.c_str(), &info);
+    return info.st_ino;
+}
+
+class entry_order_test: public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        for(size_t i = 0; i < 5; i++)
+        {
+            std::string const path = temp_path("file" + std::to_string(i));
+            std::ofstream(path, std::ios_base::binary) << std::string(1000 + i, static_cast<char>('a' + i));
+            paths.push_back(path);
+        }
+    }
+
+    void TearDown() override
+    {
+        for(auto const & path: paths)
+        {
+            std::remove(path.c_str());
+        }
+    }
+
+    // files are added in reverse order of creation
+    zipstream::builder make_builder(zipstream::entry_order order, bool keep_toc_order)
+    {
+        zipstream::builder builder;
+        builder.set_entry_order(order, keep_toc_order);
+        for(size_t i = paths.size(); i > 0; i--)
+        {
+            builder.add_file_from_path(paths[i - 1], paths[i - 1]);
+            if (i == 3)
+            {
+                builder.add_file_with_content("content.txt", "content");
+            }
+        }
+        return builder;
+    }
+
+    // names of the entries in the order of their data
+    static std::vector<std::string> data_order(zipstream::reader const & zip)
+    {
+        std::vector<std::pair<uint64_t, std::string>> entries;
+        for(size_t index = 0; index < zip.count(); index++)
+        {
+            entries.emplace_back(zip.entry(index).local_header_offset, std::string(zip.name(index)));
+        }
+        std::sort(entries.begin(), entries.end());
+
+        std::vector<std::string> result;
+        for(auto const & entry: entries)
+        {
+            result.push_back(entry.second);
+        }
+        return result;
+    }
+
+    std::vector<std::string> paths;
+};
+
+}
+
+TEST_F(entry_order_test, sorts_by_inode)
+{
+    std::string const archive = temp_path("archive.zip");
+    make_builder(zipstream::entry_order::inode, false).build()->write_to_file(archive);
+
+    {
+        zipstream::reader zip(archive);
+        auto const order = data_order(zip);
+        ASSERT_EQ(6u, order.size());
+        ASSERT_EQ("content.txt", order[0]);
+        for(size_t i = 2; i < order.size(); i++)
+        {
+            ASSERT_LT(inode_of(order[i - 1]), inode_of(order[i]));
+        }
+
+        // the central directory is sorted by name, independent of the disk
+        auto names = order;
+        std::sort(names.begin(), names.end());
+        for(size_t index = 0; index < zip.count(); index++)
+        {
+            ASSERT_EQ(names[index], zip.name(index));
+        }
+
+        for(size_t i = 0; i < paths.size(); i++)
+        {
+            auto const index = zip.find(paths[i]);
+            ASSERT_TRUE(index.has_value());
+            ASSERT_EQ(std::string(1000 + i, static_cast<char>('a' + i)), zip.data(index.value()));
+        }
+    }
+
+    std::remove(archive.c_str());
+}
+
+TEST_F(entry_order_test, keeps_central_directory_order)
+{
+    std::string const archive = temp_path("archive.zip");
+    make_builder(zipstream::entry_order::physical, true).build()->write_to_file(archive);
+
+    {
+        zipstream::reader zip(archive);
+        ASSERT_EQ(6u, zip.count());
+        ASSERT_EQ(paths[4], zip.name(0));
+        ASSERT_EQ(paths[3], zip.name(1));
+        ASSERT_EQ(paths[2], zip.name(2));
+        ASSERT_EQ("content.txt", zip.name(3));
+        ASSERT_EQ(paths[0], zip.name(5));
+        ASSERT_EQ("content.txt", data_order(zip)[0]);
+        ASSERT_EQ("content", zip.data(3));
+    }
+
+    std::remove(archive.c_str());
+}
+
+TEST_F(entry_order_test, ranges_keep_central_directory_order)
+{
+    auto source = make_builder(zipstream::entry_order::inode, true).build_ranges();
+    auto const expected = read_all(*source->open_range(0, source->size()), 1000);
+    ASSERT_EQ(expected.size(), source->size());
+
+    std::string const archive = temp_path("ranges.zip");
+    std::ofstream(archive, std::ios_base::binary) << expected;
+    {
+        zipstream::reader zip(archive);
+        ASSERT_EQ(paths[4], zip.name(0));
+        ASSERT_EQ("content.txt", zip.name(3));
+        ASSERT_EQ("content.txt", data_order(zip)[0]);
+        ASSERT_EQ(std::string(1004, 'e'), zip.data(0));
+    }
+    std::remove(archive.c_str());
+
+    for(size_t begin = 0; begin < expected.size(); begin += 97)
+    {
+        size_t const end = std::min(expected.size(), begin + 500);
+        ASSERT_EQ(expected.substr(begin, end - begin), read_all(*source->open_range(begin, end), 1000));
+    }
+}
+
+TEST(entry_sorter, insertion_order_is_identity)
+{
+    zipstream::entry_table entries;
+    entries.add_file_with_content("b", "b");
+    entries.add_directory("a/");
+    auto const order = zipstream::sort_entries(entries, zipstream::entry_order::insertion);
+    ASSERT_EQ((std::vector<size_t>{0, 1}), order);
+
+    entries.reorder({1, 0});
+    ASSERT_EQ("a/", entries.name(0));
+    ASSERT_EQ("b", entries.name(1));
+    ASSERT_EQ(1u, entries.size(1));
+    ASSERT_THROW(entries.reorder({0}), std::runtime_error);
+}
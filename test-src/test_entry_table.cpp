@@ -0,0 +1,124 @@
+#include "zipstream/entry_table.hpp"
+#include "zipstream/string_arena.hpp"
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+TEST(string_arena, add_and_get)
+{
+    zipstream::string_arena arena;
+    auto const foo = arena.add("foo");
+    auto const empty = arena.add("");
+    auto const large = arena.add(std::string(zipstream::string_arena::chunk_size + 1, 'x'));
+    auto const bar = arena.add("bar");
+
+    ASSERT_EQ("foo", arena.get(foo, 3));
+    ASSERT_STREQ("foo", arena.c_str(foo));
+    ASSERT_EQ("", arena.get(empty, 0));
+    ASSERT_EQ(zipstream::string_arena::chunk_size + 1, std::string(arena.c_str(large)).size());
+    ASSERT_EQ("bar", arena.get(bar, 3));
+}
+
+TEST(entry_table, entries)
+{
+    zipstream::entry_table entries;
+    entries.add_directory("a/");
+    entries.add_file_with_content("a/foo.txt", "42");
+    entries.add_file_from_path("bar.txt", "/path/to/bar.txt", 23);
+
+    ASSERT_EQ(3, entries.count());
+
+    ASSERT_EQ(zipstream::entry_type::directory, entries.type(0));
+    ASSERT_EQ("a/", entries.name(0));
+    ASSERT_EQ(0, entries.size(0));
+    ASSERT_FALSE(entries.data_descriptor_needed(0));
+
+    ASSERT_EQ(zipstream::entry_type::file_with_content, entries.type(1));
+    ASSERT_EQ("a/foo.txt", entries.name(1));
+    ASSERT_EQ(2, entries.size(1));
+    ASSERT_EQ(0x3224b088, entries.crc32(1));
+    ASSERT_FALSE(entries.data_descriptor_needed(1));
+
+    char buffer[2];
+    ASSERT_EQ(1, entries.read_at(1, 1, buffer, 2));
+    ASSERT_EQ('2', buffer[0]);
+
+    ASSERT_EQ(zipstream::entry_type::file_from_path, entries.type(2));
+    ASSERT_EQ(23, entries.size(2));
+    ASSERT_TRUE(entries.data_descriptor_needed(2));
+}
+
+TEST(entry_table, memory_budget)
+{
+    ASSERT_LE(zipstream::entry_table::bytes_per_entry, 40);
+
+    constexpr size_t const count = 100000;
+    constexpr size_t const name_size = 19;
+
+    zipstream::entry_table entries;
+    for(size_t i = 0; i < count; i++)
+    {
+        char name[name_size + 1];
+        snprintf(name, name_size + 1, "dir/file_%06zu.txt", i);
+        entries.add_directory(name);
+    }
+    entries.shrink_to_fit();
+
+    // name + null terminator per entry, plus at most one partially used chunk
+    size_t const budget = count * (zipstream::entry_table::bytes_per_entry + name_size + 1)
+        + (2 * zipstream::string_arena::chunk_size);
+    ASSERT_LE(entries.memory_usage(), budget);
+}
+
+TEST(entry_table, extents_of_sparse_files)
+{
+    std::string const path = "zipstream_entry_table_sparse.bin";
+    {
+        std::FILE * file = std::fopen(path.c_str(), "wb");
+        std::fseek(file, 3 * 1024 * 1024, SEEK_SET);
+        std::fputs("data", file);
+        std::fseek(file, 8 * 1024 * 1024 - 1, SEEK_SET);
+        std::fputc('x', file);
+        std::fclose(file);
+    }
+
+    zipstream::entry_table entries;
+    entries.add_file_from_path("sparse.bin", path);
+    entries.add_file_with_content("content.txt", "42");
+
+    auto const first = entries.extent_at(0, 0);
+    ASSERT_EQ(0u, first.offset);
+    if (!first.hole)
+    {
+        std::remove(path.c_str());
+        GTEST_SKIP() << "file system does not support holes";
+    }
+
+    // holes and data alternate up to the end of the file
+    size_t offset = 0;
+    std::string data;
+    while (offset < entries.size(0))
+    {
+        auto const extent = entries.extent_at(0, offset);
+        ASSERT_EQ(offset, extent.offset);
+        ASSERT_GT(extent.length, 0u);
+        if (!extent.hole)
+        {
+            std::string chunk(extent.length, '\0');
+            ASSERT_EQ(extent.length, entries.read_at(0, offset, &chunk[0], chunk.size()));
+            data += chunk;
+        }
+        offset += extent.length;
+    }
+    ASSERT_EQ(8u * 1024 * 1024, offset);
+    ASSERT_NE(std::string::npos, data.find("data"));
+    ASSERT_EQ('x', data.back());
+    ASSERT_LT(data.size(), 1024u * 1024);
+
+    auto const content = entries.extent_at(1, 1);
+    ASSERT_FALSE(content.hole);
+    ASSERT_EQ(1u, content.length);
+
+    std::remove(path.c_str());
+}
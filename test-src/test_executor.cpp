@@ -0,0 +1,266 @@
+#include <zipstream/zipstream.hpp>
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+std::unique_ptr<zipstream::stream_i> make_stream(size_t index, size_t size)
+{
+    zipstream::builder builder;
+    builder.add_file_with_content("file" + std::to_string(index) + ".txt", std::string(size, static_cast<char>('a' + (index % 26))));
+    return builder.build();
+}
+
+// accepts a few bytes per call and is full now and then
+class slow_sink: public zipstream::sink_i
+{
+public:
+    slow_sink(std::string & output, std::function<void()> on_write = nullptr)
+    : m_output(output)
+    , m_on_write(std::move(on_write))
+    , m_calls(0)
+    {
+    }
+
+    size_t write(char const * data, size_t size) override
+    {
+        if (m_on_write)
+        {
+            m_on_write();
+        }
+
+        if (((m_calls++) % 8) == 0)
+        {
+            return 0;
+        }
+
+        size_t const count = std::min<size_t>(size, 1000);
+        m_output.append(data, count);
+        return count;
+    }
+
+    void finish() override
+    {
+    }
+
+    int descriptor() const override
+    {
+        return -1;
+    }
+
+private:
+    std::string & m_output;
+    std::function<void()> m_on_write;
+    size_t m_calls;
+};
+
+class failing_stream: public zipstream::stream_i
+{
+public:
+    void write_to_file(std::string const &, zipstream::write_mode) override { }
+    void write_to_fd(int) override { }
+    size_t read(char *, size_t) override { throw std::runtime_error("broken"); }
+    void skip(size_t) override { }
+    void reset() override { }
+    size_t memory_usage() const override { return 0; }
+    zipstream::stream_statistics statistics() const override { return zipstream::stream_statistics(); }
+    std::optional<size_t> expected_size() const override { return std::nullopt; }
+};
+
+}
+
+TEST(executor, streams_to_non_blocking_sockets)
+{
+    constexpr size_t const stream_count = 20;
+    zipstream::executor_options options;
+    options.worker_count = 3;
+    options.buffer_size = 16 * 1024;
+    options.slice_size = 32 * 1024;
+    zipstream::executor executor(options);
+
+    std::vector<std::string> expected;
+    std::vector<std::string> received(stream_count);
+    std::vector<int> readers;
+    std::atomic<size_t> completed(0);
+    for(size_t i = 0; i < stream_count; i++)
+    {
+        expected.push_back(read_all(*make_stream(i, 100000 + i * 1000)));
+
+        int sockets[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+        fcntl(sockets[0], F_SETFL, O_NONBLOCK);
+        readers.push_back(sockets[1]);
+        int const writer = sockets[0];
+        executor.submit(make_stream(i, 100000 + i * 1000), zipstream::make_fd_sink(writer),
+            [writer, &completed](std::exception_ptr error) {
+                ASSERT_FALSE(error);
+                close(writer);
+                completed++;
+            });
+    }
+
+    // a slow reader, so that the sockets fill up and streams are parked
+    std::thread reader([&]() {
+        std::vector<char> buffer(8192);
+        size_t open = stream_count;
+        std::vector<bool> done(stream_count, false);
+        while (open > 0)
+        {
+            for(size_t i = 0; i < stream_count; i++)
+            {
+                if (done[i])
+                {
+                    continue;
+                }
+
+                ssize_t const count = read(readers[i], buffer.data(), buffer.size());
+                if (count <= 0)
+                {
+                    done[i] = true;
+                    open--;
+                    continue;
+                }
+                received[i].append(buffer.data(), count);
+            }
+        }
+    });
+
+    executor.wait();
+    reader.join();
+    ASSERT_EQ(stream_count, completed);
+    ASSERT_EQ(0u, executor.active());
+    ASSERT_EQ(0u, executor.memory_usage());
+    for(size_t i = 0; i < stream_count; i++)
+    {
+        ASSERT_EQ(expected[i], received[i]);
+        close(readers[i]);
+    }
+}
+
+TEST(executor, enforces_memory_limit)
+{
+    zipstream::executor_options options;
+    options.worker_count = 2;
+    options.buffer_size = 8 * 1024;
+    // the limit covers the streams themselves, which hold their content
+    size_t const demand = options.buffer_size + make_stream(0, 50000)->memory_usage();
+    options.memory_limit = 3 * demand;
+    zipstream::executor executor(options);
+
+    std::atomic<size_t> peak(0);
+    auto const sample = [&]() {
+        size_t const usage = executor.memory_usage();
+        size_t current = peak;
+        while ((usage > current) && (!peak.compare_exchange_weak(current, usage))) { }
+    };
+
+    std::vector<std::string> outputs(10);
+    for(size_t i = 0; i < outputs.size(); i++)
+    {
+        executor.submit(make_stream(i, 50000), std::make_unique<slow_sink>(outputs[i], sample));
+    }
+    executor.wait();
+
+    ASSERT_LE(peak.load(), options.memory_limit);
+    ASSERT_GE(peak.load(), demand);
+    for(size_t i = 0; i < outputs.size(); i++)
+    {
+        ASSERT_EQ(read_all(*make_stream(i, 50000)), outputs[i]);
+    }
+}
+
+TEST(executor, small_streams_are_not_starved)
+{
+    zipstream::executor_options options;
+    options.worker_count = 1;
+    options.buffer_size = 4 * 1024;
+    options.slice_size = 16 * 1024;
+    zipstream::executor executor(options);
+
+    std::mutex mutex;
+    std::vector<std::string> order;
+    int null_fd = open("/dev/null", O_WRONLY);
+    ASSERT_GE(null_fd, 0);
+    executor.submit(make_stream(0, 20 * 1024 * 1024), zipstream::make_fd_sink(null_fd),
+        [&](std::exception_ptr) { std::lock_guard<std::mutex> lock(mutex); order.push_back("large"); });
+    executor.submit(make_stream(1, 1000), zipstream::make_fd_sink(null_fd),
+        [&](std::exception_ptr) { std::lock_guard<std::mutex> lock(mutex); order.push_back("small"); });
+    executor.wait();
+    close(null_fd);
+
+    ASSERT_EQ((std::vector<std::string>{"small", "large"}), order);
+}
+
+TEST(executor, writes_direct_descriptors)
+{
+    std::string const path = temp_path("executor_direct.zip");
+    int const fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if (fd < 0)
+    {
+        GTEST_SKIP() << "O_DIRECT not supported";
+    }
+
+    // not a multiple of the block size, so that a tail is left
+    zipstream::executor executor;
+    std::exception_ptr error;
+    executor.submit(make_stream(0, 300001), zipstream::make_fd_sink(fd),
+        [&](std::exception_ptr e) { error = e; });
+    executor.wait();
+
+    ASSERT_FALSE(error);
+    ASSERT_NE(0, fcntl(fd, F_GETFL) & O_DIRECT);
+    close(fd);
+    ASSERT_EQ(read_all(*make_stream(0, 300001)), read_file(path));
+    unlink(path.c_str());
+}
+
+TEST(executor, reports_errors)
+{
+    zipstream::executor executor;
+    std::string output;
+    std::exception_ptr error;
+    executor.submit(std::make_unique<failing_stream>(), std::make_unique<slow_sink>(output),
+        [&](std::exception_ptr e) { error = e; });
+    executor.wait();
+
+    ASSERT_TRUE(error);
+    ASSERT_THROW(std::rethrow_exception(error), std::runtime_error);
+    ASSERT_THROW(executor.submit(nullptr, std::make_unique<slow_sink>(output)), std::runtime_error);
+}
+
+TEST(executor, stops_pending_streams)
+{
+    zipstream::executor_options options;
+    options.worker_count = 1;
+    auto executor = std::make_unique<zipstream::executor>(options);
+
+    // the socket is never read, so the stream stays parked
+    int sockets[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+    fcntl(sockets[0], F_SETFL, O_NONBLOCK);
+    std::atomic<size_t> stopped(0);
+    executor->submit(make_stream(0, 10 * 1024 * 1024), zipstream::make_fd_sink(sockets[0]),
+        [&](std::exception_ptr error) { if (error) stopped++; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(1u, executor->active());
+    ASSERT_GT(executor->memory_usage(), 0u);
+
+    executor.reset();
+    ASSERT_EQ(1u, stopped);
+    close(sockets[0]);
+    close(sockets[1]);
+}
@@ -0,0 +1,139 @@
+#include "zipstream/fd_cache.hpp"
+#include <zipstream/zipstream.hpp>
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+std::string read_all(zipstream::file_descriptor const & file)
+{
+    char buffer[100];
+    return std::string(buffer, file.read_at(0, buffer, sizeof(buffer)));
+}
+
+}
+
+TEST(fd_cache, shares_descriptors)
+{
+    std::string const path = temp_path("shared");
+    std::ofstream(path) << "shared";
+
+    zipstream::fd_cache cache(4);
+    auto const first = cache.open(path.c_str());
+    auto const second = cache.open(path.c_str());
+    ASSERT_TRUE(first);
+    ASSERT_EQ(first.get(), second.get());
+    ASSERT_EQ(1u, cache.size());
+    ASSERT_EQ("shared", read_all(*first));
+
+    char buffer[3];
+    ASSERT_EQ(3u, first->read_at(2, buffer, sizeof(buffer)));
+    ASSERT_EQ("are", std::string(buffer, 3));
+
+    ASSERT_FALSE(cache.open(temp_path("missing").c_str()));
+
+    std::remove(path.c_str());
+}
+
+TEST(fd_cache, reopens_replaced_files)
+{
+    std::string const path = temp_path("replaced");
+    std::string const replacement = temp_path("replacement");
+    std::ofstream(path) << "old";
+
+    zipstream::fd_cache cache(4);
+    auto const old_file = cache.open(path.c_str());
+    std::ofstream(replacement) << "new";
+    std::rename(replacement.c_str(), path.c_str());
+
+    auto const new_file = cache.open(path.c_str());
+    ASSERT_NE(old_file.get(), new_file.get());
+    ASSERT_NE(old_file->inode(), new_file->inode());
+    ASSERT_EQ("old", read_all(*old_file));
+    ASSERT_EQ("new", read_all(*new_file));
+    ASSERT_EQ(1u, cache.size());
+
+    std::remove(path.c_str());
+}
+
+TEST(fd_cache, evicts_least_recently_used)
+{
+    std::vector<std::string> paths;
+    for(size_t i = 0; i < 3; i++)
+    {
+        paths.push_back(temp_path("file" + std::to_string(i)));
+        std::ofstream(paths.back()) << i;
+    }
+
+    zipstream::fd_cache cache(2);
+    auto const first = cache.open(paths[0].c_str());
+    cache.open(paths[1].c_str());
+    cache.open(paths[0].c_str());
+    cache.open(paths[2].c_str());
+    ASSERT_EQ(2u, cache.size());
+    ASSERT_EQ(first.get(), cache.open(paths[0].c_str()).get());
+
+    // evicted descriptors stay valid for their users
+    cache.set_limit(0);
+    ASSERT_EQ(0u, cache.size());
+    ASSERT_EQ("0", read_all(*first));
+
+    for(auto const & path: paths)
+    {
+        std::remove(path.c_str());
+    }
+}
+
+TEST(fd_cache, concurrent_streams_read_shared_files)
+{
+    std::string const path = temp_path("concurrent");
+    std::string content;
+    for(size_t i = 0; i < 100000; i++)
+    {
+        content.push_back(static_cast<char>('a' + (i % 26)));
+    }
+    std::ofstream(path, std::ios_base::binary) << content;
+
+    std::vector<std::thread> threads;
+    std::vector<std::string> archives(4);
+    for(size_t i = 0; i < archives.size(); i++)
+    {
+        threads.emplace_back([&, i]() {
+            zipstream::builder builder;
+            builder.add_file_from_path("a.txt", path);
+            builder.add_file_from_path("b.txt", path);
+            auto stream = builder.build();
+            std::vector<char> buffer(4096);
+            size_t count = stream->read(buffer.data(), buffer.size());
+            while (count > 0)
+            {
+                archives[i].append(buffer.data(), count);
+                count = stream->read(buffer.data(), buffer.size());
+            }
+        });
+    }
+    for(auto & thread: threads)
+    {
+        thread.join();
+    }
+
+    for(auto const & archive: archives)
+    {
+        ASSERT_EQ(archives[0], archive);
+        ASSERT_NE(std::string::npos, archive.find(content));
+    }
+    ASSERT_GE(zipstream::get_cached_descriptors(), 1u);
+
+    std::remove(path.c_str());
+}
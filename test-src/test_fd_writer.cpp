@@ -0,0 +1,256 @@
+#include "zipstream/fd_writer.hpp"
+#include <zipstream/zipstream.hpp>
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+// many small entries, so that the archive consists mostly of headers
+zipstream::builder make_builder()
+{
+    zipstream::builder builder;
+    for(size_t i = 0; i < 2000; i++)
+    {
+        builder.add_file_with_content("dir/file" + std::to_string(i) + ".txt", std::to_string(i));
+    }
+    return builder;
+}
+
+// implements only what a stream needs at least
+class minimal_stream: public zipstream::stream_i
+{
+public:
+    explicit minimal_stream(std::string const & data)
+    : m_data(data)
+    , m_pos(0)
+    {
+    }
+
+    size_t read(char * buffer, size_t buffer_size) override
+    {
+        size_t const count = m_data.copy(buffer, buffer_size, m_pos);
+        m_pos += count;
+        return count;
+    }
+
+    void skip(size_t count) override
+    {
+        m_pos = std::min(m_data.size(), m_pos + count);
+    }
+
+    void reset() override
+    {
+        m_pos = 0;
+    }
+
+private:
+    std::string const m_data;
+    size_t m_pos;
+};
+
+}
+
+TEST(fd_writer, writes_files)
+{
+    std::string const path = temp_path("archive.zip");
+    auto stream = make_builder().build();
+    stream->write_to_file(path);
+
+    stream->reset();
+    std::string const expected = read_all(*stream);
+    ASSERT_EQ(expected, read_file(path));
+    ASSERT_EQ(expected.size(), stream->expected_size());
+
+    // an existing file is replaced
+    std::ofstream(path, std::ios_base::binary) << std::string(expected.size() * 2, 'x');
+    stream->write_to_file(path);
+    ASSERT_EQ(expected, read_file(path));
+    std::remove(path.c_str());
+
+    ASSERT_THROW(stream->write_to_file(temp_path("missing/archive.zip")), std::runtime_error);
+}
+
+TEST(fd_writer, batches_small_records)
+{
+    auto stream = make_builder().build();
+    std::string const expected = read_all(*stream);
+    stream->reset();
+
+    std::string const path = temp_path("batched.zip");
+    int const fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    ASSERT_GE(fd, 0);
+    size_t account = 0;
+    {
+        zipstream::fd_writer writer(fd, account);
+        writer.write(*stream);
+        ASSERT_LE(writer.write_count(), (expected.size() / (64 * 1024)) + 1);
+    }
+    close(fd);
+    ASSERT_EQ(0u, account);
+    ASSERT_EQ(expected, read_file(path));
+    std::remove(path.c_str());
+}
+
+TEST(fd_writer, preallocates_regular_files)
+{
+    std::string const path = temp_path("preallocated");
+    int const fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    ASSERT_GE(fd, 0);
+    size_t account = 0;
+    zipstream::fd_writer writer(fd, account);
+    writer.preallocate(1024 * 1024);
+
+    // the size is kept, since the stream may turn out shorter
+    struct stat info;
+    ASSERT_EQ(0, fstat(fd, &info));
+    ASSERT_EQ(0, info.st_size);
+    close(fd);
+    std::remove(path.c_str());
+
+    // not a regular file
+    int pipe_fd[2];
+    ASSERT_EQ(0, pipe(pipe_fd));
+    zipstream::fd_writer(pipe_fd[1], account).preallocate(1024 * 1024);
+    close(pipe_fd[0]);
+    close(pipe_fd[1]);
+}
+
+TEST(fd_writer, waits_for_non_blocking_sockets)
+{
+    auto stream = make_builder().build();
+    std::string const expected = read_all(*stream);
+
+    int sockets[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+    fcntl(sockets[0], F_SETFL, O_NONBLOCK);
+
+    std::string received;
+    std::thread reader([&]() {
+        std::vector<char> buffer(1000);
+        ssize_t count = read(sockets[1], buffer.data(), buffer.size());
+        while (count > 0)
+        {
+            received.append(buffer.data(), count);
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+            count = read(sockets[1], buffer.data(), buffer.size());
+        }
+    });
+
+    auto pipelined = zipstream::make_pipelined(make_builder().build());
+    pipelined->write_to_fd(sockets[0]);
+    close(sockets[0]);
+    reader.join();
+    close(sockets[1]);
+
+    ASSERT_EQ(expected, received);
+}
+
+TEST(fd_writer, reports_write_errors)
+{
+    signal(SIGPIPE, SIG_IGN);
+    int pipe_fd[2];
+    ASSERT_EQ(0, pipe(pipe_fd));
+    close(pipe_fd[0]);
+    ASSERT_THROW(make_builder().build()->write_to_fd(pipe_fd[1]), std::runtime_error);
+    close(pipe_fd[1]);
+}
+
+TEST(fd_writer, writes_direct)
+{
+    // large stored entries with an unaligned end
+    std::string const content(3 * 1024 * 1024 + 123, 'd');
+    zipstream::builder builder;
+    builder.add_file_with_content("a.txt", content);
+    builder.add_file_with_content("b.txt", content.substr(0, 1000));
+    auto stream = builder.build();
+    std::string const expected = read_all(*stream);
+
+    std::string const path = temp_path("direct.zip");
+    stream->write_to_file(path, zipstream::write_mode::direct);
+    ASSERT_EQ(expected, read_file(path));
+
+    int const fd = open(path.c_str(), O_WRONLY | O_TRUNC | O_DIRECT);
+    if (fd < 0)
+    {
+        std::remove(path.c_str());
+        GTEST_SKIP() << "O_DIRECT is not supported";
+    }
+
+    size_t account = 0;
+    {
+        zipstream::fd_writer writer(fd, account);
+        ASSERT_TRUE(writer.direct());
+        stream->reset();
+        writer.write(*stream);
+    }
+    ASSERT_NE(0, fcntl(fd, F_GETFL) & O_DIRECT);
+    ASSERT_EQ(expected, read_file(path));
+
+    // unaligned offsets are written through the page cache
+    ASSERT_EQ(10, lseek(fd, 10, SEEK_SET));
+    {
+        zipstream::fd_writer writer(fd, account);
+        ASSERT_FALSE(writer.direct());
+        stream->reset();
+        writer.write(*stream);
+    }
+    ASSERT_NE(0, fcntl(fd, F_GETFL) & O_DIRECT);
+    close(fd);
+    ASSERT_EQ(expected, read_file(path).substr(10));
+
+    std::remove(path.c_str());
+}
+
+TEST(fd_writer, expected_sizes)
+{
+    std::string const path = temp_path("file.txt");
+    std::ofstream(path, std::ios_base::binary) << std::string(5000, 'f');
+    zipstream::builder stored;
+    stored.add_directory("dir/");
+    stored.add_file_with_content("dir/a.txt", "a");
+    stored.add_file_from_path("dir/b.txt", path);
+    auto stream = stored.build();
+    ASSERT_EQ(read_all(*stream).size(), stream->expected_size());
+    std::remove(path.c_str());
+
+    zipstream::builder compressed;
+    compressed.set_compression(zipstream::compression::zlib);
+    compressed.add_file_with_content("a.txt", std::string(1000, 'a'));
+    ASSERT_FALSE(compressed.build()->expected_size());
+
+    auto source = make_builder().build_ranges();
+    ASSERT_EQ(source->size(), source->open_range(0, source->size())->expected_size());
+    ASSERT_EQ(100u, source->open_range(50, 150)->expected_size());
+}
+
+TEST(fd_writer, writes_streams_using_defaults)
+{
+    std::string const expected = read_all(*make_builder().build());
+    minimal_stream stream(expected);
+    ASSERT_EQ(0u, stream.memory_usage());
+    ASSERT_FALSE(stream.expected_size());
+    ASSERT_EQ(0u, stream.statistics().entries);
+
+    std::string const path = temp_path("minimal.zip");
+    stream.write_to_file(path);
+    ASSERT_EQ(expected, read_file(path));
+    stream.write_to_file(path, zipstream::write_mode::direct);
+    ASSERT_EQ(expected, read_file(path));
+    std::remove(path.c_str());
+}
@@ -0,0 +1,151 @@
+#include <zipstream/zipstream.hpp>
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+std::string name_of(size_t index)
+{
+    // long names make the central directory large
+    return "dir/" + std::string(100, 'n') + "/" + std::to_string(index) + ".txt";
+}
+
+zipstream::entry_generator make_generator(size_t entry_count, size_t batch_size)
+{
+    auto next = std::make_shared<size_t>(0);
+    return [next, entry_count, batch_size](zipstream::entry_sink_i & sink) {
+        if (*next >= entry_count)
+        {
+            return false;
+        }
+
+        for(size_t i = 0; (i < batch_size) && (*next < entry_count); i++, (*next)++)
+        {
+            if ((*next % 100) == 0)
+            {
+                sink.add_directory(name_of(*next) + "/");
+            }
+            else
+            {
+                sink.add_file_with_content(name_of(*next), std::to_string(*next));
+            }
+        }
+        return true;
+    };
+}
+
+std::string build_eagerly(size_t entry_count)
+{
+    zipstream::builder builder;
+    for(size_t index = 0; index < entry_count; index++)
+    {
+        if ((index % 100) == 0)
+        {
+            builder.add_directory(name_of(index) + "/");
+        }
+        else
+        {
+            builder.add_file_with_content(name_of(index), std::to_string(index));
+        }
+    }
+    return read_all(*builder.build());
+}
+
+}
+
+TEST(generator, matches_eager_stream)
+{
+    std::string const expected = build_eagerly(1000);
+    for(size_t batch_size: {size_t(1), size_t(7), size_t(1000)})
+    {
+        zipstream::builder builder;
+        auto stream = builder.build(make_generator(1000, batch_size));
+        ASSERT_EQ(expected, read_all(*stream, 1000));
+        ASSERT_THROW(stream->reset(), std::runtime_error);
+    }
+}
+
+TEST(generator, spills_central_directory)
+{
+    // about 2.3 MiB of central directory records, beyond the 1 MiB kept in memory
+    constexpr size_t const entry_count = 15000;
+    std::string const expected = build_eagerly(entry_count);
+
+    zipstream::builder builder;
+    auto stream = builder.build(make_generator(entry_count, 50));
+    std::string archive;
+    size_t peak = 0;
+    std::vector<char> buffer(64 * 1024);
+    size_t count = stream->read(buffer.data(), buffer.size());
+    while (count > 0)
+    {
+        archive.append(buffer.data(), count);
+        peak = std::max(peak, stream->memory_usage());
+        count = stream->read(buffer.data(), buffer.size());
+    }
+
+    ASSERT_EQ(expected, archive);
+    ASSERT_LT(peak, 2 * 1024 * 1024);
+
+    std::string const path = temp_path("generated.zip");
+    std::ofstream(path, std::ios_base::binary) << archive;
+    {
+        zipstream::reader zip(path);
+        ASSERT_EQ(entry_count, zip.count());
+        ASSERT_GT(zip.toc().size(), 2 * 1024 * 1024);
+        ASSERT_EQ(name_of(entry_count - 1), zip.name(entry_count - 1));
+        ASSERT_EQ(std::to_string(entry_count - 1), zip.data(entry_count - 1));
+    }
+    std::remove(path.c_str());
+}
+
+TEST(generator, counts_entries_beyond_65535)
+{
+    // the end of central directory record cannot count them, a zip64 record does
+    constexpr size_t const entry_count = 65536 + 10;
+    zipstream::builder eager;
+    for(size_t index = 0; index < entry_count; index++)
+    {
+        eager.add_file_with_content(std::to_string(index), "");
+    }
+    std::string const expected = read_all(*eager.build(), 64 * 1024);
+
+    auto next = std::make_shared<size_t>(0);
+    zipstream::builder builder;
+    auto stream = builder.build([next, entry_count](zipstream::entry_sink_i & sink) {
+        if (*next >= entry_count)
+        {
+            return false;
+        }
+        sink.add_file_with_content(std::to_string((*next)++), "");
+        return true;
+    });
+    ASSERT_EQ(expected, read_all(*stream, 64 * 1024));
+
+    zipstream::builder ranges;
+    for(size_t index = 0; index < entry_count; index++)
+    {
+        ranges.add_file_with_content(std::to_string(index), "");
+    }
+    auto source = ranges.build_ranges();
+    ASSERT_EQ(expected.size(), source->size());
+    ASSERT_EQ(expected.substr(expected.size() - 100), read_all(*source->open_range(expected.size() - 100, expected.size())));
+
+    std::string const path = temp_path("many.zip");
+    std::ofstream(path, std::ios_base::binary) << expected;
+    {
+        zipstream::reader zip(path);
+        ASSERT_EQ(entry_count, zip.count());
+        ASSERT_EQ(std::to_string(entry_count - 1), zip.name(entry_count - 1));
+    }
+    std::remove(path.c_str());
+}
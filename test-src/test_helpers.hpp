@@ -0,0 +1,83 @@
+#ifndef ZIPSTREAM_TEST_HELPERS_HPP
+#define ZIPSTREAM_TEST_HELPERS_HPP
+
+#include <zipstream/stream_i.hpp>
+
+#include <unistd.h>
+#include <zlib.h>
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// helpers shared by the tests
+namespace zipstream_test
+{
+
+// file name in the working directory that is unique per test process
+inline std::string temp_path(std::string const & name)
+{
+    return "zipstream_test_" + std::to_string(getpid()) + "_" + name;
+}
+
+// reads the remainder of a stream in chunks of chunk_size bytes
+inline std::string read_all(zipstream::stream_i & stream, size_t chunk_size = 4096)
+{
+    std::string result;
+    std::vector<char> buffer(chunk_size);
+    size_t count = stream.read(buffer.data(), buffer.size());
+    while (count > 0)
+    {
+        result.append(buffer.data(), count);
+        count = stream.read(buffer.data(), buffer.size());
+    }
+
+    return result;
+}
+
+inline std::string read_file(std::string const & path)
+{
+    std::ifstream file(path, std::ios_base::binary);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+inline void put_u16(std::string & data, uint16_t value)
+{
+    data.push_back(static_cast<char>(value & 0xff));
+    data.push_back(static_cast<char>(value >> 8));
+}
+
+inline void put_u32(std::string & data, uint32_t value)
+{
+    put_u16(data, value & 0xffff);
+    put_u16(data, value >> 16);
+}
+
+inline void put_u64(std::string & data, uint64_t value)
+{
+    put_u32(data, value & 0xffffffff);
+    put_u32(data, value >> 32);
+}
+
+// raw deflate data as stored in zip entries
+inline std::string deflate_raw(std::string const & content)
+{
+    z_stream stream = {};
+    deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    std::string result(deflateBound(&stream, content.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(content.data()));
+    stream.avail_in = content.size();
+    stream.next_out = reinterpret_cast<Bytef *>(&result[0]);
+    stream.avail_out = result.size();
+    deflate(&stream, Z_FINISH);
+    result.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    return result;
+}
+
+}
+
+#endif
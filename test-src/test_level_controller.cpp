@@ -0,0 +1,97 @@
+#include "zipstream/level_controller.hpp"
+#include <zipstream/zipstream.hpp>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using zipstream::level_controller;
+
+TEST(level_controller, starts_in_the_middle_of_the_range)
+{
+    ASSERT_EQ(5, level_controller(1, 9).level());
+    ASSERT_EQ(3, level_controller(3, 3).level());
+    ASSERT_THROW(level_controller(5, 1), std::runtime_error);
+}
+
+TEST(level_controller, lowers_level_if_consumer_waits)
+{
+    level_controller controller(1, 9);
+    ASSERT_FALSE(controller.update(0.05, 0.0));
+    ASSERT_TRUE(controller.update(0.05, 0.0));
+    ASSERT_EQ(4, controller.level());
+
+    for(int i = 0; i < 10; i++)
+    {
+        controller.update(0.1, 0.001);
+    }
+    ASSERT_EQ(1, controller.level());
+}
+
+TEST(level_controller, raises_level_if_consumer_is_slow)
+{
+    level_controller controller(1, 9);
+    for(int i = 0; i < 10; i++)
+    {
+        controller.update(0.01, 0.1);
+    }
+    ASSERT_EQ(9, controller.level());
+}
+
+TEST(level_controller, keeps_level_in_between)
+{
+    level_controller controller(1, 9);
+    for(int i = 0; i < 10; i++)
+    {
+        controller.update(0.08, 0.02);
+    }
+    ASSERT_EQ(5, controller.level());
+}
+
+TEST(level_controller, stream_raises_level_for_slow_consumer)
+{
+    std::string content;
+    for(int i = 0; content.size() < (4 * 1024 * 1024); i++)
+    {
+        content += "line " + std::to_string((i * 7919) % 10007) + "\n";
+    }
+
+    zipstream::builder builder;
+    builder.set_compression(zipstream::compression::zlib);
+    builder.set_adaptive_level(1, 9);
+    builder.add_file_with_content("data.txt", content);
+    auto stream = builder.build();
+    ASSERT_EQ(5, stream->statistics().compression_level);
+
+    // the consumer takes far longer than the stream
+    std::string archive;
+    std::vector<char> buffer(4096);
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(600);
+    size_t count = stream->read(buffer.data(), buffer.size());
+    while (count > 0)
+    {
+        archive.append(buffer.data(), count);
+        if (std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        count = stream->read(buffer.data(), buffer.size());
+    }
+    ASSERT_GT(stream->statistics().compression_level, 5);
+
+    // level changes within the entry keep the data valid
+    zipstream::unzip_stream unzip(archive.size());
+    unzip.feed(archive.data(), archive.size());
+    unzip.finish();
+    zipstream::unzip_entry entry;
+    ASSERT_TRUE(unzip.next_entry(entry));
+    std::string data;
+    for(count = unzip.read(buffer.data(), buffer.size()); count > 0; count = unzip.read(buffer.data(), buffer.size()))
+    {
+        data.append(buffer.data(), count);
+    }
+    ASSERT_EQ(content, data);
+}
@@ -0,0 +1,116 @@
+#include <zipstream/zipstream.hpp>
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+std::set<std::string> names_of(std::string const & archive)
+{
+    std::string const path = temp_path("live.zip");
+    std::ofstream(path, std::ios_base::binary) << archive;
+    std::set<std::string> result;
+    {
+        zipstream::reader zip(path);
+        for(size_t index = 0; index < zip.count(); index++)
+        {
+            result.insert(std::string(zip.name(index)));
+            EXPECT_EQ(zip.name(index), zip.data(index));
+        }
+    }
+    std::remove(path.c_str());
+
+    return result;
+}
+
+}
+
+TEST(live_builder, entries_added_while_reading)
+{
+    constexpr size_t const thread_count = 4;
+    constexpr size_t const entry_count = 500;
+
+    zipstream::live_builder builder;
+    auto stream = builder.build();
+
+    std::string archive;
+    std::thread reader([&]() { archive = read_all(*stream, 777); });
+
+    std::vector<std::thread> producers;
+    std::set<std::string> expected;
+    for(size_t t = 0; t < thread_count; t++)
+    {
+        for(size_t i = 0; i < entry_count; i++)
+        {
+            expected.insert("t" + std::to_string(t) + "/" + std::to_string(i));
+        }
+        producers.emplace_back([&builder, t]() {
+            for(size_t i = 0; i < entry_count; i++)
+            {
+                std::string const name = "t" + std::to_string(t) + "/" + std::to_string(i);
+                builder.add_file_with_content(name, name);
+            }
+        });
+    }
+    for(auto & producer: producers)
+    {
+        producer.join();
+    }
+
+    builder.finish();
+    reader.join();
+    ASSERT_EQ(expected, names_of(archive));
+    ASSERT_THROW(builder.add_directory("late/"), std::runtime_error);
+    ASSERT_THROW(builder.build(), std::runtime_error);
+}
+
+TEST(live_builder, no_entry_is_lost_when_racing_finish)
+{
+    for(size_t round = 0; round < 50; round++)
+    {
+        zipstream::live_builder builder;
+        auto stream = builder.build();
+
+        std::string archive;
+        std::thread reader([&]() { archive = read_all(*stream); });
+
+        // entries are either in the archive or rejected, never dropped
+        std::atomic<size_t> accepted(0);
+        std::thread producer([&]() {
+            for(size_t i = 0; ; i++)
+            {
+                try
+                {
+                    builder.add_directory("d" + std::to_string(i) + "/");
+                    accepted++;
+                }
+                catch (std::runtime_error const &)
+                {
+                    break;
+                }
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::microseconds(100 * (round % 5)));
+        builder.finish();
+        producer.join();
+        reader.join();
+
+        std::string const path = temp_path("race.zip");
+        std::ofstream(path, std::ios_base::binary) << archive;
+        {
+            zipstream::reader zip(path);
+            ASSERT_EQ(accepted.load(), zip.count());
+        }
+        std::remove(path.c_str());
+    }
+}
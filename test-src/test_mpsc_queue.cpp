@@ -0,0 +1,61 @@
+#include "zipstream/mpsc_queue.hpp"
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+TEST(mpsc_queue, fifo)
+{
+    zipstream::mpsc_queue<int> queue;
+    ASSERT_TRUE(queue.empty());
+    ASSERT_FALSE(queue.pop().has_value());
+
+    queue.push(1);
+    queue.push(2);
+    ASSERT_FALSE(queue.empty());
+    ASSERT_EQ(1, queue.pop().value());
+
+    queue.push(3);
+    ASSERT_EQ(2, queue.pop().value());
+    ASSERT_EQ(3, queue.pop().value());
+    ASSERT_FALSE(queue.pop().has_value());
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST(mpsc_queue, multiple_producers)
+{
+    constexpr size_t const producer_count = 4;
+    constexpr size_t const item_count = 10000;
+
+    zipstream::mpsc_queue<std::pair<size_t, size_t>> queue;
+    std::vector<std::thread> producers;
+    for(size_t id = 0; id < producer_count; id++)
+    {
+        producers.emplace_back([&queue, id]() {
+            for(size_t i = 0; i < item_count; i++)
+            {
+                queue.push({id, i});
+            }
+        });
+    }
+
+    std::vector<size_t> expected(producer_count, 0);
+    size_t received = 0;
+    while (received < (producer_count * item_count))
+    {
+        auto item = queue.pop();
+        if (item.has_value())
+        {
+            // items of each producer arrive in order
+            ASSERT_EQ(expected[item->first], item->second);
+            expected[item->first]++;
+            received++;
+        }
+    }
+
+    for(auto & producer: producers)
+    {
+        producer.join();
+    }
+    ASSERT_TRUE(queue.empty());
+}
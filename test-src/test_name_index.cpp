@@ -0,0 +1,76 @@
+#include "zipstream/name_index.hpp"
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+std::vector<std::string> make_names(size_t count)
+{
+    std::vector<std::string> names;
+    for(size_t i = 0; i < count; i++)
+    {
+        names.push_back("dir/" + std::to_string(i) + ".txt");
+    }
+
+    return names;
+}
+
+}
+
+TEST(name_index, finds_all_names)
+{
+    auto const names = make_names(1000);
+    auto const name_of = [&names](size_t index) { return std::string_view(names[index]); };
+
+    zipstream::name_index index;
+    ASSERT_TRUE(index.empty());
+    index.build(names.size(), name_of);
+    ASSERT_EQ(names.size(), index.count());
+
+    for(size_t i = 0; i < names.size(); i++)
+    {
+        ASSERT_EQ(i, index.find(names[i], name_of).value());
+    }
+    ASSERT_FALSE(index.find("dir/1000.txt", name_of).has_value());
+    ASSERT_FALSE(index.find("", name_of).has_value());
+}
+
+TEST(name_index, duplicates_find_first)
+{
+    std::vector<std::string> const names = {"a", "b", "a"};
+    auto const name_of = [&names](size_t index) { return std::string_view(names[index]); };
+
+    zipstream::name_index index;
+    index.build(names.size(), name_of);
+    ASSERT_EQ(0u, index.find("a", name_of).value());
+}
+
+TEST(name_index, save_and_load)
+{
+    auto const names = make_names(100);
+    auto const name_of = [&names](size_t index) { return std::string_view(names[index]); };
+
+    zipstream::name_index index;
+    index.build(names.size(), name_of);
+    std::stringstream stream;
+    index.save(stream);
+
+    zipstream::name_index loaded;
+    ASSERT_TRUE(loaded.load(stream, names.size()));
+    for(size_t i = 0; i < names.size(); i++)
+    {
+        ASSERT_EQ(i, loaded.find(names[i], name_of).value());
+    }
+
+    stream.clear();
+    stream.seekg(0);
+    ASSERT_FALSE(loaded.load(stream, names.size() + 1));
+    ASSERT_TRUE(loaded.empty());
+
+    std::stringstream truncated(stream.str().substr(0, 40));
+    ASSERT_FALSE(loaded.load(truncated, names.size()));
+}
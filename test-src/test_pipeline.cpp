@@ -0,0 +1,109 @@
+#include "zipstream/spsc_ring.hpp"
+#include <zipstream/zipstream.hpp>
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+std::unique_ptr<zipstream::stream_i> create_stream()
+{
+    zipstream::builder builder;
+    builder.add_directory("a/");
+    for(size_t i = 0; i < 100; i++)
+    {
+        builder.add_file_with_content("a/" + std::to_string(i) + ".txt", std::string(i * 10, 'x'));
+    }
+
+    return builder.build();
+}
+
+}
+
+TEST(spsc_ring, write_and_read)
+{
+    zipstream::spsc_ring ring(4);
+    char * window;
+    ASSERT_EQ(4, ring.write_window(window));
+    memcpy(window, "abc", 3);
+    ring.commit(3);
+    ASSERT_EQ(3, ring.available());
+
+    char out[4] = {0, 0, 0, 0};
+    ASSERT_EQ(2, ring.read(out, 2));
+    ASSERT_STREQ("ab", out);
+
+    // window ends at the end of the ring
+    ASSERT_EQ(1, ring.write_window(window));
+    window[0] = 'd';
+    ring.commit(1);
+    ASSERT_EQ(2, ring.write_window(window));
+    memcpy(window, "ef", 2);
+    ring.commit(2);
+    ASSERT_EQ(0, ring.write_window(window));
+
+    ASSERT_EQ(4, ring.read(out, 4));
+    ASSERT_EQ("cdef", std::string(out, 4));
+    ASSERT_EQ(0, ring.available());
+}
+
+TEST(pipeline, same_output_as_inner_stream)
+{
+    auto stream = create_stream();
+    std::string const expected = read_all(*stream, 1024);
+
+    for(size_t ring_size: {7, 1000, 1024 * 1024})
+    {
+        auto pipelined = zipstream::make_pipelined(create_stream(), ring_size);
+        ASSERT_EQ(expected, read_all(*pipelined, 333));
+    }
+}
+
+TEST(pipeline, reset)
+{
+    auto stream = create_stream();
+    std::string const expected = read_all(*stream, 1024);
+
+    auto pipelined = zipstream::make_pipelined(create_stream(), 100);
+    char buffer[10];
+    pipelined->read(buffer, 10);
+    pipelined->reset();
+    ASSERT_EQ(expected, read_all(*pipelined, 1024));
+}
+
+TEST(pipeline, stops_waiting_for_live_entries)
+{
+    zipstream::live_builder builder;
+    builder.add_file_with_content("a.txt", "contents of a");
+    auto const start = std::chrono::steady_clock::now();
+    {
+        auto pipelined = zipstream::make_pipelined(builder.build(), 1024);
+        char buffer[10];
+        ASSERT_EQ(10u, pipelined->read(buffer, 10));
+        // the producer now waits for further entries
+    }
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    builder.finish();
+}
+
+TEST(pipeline, cancel_interrupts_read)
+{
+    zipstream::live_builder builder;
+    auto pipelined = zipstream::make_pipelined(builder.build(), 1024);
+    std::thread canceller([&pipelined]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        pipelined->cancel();
+    });
+
+    char buffer[10];
+    ASSERT_THROW(pipelined->read(buffer, 10), std::runtime_error);
+    canceller.join();
+    builder.finish();
+}
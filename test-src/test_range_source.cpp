@@ -0,0 +1,102 @@
+#include <zipstream/zipstream.hpp>
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+void add_entries(zipstream::builder & builder)
+{
+    builder.add_directory("a/");
+    for(size_t i = 0; i < 20; i++)
+    {
+        builder.add_file_with_content("a/" + std::to_string(i) + ".txt", std::string(i * 7, 'a' + i));
+    }
+}
+
+}
+
+TEST(range_source, same_as_sequential_stream)
+{
+    zipstream::builder builder;
+    add_entries(builder);
+    auto const expected = read_all(*builder.build(), 100);
+
+    zipstream::builder range_builder;
+    add_entries(range_builder);
+    auto source = range_builder.build_ranges();
+    ASSERT_EQ(expected.size(), source->size());
+    ASSERT_EQ(expected, read_all(*source->open_range(0, source->size()), 100));
+}
+
+TEST(range_source, every_range)
+{
+    std::string const path = "zipstream_range_" + std::to_string(getpid()) + ".txt";
+    std::ofstream(path) << "contents of a file";
+
+    zipstream::builder builder;
+    add_entries(builder);
+    builder.add_file_from_path("file.txt", path);
+    auto source = builder.build_ranges();
+    auto const expected = read_all(*source->open_range(0, source->size()), 100);
+
+    for(size_t begin = 0; begin < expected.size(); begin++)
+    {
+        auto range = source->open_range(begin, begin + 5);
+        ASSERT_EQ(expected.substr(begin, 5), read_all(*range, 100));
+    }
+
+    remove(path.c_str());
+}
+
+TEST(range_source, parallel_parts)
+{
+    zipstream::builder builder;
+    add_entries(builder);
+    auto source = builder.build_ranges();
+    auto const expected = read_all(*source->open_range(0, source->size()), 100);
+
+    constexpr size_t const part_count = 4;
+    size_t const part_size = (source->size() + part_count - 1) / part_count;
+    std::vector<std::string> parts(part_count);
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < part_count; i++)
+    {
+        threads.emplace_back([&, i]() {
+            parts[i] = read_all(*source->open_range(i * part_size, (i + 1) * part_size), 100);
+        });
+    }
+
+    std::string actual;
+    for(size_t i = 0; i < part_count; i++)
+    {
+        threads[i].join();
+        actual += parts[i];
+    }
+    ASSERT_EQ(expected, actual);
+}
+
+TEST(range_source, skip_and_reset)
+{
+    zipstream::builder builder;
+    add_entries(builder);
+    auto source = builder.build_ranges();
+    auto const expected = read_all(*source->open_range(0, source->size()), 100);
+
+    auto stream = source->open_range(10, source->size());
+    stream->skip(100);
+    ASSERT_EQ(expected.substr(110), read_all(*stream, 100));
+
+    stream->reset();
+    ASSERT_EQ(expected.substr(10), read_all(*stream, 100));
+}
@@ -0,0 +1,168 @@
+#include <zipstream/zipstream.hpp>
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <zlib.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+// archive of deflated entries
+std::string make_deflated_archive(std::map<std::string, std::string> const & files)
+{
+    std::string archive;
+    std::string toc;
+    for(auto const & file: files)
+    {
+        std::string const compressed = deflate_raw(file.second);
+        uint32_t const crc = crc32(0, reinterpret_cast<Bytef const *>(file.second.data()), file.second.size());
+        uint32_t const offset = archive.size();
+
+        put_u32(archive, 0x04034b50);
+        put_u16(archive, 20);
+        put_u16(archive, 0);
+        put_u16(archive, 8);
+        put_u32(archive, 0);
+        put_u32(archive, crc);
+        put_u32(archive, compressed.size());
+        put_u32(archive, file.second.size());
+        put_u16(archive, file.first.size());
+        put_u16(archive, 0);
+        archive += file.first + compressed;
+
+        put_u32(toc, 0x02014b50);
+        put_u16(toc, 20);
+        put_u16(toc, 20);
+        put_u16(toc, 0);
+        put_u16(toc, 8);
+        put_u32(toc, 0);
+        put_u32(toc, crc);
+        put_u32(toc, compressed.size());
+        put_u32(toc, file.second.size());
+        put_u16(toc, file.first.size());
+        put_u32(toc, 0);
+        put_u32(toc, 0);
+        put_u32(toc, 0);
+        put_u32(toc, offset);
+        toc += file.first;
+    }
+
+    uint32_t const toc_offset = archive.size();
+    archive += toc;
+    put_u32(archive, 0x06054b50);
+    put_u32(archive, 0);
+    put_u16(archive, files.size());
+    put_u16(archive, files.size());
+    put_u32(archive, toc.size());
+    put_u32(archive, toc_offset);
+    put_u16(archive, 0);
+
+    return archive;
+}
+
+// decodes all entries, validating their CRCs
+std::map<std::string, std::string> unzip(std::string const & archive)
+{
+    zipstream::unzip_stream unzip;
+    std::map<std::string, std::string> entries;
+    size_t fed = 0;
+    zipstream::unzip_entry entry;
+    while (!unzip.done())
+    {
+        if (unzip.need_input() || (fed == 0))
+        {
+            if (fed < archive.size())
+            {
+                fed += unzip.feed(&archive[fed], archive.size() - fed);
+            }
+            else
+            {
+                unzip.finish();
+            }
+        }
+
+        if (unzip.next_entry(entry))
+        {
+            std::string & content = entries[entry.name];
+            char buffer[1000];
+            size_t count = unzip.read(buffer, 1000);
+            while ((count > 0) || unzip.need_input())
+            {
+                content.append(buffer, count);
+                if (count == 0)
+                {
+                    fed += unzip.feed(&archive[fed], archive.size() - fed);
+                }
+                count = unzip.read(buffer, 1000);
+            }
+        }
+    }
+
+    return entries;
+}
+
+}
+
+TEST(raw_copy, copies_deflated_entries_verbatim)
+{
+    std::string const path = temp_path("deflated.zip");
+    std::map<std::string, std::string> const files = {
+        {"a.txt", std::string(10000, 'a')},
+        {"b.txt", "contents of b"}};
+    std::ofstream(path, std::ios_base::binary) << make_deflated_archive(files);
+
+    zipstream::builder builder;
+    builder.add_file_with_content("stored.txt", "stored");
+    builder.add_file_from_archive("copy/a.txt", path, "a.txt");
+    builder.add_archive(path, "merged");
+    ASSERT_THROW(builder.add_file_from_archive("missing.txt", path, "missing.txt"), std::runtime_error);
+    auto const archive = read_all(*builder.build(), 1000);
+
+    auto const entries = unzip(archive);
+    ASSERT_EQ(4u, entries.size());
+    ASSERT_EQ("stored", entries.at("stored.txt"));
+    ASSERT_EQ(files.at("a.txt"), entries.at("copy/a.txt"));
+    ASSERT_EQ(files.at("a.txt"), entries.at("merged/a.txt"));
+    ASSERT_EQ(files.at("b.txt"), entries.at("merged/b.txt"));
+
+    std::string const merged_path = temp_path("merged.zip");
+    std::ofstream(merged_path, std::ios_base::binary) << archive;
+    {
+        zipstream::reader source(path);
+        zipstream::reader merged(merged_path);
+        auto const info = merged.entry(merged.find("copy/a.txt").value());
+        ASSERT_EQ(8, info.compression_method);
+        ASSERT_EQ(10000u, info.uncompressed_size);
+        ASSERT_EQ(source.data(source.find("a.txt").value()), merged.data(merged.find("copy/a.txt").value()));
+    }
+
+    std::remove(merged_path.c_str());
+    std::remove(path.c_str());
+}
+
+TEST(raw_copy, ranges_match_stream)
+{
+    std::string const path = temp_path("ranges.zip");
+    std::ofstream(path, std::ios_base::binary) << make_deflated_archive({{"x.txt", std::string(5000, 'x')}});
+
+    zipstream::builder builder;
+    builder.add_archive(path);
+    auto const expected = read_all(*builder.build(), 1000);
+
+    zipstream::builder range_builder;
+    range_builder.add_archive(path);
+    auto source = range_builder.build_ranges();
+    ASSERT_EQ(expected, read_all(*source->open_range(0, source->size()), 1000));
+
+    std::remove(path.c_str());
+}
@@ -0,0 +1,288 @@
+#include <zipstream/zipstream.hpp>
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+// archive with a single stored entry using zip64 records only
+std::string make_zip64_archive(std::string const & name, std::string const & content, uint32_t crc32)
+{
+    std::string archive;
+    put_u32(archive, 0x04034b50);
+    put_u16(archive, 45);
+    put_u16(archive, 0);
+    put_u16(archive, 0);
+    put_u16(archive, 0);
+    put_u16(archive, 0);
+    put_u32(archive, crc32);
+    put_u32(archive, 0xffffffff);
+    put_u32(archive, 0xffffffff);
+    put_u16(archive, name.size());
+    put_u16(archive, 20);
+    archive += name;
+    put_u16(archive, 0x0001);
+    put_u16(archive, 16);
+    put_u64(archive, content.size());
+    put_u64(archive, content.size());
+    archive += content;
+
+    size_t const toc_offset = archive.size();
+    put_u32(archive, 0x02014b50);
+    put_u16(archive, 0x031e);
+    put_u16(archive, 45);
+    put_u16(archive, 0);
+    put_u16(archive, 0);
+    put_u16(archive, 0);
+    put_u16(archive, 0);
+    put_u32(archive, crc32);
+    put_u32(archive, 0xffffffff);
+    put_u32(archive, 0xffffffff);
+    put_u16(archive, name.size());
+    put_u16(archive, 28);
+    put_u16(archive, 0);
+    put_u16(archive, 0);
+    put_u16(archive, 0);
+    put_u32(archive, 0);
+    put_u32(archive, 0xffffffff);
+    archive += name;
+    put_u16(archive, 0x0001);
+    put_u16(archive, 24);
+    put_u64(archive, content.size());
+    put_u64(archive, content.size());
+    put_u64(archive, 0);
+    size_t const toc_size = archive.size() - toc_offset;
+
+    size_t const eocd64_offset = archive.size();
+    put_u32(archive, 0x06064b50);
+    put_u64(archive, 44);
+    put_u16(archive, 0x031e);
+    put_u16(archive, 45);
+    put_u32(archive, 0);
+    put_u32(archive, 0);
+    put_u64(archive, 1);
+    put_u64(archive, 1);
+    put_u64(archive, toc_size);
+    put_u64(archive, toc_offset);
+
+    put_u32(archive, 0x07064b50);
+    put_u32(archive, 0);
+    put_u64(archive, eocd64_offset);
+    put_u32(archive, 1);
+
+    put_u32(archive, 0x06054b50);
+    put_u16(archive, 0);
+    put_u16(archive, 0);
+    put_u16(archive, 0xffff);
+    put_u16(archive, 0xffff);
+    put_u32(archive, 0xffffffff);
+    put_u32(archive, 0xffffffff);
+    put_u16(archive, 0);
+
+    return archive;
+}
+
+}
+
+TEST(reader, reads_built_archive)
+{
+    std::string const path = temp_path("built.zip");
+    zipstream::builder builder;
+    builder.add_directory("dir/");
+    builder.add_file_with_content("dir/a.txt", "contents of a");
+    builder.add_file_with_content("dir/empty.txt", "");
+    builder.build()->write_to_file(path);
+
+    {
+        zipstream::reader reader(path);
+        ASSERT_EQ(3u, reader.count());
+        ASSERT_EQ("dir/", reader.name(0));
+        ASSERT_EQ("dir/a.txt", reader.name(1));
+
+        auto const info = reader.entry(1);
+        ASSERT_EQ(0, info.compression_method);
+        ASSERT_EQ(13u, info.uncompressed_size);
+        ASSERT_EQ("contents of a", reader.data(1));
+        ASSERT_EQ("", reader.data(2));
+        ASSERT_EQ(info.crc32, reader.local_header(1).crc32);
+
+        ASSERT_EQ(2u, reader.find("dir/empty.txt").value());
+        ASSERT_FALSE(reader.find("missing").has_value());
+        ASSERT_THROW(reader.entry(3), std::out_of_range);
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST(reader, reads_zip64_archive)
+{
+    std::string const path = temp_path("zip64.zip");
+    std::ofstream(path, std::ios_base::binary) << make_zip64_archive("hello.txt", "hello", 0x3610a686);
+
+    {
+        zipstream::reader reader(path);
+        ASSERT_EQ(1u, reader.count());
+
+        auto const info = reader.entry(0);
+        ASSERT_EQ("hello.txt", info.name);
+        ASSERT_EQ(5u, info.compressed_size);
+        ASSERT_EQ(5u, info.uncompressed_size);
+        ASSERT_EQ(0u, info.local_header_offset);
+        ASSERT_EQ(0x3610a686u, info.crc32);
+        ASSERT_EQ("hello", reader.data(0));
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST(reader, rejects_invalid_files)
+{
+    std::string const path = temp_path("invalid.zip");
+    std::ofstream(path) << "this is not a zip archive";
+    ASSERT_THROW(zipstream::reader reader(path), std::runtime_error);
+
+    std::ofstream(path, std::ios_base::trunc).close();
+    ASSERT_THROW(zipstream::reader reader(path), std::runtime_error);
+
+    std::remove(path.c_str());
+    ASSERT_THROW(zipstream::reader reader(path), std::runtime_error);
+}
+
+TEST(reader, index_sidecar)
+{
+    std::string const path = temp_path("indexed.zip");
+    std::string const index_path = path + ".idx";
+    zipstream::builder builder;
+    for(size_t i = 0; i < 500; i++)
+    {
+        builder.add_file_with_content(std::to_string(i) + ".txt", std::to_string(i));
+    }
+    builder.build()->write_to_file(path);
+
+    {
+        zipstream::reader reader(path);
+        ASSERT_FALSE(reader.load_index(index_path));
+        reader.save_index(index_path);
+        ASSERT_EQ(42u, reader.find("42.txt").value());
+    }
+
+    {
+        zipstream::reader reader(path);
+        ASSERT_TRUE(reader.load_index(index_path));
+        for(size_t i = 0; i < 500; i++)
+        {
+            auto const index = reader.find(std::to_string(i) + ".txt");
+            ASSERT_EQ(i, index.value());
+            ASSERT_EQ(std::to_string(i), reader.data(i));
+        }
+        ASSERT_FALSE(reader.find("500.txt").has_value());
+    }
+
+    zipstream::builder other_builder;
+    other_builder.add_file_with_content("other.txt", "other");
+    other_builder.build()->write_to_file(path);
+    {
+        zipstream::reader reader(path);
+        ASSERT_FALSE(reader.load_index(index_path));
+        ASSERT_EQ(0u, reader.find("other.txt").value());
+        reader.save_index(index_path);
+    }
+
+    // same sizes and offsets, but other names
+    zipstream::builder renamed_builder;
+    renamed_builder.add_file_with_content("OTHER.txt", "other");
+    renamed_builder.build()->write_to_file(path);
+    {
+        zipstream::reader reader(path);
+        ASSERT_FALSE(reader.load_index(index_path));
+        ASSERT_EQ(0u, reader.find("OTHER.txt").value());
+    }
+
+    std::remove(index_path.c_str());
+    std::remove(path.c_str());
+}
+
+TEST(reader, finds_end_of_central_directory_before_comment)
+{
+    std::string const path = temp_path("comment.zip");
+    zipstream::builder builder;
+    builder.add_file_with_content("a.txt", "a");
+    std::string archive;
+    {
+        std::string const temp = temp_path("plain.zip");
+        builder.build()->write_to_file(temp);
+        std::ifstream file(temp, std::ios_base::binary);
+        archive.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        std::remove(temp.c_str());
+    }
+
+    std::string const comment(60000, 'c');
+    archive[archive.size() - 2] = static_cast<char>(comment.size() & 0xff);
+    archive[archive.size() - 1] = static_cast<char>(comment.size() >> 8);
+    std::ofstream(path, std::ios_base::binary) << archive << comment;
+
+    {
+        zipstream::reader reader(path);
+        ASSERT_EQ(1u, reader.count());
+        ASSERT_EQ(comment, reader.comment());
+        ASSERT_EQ("a", reader.data(0));
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST(reader, recovers_truncated_archive)
+{
+    std::string const data_path = temp_path("data.txt");
+    std::string const path = temp_path("truncated.zip");
+    std::string const recovered_path = temp_path("recovered.zip");
+    std::ofstream(data_path) << "data with unknown crc";
+
+    zipstream::builder builder;
+    builder.add_directory("dir/");
+    builder.add_file_with_content("dir/a.txt", "contents of a");
+    builder.add_file_from_path("dir/b.txt", data_path);
+    builder.add_file_with_content("dir/c.txt", std::string(1000, 'c'));
+    builder.build()->write_to_file(path);
+
+    {
+        // cut the archive in the middle of the last entry
+        std::ifstream file(path, std::ios_base::binary);
+        std::string archive((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        size_t const cut = archive.find("dir/c.txt") + 100;
+        std::ofstream(path, std::ios_base::binary | std::ios_base::trunc) << ("garbage" + archive.substr(0, cut));
+    }
+
+    ASSERT_THROW(zipstream::reader reader(path), std::runtime_error);
+    ASSERT_EQ(3u, zipstream::recover_archive(path, recovered_path));
+
+    {
+        zipstream::reader reader(recovered_path);
+        ASSERT_EQ(3u, reader.count());
+        ASSERT_EQ("dir/", reader.name(0));
+        ASSERT_EQ("contents of a", reader.data(1));
+        ASSERT_EQ("dir/b.txt", reader.name(2));
+        ASSERT_EQ("data with unknown crc", reader.data(2));
+    }
+
+    // no space left on device
+    if (0 == access("/dev/full", W_OK))
+    {
+        ASSERT_THROW(zipstream::recover_archive(path, "/dev/full"), std::runtime_error);
+    }
+
+    std::remove(recovered_path.c_str());
+    std::remove(path.c_str());
+    std::remove(data_path.c_str());
+}
@@ -0,0 +1,66 @@
+#include "zipstream/signature_scanner.hpp"
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace
+{
+
+constexpr uint32_t const signature = 0x04034b50;
+
+size_t naive_find(std::string const & data)
+{
+    size_t const pos = data.find("PK\x03\x04");
+    return (pos == std::string::npos) ? data.size() : pos;
+}
+
+size_t naive_find_last(std::string const & data)
+{
+    size_t const pos = data.rfind("PK\x03\x04");
+    return (pos == std::string::npos) ? data.size() : pos;
+}
+
+}
+
+TEST(signature_scanner, not_found)
+{
+    ASSERT_EQ(0u, zipstream::find_signature("", 0, signature));
+    ASSERT_EQ(3u, zipstream::find_signature("PK\x03", 3, signature));
+    ASSERT_EQ(3u, zipstream::find_last_signature("PK\x03", 3, signature));
+
+    std::string const data(1000, 'P');
+    ASSERT_EQ(data.size(), zipstream::find_signature(data.data(), data.size(), signature));
+    ASSERT_EQ(data.size(), zipstream::find_last_signature(data.data(), data.size(), signature));
+}
+
+TEST(signature_scanner, matches_naive_search)
+{
+    // near misses and matches at every position relative to block boundaries
+    for(size_t size = 0; size < 100; size++)
+    {
+        for(size_t pos = 0; (pos + 4) <= size; pos++)
+        {
+            std::string data(size, 'x');
+            for(size_t i = 0; (i + 2) <= size; i += 5)
+            {
+                data.replace(i, 2, "PK");
+            }
+            data.replace(pos, 4, "PK\x03\x04");
+
+            ASSERT_EQ(naive_find(data), zipstream::find_signature(data.data(), data.size(), signature));
+            ASSERT_EQ(naive_find_last(data), zipstream::find_last_signature(data.data(), data.size(), signature));
+        }
+    }
+}
+
+TEST(signature_scanner, finds_first_and_last)
+{
+    std::string data(10000, '\0');
+    data.replace(1234, 4, "PK\x03\x04");
+    data.replace(5678, 4, "PK\x03\x04");
+    data.replace(9996, 4, "PK\x03\x04");
+
+    ASSERT_EQ(1234u, zipstream::find_signature(data.data(), data.size(), signature));
+    ASSERT_EQ(9996u, zipstream::find_last_signature(data.data(), data.size(), signature));
+    ASSERT_EQ(5678u, zipstream::find_last_signature(data.data(), data.size() - 1, signature));
+}
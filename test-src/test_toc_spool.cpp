@@ -0,0 +1,60 @@
+#include "zipstream/toc_spool.hpp"
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace
+{
+
+void append(zipstream::toc_spool & spool, std::string const & value)
+{
+    zipstream::buffer record(value.size());
+    record.write_str(value);
+    spool.append(record);
+}
+
+std::string read_all(zipstream::toc_spool & spool, size_t chunk_size)
+{
+    std::string result;
+    char buffer[16];
+    size_t count = spool.read(buffer, chunk_size);
+    while (count > 0)
+    {
+        result.append(buffer, count);
+        count = spool.read(buffer, chunk_size);
+    }
+
+    return result;
+}
+
+}
+
+TEST(toc_spool, keep_records_in_memory)
+{
+    zipstream::toc_spool spool(1024);
+    append(spool, "Hello,");
+    append(spool, " world!");
+
+    ASSERT_EQ(13, spool.size());
+    spool.rewind();
+    ASSERT_EQ("Hello, world!", read_all(spool, 16));
+}
+
+TEST(toc_spool, spill_to_file)
+{
+    zipstream::toc_spool spool(8);
+    std::string expected;
+    for(size_t i = 0; i < 100; i++)
+    {
+        std::string const record = "record_" + std::to_string(i) + ";";
+        append(spool, record);
+        expected += record;
+    }
+
+    ASSERT_EQ(expected.size(), spool.size());
+    spool.rewind();
+    ASSERT_EQ(expected, read_all(spool, 5));
+
+    spool.rewind();
+    ASSERT_EQ(expected, read_all(spool, 16));
+}
@@ -0,0 +1,128 @@
+#include "zipstream/tree_walker.hpp"
+#include <zipstream/zipstream.hpp>
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+class temp_tree
+{
+public:
+    temp_tree()
+    {
+        path = fs::temp_directory_path() / ("zipstream_tree_" + std::to_string(getpid()));
+        fs::remove_all(path);
+        fs::create_directories(path / "b" / "c");
+        fs::create_directories(path / "a");
+        fs::create_directories(path / "skip");
+        write("z.txt", "z");
+        write("a/1.txt", "1");
+        write("a/2.bin", "22");
+        write("b/c/3.txt", "333");
+        write("skip/4.txt", "4");
+    }
+
+    ~temp_tree()
+    {
+        fs::remove_all(path);
+    }
+
+    void write(std::string const & name, std::string const & content)
+    {
+        std::ofstream(path / name) << content;
+    }
+
+    fs::path path;
+};
+
+std::vector<std::string> names(std::vector<zipstream::tree_item> const & items)
+{
+    std::vector<std::string> result;
+    for(auto const & item: items)
+    {
+        result.push_back(item.name);
+    }
+    return result;
+}
+
+}
+
+TEST(tree_walker, walk_in_deterministic_order)
+{
+    temp_tree tree;
+
+    for(size_t workers = 1; workers <= 4; workers++)
+    {
+        zipstream::tree_walker walker(tree.path.string(), {}, workers);
+        auto const items = walker.walk();
+
+        std::vector<std::string> const expected = {
+            "a/", "a/1.txt", "a/2.bin", "b/", "b/c/", "b/c/3.txt", "skip/", "skip/4.txt", "z.txt"};
+        ASSERT_EQ(expected, names(items));
+    }
+}
+
+TEST(tree_walker, provide_path_and_size)
+{
+    temp_tree tree;
+
+    zipstream::tree_walker walker(tree.path.string(), {});
+    auto const items = walker.walk();
+
+    ASSERT_EQ("b/c/3.txt", items[5].name);
+    ASSERT_FALSE(items[5].is_directory);
+    ASSERT_EQ(3, items[5].size);
+    ASSERT_TRUE(fs::equivalent(tree.path / "b" / "c" / "3.txt", items[5].path));
+}
+
+TEST(tree_walker, apply_filters)
+{
+    temp_tree tree;
+
+    zipstream::tree_filter filter;
+    filter.include = {"*.txt"};
+    filter.exclude = {"skip"};
+    zipstream::tree_walker walker(tree.path.string(), filter, 2);
+
+    std::vector<std::string> const expected = {"a/", "a/1.txt", "b/", "b/c/", "b/c/3.txt", "z.txt"};
+    ASSERT_EQ(expected, names(walker.walk()));
+}
+
+TEST(tree_walker, skip_directories_without_included_files)
+{
+    temp_tree tree;
+    fs::create_directories(tree.path / "b" / "empty");
+    fs::create_directories(tree.path / "data" / "empty");
+
+    zipstream::tree_filter filter;
+    filter.include = {"*.bin", "data"};
+    zipstream::tree_walker walker(tree.path.string(), filter, 2);
+
+    // "b/" has no included files, "data/" is included itself
+    std::vector<std::string> const expected = {"a/", "a/2.bin", "data/"};
+    ASSERT_EQ(expected, names(walker.walk()));
+}
+
+TEST(tree_walker, throw_on_missing_root)
+{
+    zipstream::tree_walker walker("/non/existing/path", {});
+    ASSERT_ANY_THROW({
+        walker.walk();
+    });
+}
+
+TEST(tree_walker, reject_files_beyond_4_gib)
+{
+    temp_tree tree;
+    fs::resize_file(tree.path / "a" / "2.bin", (uintmax_t(1) << 32) + 1);
+
+    zipstream::builder builder;
+    ASSERT_THROW(builder.add_tree(tree.path.string(), ""), std::runtime_error);
+}
@@ -0,0 +1,222 @@
+#include <zipstream/zipstream.hpp>
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+#include <zlib.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+using namespace zipstream_test;
+
+namespace
+{
+
+// feeds the archive in chunks of chunk_size and collects all entries
+std::map<std::string, std::string> unzip(std::string const & archive, size_t chunk_size, size_t read_size = 100)
+{
+    zipstream::unzip_stream unzip(256);
+    std::map<std::string, std::string> entries;
+    size_t fed = 0;
+    auto const pump = [&]() {
+        if (fed < archive.size())
+        {
+            fed += unzip.feed(&archive[fed], std::min(chunk_size, archive.size() - fed));
+        }
+        else
+        {
+            unzip.finish();
+        }
+    };
+
+    zipstream::unzip_entry entry;
+    while (!unzip.done())
+    {
+        if (!unzip.next_entry(entry))
+        {
+            if (!unzip.done())
+            {
+                pump();
+            }
+            continue;
+        }
+
+        std::string content;
+        std::vector<char> buffer(read_size);
+        while (true)
+        {
+            size_t const count = unzip.read(buffer.data(), buffer.size());
+            if (count > 0)
+            {
+                content.append(buffer.data(), count);
+            }
+            else if (unzip.need_input())
+            {
+                pump();
+            }
+            else
+            {
+                break;
+            }
+        }
+        entries[entry.name] = content;
+    }
+
+    return entries;
+}
+
+// deflated entry, optionally followed by a data descriptor without signature
+void add_deflated(std::string & archive, std::string const & name, std::string const & content, bool descriptor)
+{
+    std::string const compressed = deflate_raw(content);
+    uint32_t const crc = crc32(0, reinterpret_cast<Bytef const *>(content.data()), content.size());
+    put_u32(archive, 0x04034b50);
+    put_u16(archive, 20);
+    put_u16(archive, (descriptor) ? 0x08 : 0x00);
+    put_u16(archive, 8);
+    put_u16(archive, 0);
+    put_u16(archive, 0);
+    put_u32(archive, (descriptor) ? 0 : crc);
+    put_u32(archive, (descriptor) ? 0 : compressed.size());
+    put_u32(archive, (descriptor) ? 0 : content.size());
+    put_u16(archive, name.size());
+    put_u16(archive, 0);
+    archive += name;
+    archive += compressed;
+    if (descriptor)
+    {
+        put_u32(archive, crc);
+        put_u32(archive, compressed.size());
+        put_u32(archive, content.size());
+    }
+}
+
+std::string make_content(size_t size)
+{
+    std::string content;
+    for(size_t i = 0; i < size; i++)
+    {
+        content.push_back(static_cast<char>('a' + ((i * 7) % 13)));
+    }
+    return content;
+}
+
+}
+
+TEST(unzip_stream, reads_built_archive)
+{
+    std::string const path = "zipstream_unzip_" + std::to_string(getpid()) + ".txt";
+    // contains a fake data descriptor signature
+    std::string const file_content = make_content(3000) + "PK\x07\x08" + make_content(500);
+    std::ofstream(path, std::ios_base::binary) << file_content;
+
+    zipstream::builder builder;
+    builder.add_directory("dir/");
+    builder.add_file_with_content("dir/a.txt", make_content(1000));
+    builder.add_file_from_path("dir/file.txt", path);
+    builder.add_file_with_content("dir/empty.txt", "");
+    auto const archive = read_all(*builder.build(), 1000);
+    std::remove(path.c_str());
+
+    for(size_t chunk_size: {1, 7, 100, 4096, 1 << 20})
+    {
+        auto const entries = unzip(archive, chunk_size);
+        ASSERT_EQ(4u, entries.size());
+        ASSERT_EQ("", entries.at("dir/"));
+        ASSERT_EQ(make_content(1000), entries.at("dir/a.txt"));
+        ASSERT_EQ(file_content, entries.at("dir/file.txt"));
+        ASSERT_EQ("", entries.at("dir/empty.txt"));
+    }
+}
+
+TEST(unzip_stream, reads_deflated_entries)
+{
+    std::string archive;
+    add_deflated(archive, "a.txt", make_content(10000), true);
+    add_deflated(archive, "b.txt", make_content(5000), false);
+    add_deflated(archive, "c.txt", "", true);
+    put_u32(archive, 0x06054b50);
+    archive += std::string(18, '\0');
+
+    for(size_t chunk_size: {1, 13, 4096})
+    {
+        auto const entries = unzip(archive, chunk_size, 333);
+        ASSERT_EQ(3u, entries.size());
+        ASSERT_EQ(make_content(10000), entries.at("a.txt"));
+        ASSERT_EQ(make_content(5000), entries.at("b.txt"));
+        ASSERT_EQ("", entries.at("c.txt"));
+    }
+}
+
+TEST(unzip_stream, reads_zstd_entries)
+{
+    if (!zipstream::compression_available(zipstream::compression::zstd))
+    {
+        GTEST_SKIP() << "zstd not available";
+    }
+
+    // the large entry is compressed incrementally and has a data descriptor
+    zipstream::builder builder;
+    builder.set_compression(zipstream::compression::zstd);
+    builder.add_file_with_content("small.txt", make_content(1000));
+    builder.add_file_with_content("large.txt", make_content(200000));
+    builder.set_compression(zipstream::compression::zlib);
+    builder.add_file_with_content("deflated.txt", make_content(5000));
+    builder.set_compression(zipstream::compression::zstd);
+    builder.add_file_with_content("empty.txt", "");
+    auto const archive = read_all(*builder.build(), 1000);
+
+    for(size_t chunk_size: {1, 13, 4096})
+    {
+        auto const entries = unzip(archive, chunk_size, 333);
+        ASSERT_EQ(4u, entries.size());
+        ASSERT_EQ(make_content(1000), entries.at("small.txt"));
+        ASSERT_EQ(make_content(200000), entries.at("large.txt"));
+        ASSERT_EQ(make_content(5000), entries.at("deflated.txt"));
+        ASSERT_EQ("", entries.at("empty.txt"));
+    }
+}
+
+TEST(unzip_stream, skips_unread_entries)
+{
+    zipstream::builder builder;
+    builder.add_file_with_content("a.txt", make_content(1000));
+    builder.add_file_with_content("b.txt", "b");
+    auto const archive = read_all(*builder.build(), 1000);
+
+    zipstream::unzip_stream unzip;
+    ASSERT_EQ(archive.size(), unzip.feed(archive.data(), archive.size()));
+    unzip.finish();
+
+    zipstream::unzip_entry entry;
+    ASSERT_TRUE(unzip.next_entry(entry));
+    ASSERT_EQ("a.txt", entry.name);
+    ASSERT_TRUE(unzip.next_entry(entry));
+    ASSERT_EQ("b.txt", entry.name);
+    ASSERT_FALSE(unzip.next_entry(entry));
+    ASSERT_TRUE(unzip.done());
+}
+
+TEST(unzip_stream, detects_corrupt_data)
+{
+    zipstream::builder builder;
+    builder.add_file_with_content("a.txt", make_content(1000));
+    auto archive = read_all(*builder.build(), 1000);
+    archive[100] ^= 1;
+
+    ASSERT_THROW(unzip(archive, 4096), std::runtime_error);
+}
+
+TEST(unzip_stream, detects_truncated_archive)
+{
+    zipstream::builder builder;
+    builder.add_file_with_content("a.txt", make_content(1000));
+    auto const archive = read_all(*builder.build(), 1000);
+
+    ASSERT_THROW(unzip(archive.substr(0, 500), 100), std::runtime_error);
+}
@@ -1,420 +1,462 @@
-#include <sys/mman.h>
-#include <unistd.h>
+#include "zipstream/crc32sum.hpp"
+#include "zipstream/compressor.hpp"
+#include "zipstream/fd_writer.hpp"
+#include <zipstream/reader.hpp>
+
 #include <fcntl.h>
-#include <sys/types.h>
-#include <sys/stat.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <thread>
 #include <vector>
-#include <stdexcept>
-
-#include <cinttypes>
 
 namespace
 {
 
-struct end_of_central_directory
+constexpr uint16_t const method_store = 0;
+
+// compressed entries are decompressed in chunks of this size
+constexpr size_t const chunk_size = 256 * 1024;
+
+enum class mode
+{
+    dump,
+    verify,
+    extract,
+    recover
+};
+
+struct entry_result
 {
-    uint32_t signature;
-    uint16_t disk_number;
-    uint16_t disk_with_start_of_central_directory;
-    uint16_t entries_on_this_disk;
-    uint16_t total_entries;
-    uint32_t size;
-    uint32_t offset;
-    std::string comment;
+    bool ok = false;
+    std::string message;
+    uint64_t bytes = 0;
 };
 
-class mmap_file
+void print_usage()
+{
+    std::cout << "usage: read_zip [--verify | --extract <dir> | --recover <output>] [--threads <count>] <archive>" << std::endl;
+}
+
+void dump(zipstream::reader const & zip)
 {
-    mmap_file(mmap_file const &) = delete;
-    mmap_file& operator=(mmap_file const &) = delete;
-public:
-    mmap_file(std::string const & path)
+    std::cout << "size: " << zip.size() << std::endl;
+    std::cout << std::endl;
+
+    std::cout << "end of central directory:" << std::endl;
+    std::cout << "  total entries:" << std::dec << zip.count() << std::endl;
+    std::cout << "  offset of start of central directory: 0x" << std::hex << zip.toc_offset() << std::endl;
+    std::cout << "  comment length: " << std::dec << zip.comment().size() << std::endl;
+    std::cout << "  comment: " << zip.comment() << std::endl;
+    std::cout << std::endl;
+
+    for(size_t index = 0; index < zip.count(); index++)
     {
-        fd = open(path.c_str(), O_RDONLY);
-        if (fd < 0)
-        {
-            throw std::runtime_error("failed to open file");
-        }
+        auto const cfh = zip.entry(index);
+        std::cout << "central file header:" << std::endl;
+        std::cout << "  version made by: 0x" << std::hex << cfh.version_made_by << std::endl;
+        std::cout << "  version needed to extract: " << std::dec << cfh.version_needed << std::endl;
+        std::cout << "  general purpose bit flag: 0x" << std::hex << cfh.flags << std::endl;
+        std::cout << "  compression method: " << std::dec << cfh.compression_method << std::endl;
+        std::cout << "  last mod file time: " << std::dec << cfh.last_mod_time << std::endl;
+        std::cout << "  last mod file date: " << std::dec << cfh.last_mod_date << std::endl;
+        std::cout << "  crc32: 0x" << std::hex << cfh.crc32 << std::endl;
+        std::cout << "  compressed size: " << std::dec << cfh.compressed_size << std::endl;
+        std::cout << "  uncompressed size: " << std::dec << cfh.uncompressed_size << std::endl;
+        std::cout << "  file name: " << cfh.name << std::endl;
+        std::cout << "  extra field length: " << std::dec << cfh.extra.size() << std::endl;
+        std::cout << "  file comment: " << cfh.comment << std::endl;
+        std::cout << "  disk number start: " << std::dec << cfh.disk_number_start << std::endl;
+        std::cout << "  interal file attributes: 0x" << std::hex << cfh.internal_attributes << std::endl;
+        std::cout << "  external file attributes: 0x" << std::hex << cfh.external_attributes << std::endl;
+        std::cout << "  local header offset: 0x" << std::hex << cfh.local_header_offset << std::endl;
+        std::cout << std::endl;
+
+        auto const lfh = zip.local_header(index);
+        std::cout << "local file header:" << std::endl;
+        std::cout << "  version needed to extract: " << std::dec << lfh.version_needed << std::endl;
+        std::cout << "  general purpose bit flag: 0x" << std::hex << lfh.flags << std::endl;
+        std::cout << "  compression method: " << std::dec << lfh.compression_method << std::endl;
+        std::cout << "  last mod file time: " << std::dec << lfh.last_mod_time << std::endl;
+        std::cout << "  last mod file date: " << std::dec << lfh.last_mod_date << std::endl;
+        std::cout << "  crc32: 0x" << std::hex << lfh.crc32 << std::endl;
+        std::cout << "  compressed size: " << std::dec << lfh.compressed_size << std::endl;
+        std::cout << "  uncompressed size: " << std::dec << lfh.uncompressed_size << std::endl;
+        std::cout << "  filename: " << lfh.name << std::endl;
+        std::cout << "  extra field size: " << lfh.extra.size() << std::endl;
+        std::cout << std::endl;
+    }
+}
 
-        struct stat info;
-        int const rc = fstat(fd, &info);
-        if (rc != 0)
+// rejects absolute names and names leaving the target directory
+bool is_safe_name(std::string_view name)
+{
+    if ((name.empty()) || (name.front() == '/'))
+    {
+        return false;
+    }
+
+    size_t start = 0;
+    while (start <= name.size())
+    {
+        size_t end = name.find('/', start);
+        if (end == std::string_view::npos)
         {
-            close(fd);
-            throw std::runtime_error("failed to stat file");
+            end = name.size();
         }
-        size = info.st_size;
 
-        address = reinterpret_cast<uint8_t*>(mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0));
-        if (address == ((void*) -1))
+        if (name.substr(start, end - start) == "..")
         {
-            close(fd);
-            throw std::runtime_error("failed to mmap file");
+            return false;
         }
-
+        start = end + 1;
     }
 
-    ~mmap_file()
+    return true;
+}
+
+// copies stored data in the kernel; falls back to writing from the mapping
+bool copy_data(int archive_fd, uint64_t offset, std::string_view data, std::string const & path)
+{
+    int const fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
     {
-        if (fd > 0)
-        {
-            munmap(address, size);
-            close(fd);
-        }
+        return false;
     }
 
-    mmap_file(mmap_file && other)
+    loff_t in_offset = static_cast<loff_t>(offset);
+    size_t done = 0;
+    bool use_copy_file_range = true;
+    while (done < data.size())
     {
-        if (this != &other)
+        ssize_t count;
+        if (use_copy_file_range)
         {
-            this->fd = other.fd;
-            this->address = other.address;
-            this->size = other.size;
+            count = copy_file_range(archive_fd, &in_offset, fd, nullptr, data.size() - done, 0);
+            if ((count < 0) && ((errno == EXDEV) || (errno == ENOSYS) || (errno == EINVAL) || (errno == EOPNOTSUPP)))
+            {
+                use_copy_file_range = false;
+                continue;
+            }
+        }
+        else
+        {
+            count = write(fd, &data[done], data.size() - done);
+        }
 
-            other.fd = -1;
-            other.address = nullptr;
-            other.size = 0;
+        if ((count < 0) && (errno == EINTR))
+        {
+            continue;
         }
-    }
 
-    mmap_file& operator=(mmap_file && other)
-    {
-        if (this != &other)
+        if (count <= 0)
         {
-                if (fd > 0)
-                {
-                    munmap(address, size);
-                    close(fd);
-                }
-            
-            this->fd = other.fd;
-            this->address = other.address;
-            this->size = other.size;
-
-            other.fd = -1;
-            other.address = nullptr;
-            other.size = 0;
+            close(fd);
+            return false;
         }
 
-        return *this;
+        done += count;
     }
 
-    uint8_t const * get_address() const
+    return (0 == close(fd));
+}
+
+// decompresses in chunks, so that memory does not depend on the size an
+// entry claims; the checksum and the output are fed chunk by chunk
+bool decompress_data(zipstream::entry_info const & info, std::string_view data, int fd,
+    entry_result & result)
+{
+    auto decompressor = zipstream::make_decompressor(info.compression_method);
+    if (!decompressor)
     {
-        return address;
+        result.message = "unsupported compression method " + std::to_string(info.compression_method);
+        return false;
     }
 
-    uint32_t read_u32(size_t offset) const
+    std::vector<char> buffer(chunk_size);
+    char const * input = data.data();
+    size_t input_size = data.size();
+    zipstream::crc32sum checksum;
+    uint64_t size = 0;
+    bool done = false;
+    while (!done)
     {
-        if ((offset + 4) > size)
+        char * output = buffer.data();
+        size_t output_size = buffer.size();
+        size_t const pending = input_size;
+        try
         {
-            throw std::runtime_error("read out of bounds");
+            done = decompressor->decompress(input, input_size, output, output_size);
         }
-
-        uint32_t value = 0;
-        for(size_t i = 0; i < 4; i++)
+        catch (std::exception const &)
         {
-            uint8_t c = address[offset + 3 - i];
-            value <<= 8;
-            value |= c;
+            result.message = "failed to decompress (method " + std::to_string(info.compression_method) + ")";
+            return false;
         }
 
-        return value;
-    }
-
-    uint16_t read_u16(size_t offset) const
-    {
-        if ((offset + 2) > size)
+        size_t const produced = buffer.size() - output_size;
+        if ((!done) && (produced == 0) && (pending == input_size))
         {
-            throw std::runtime_error("read out of bounds");
+            result.message = "truncated data";
+            return false;
         }
 
-        uint8_t const low = address[offset];
-        uint8_t const high = address[offset + 1];
-
-        return (high << 8) | low;
-    }
+        size += produced;
+        if (size > info.uncompressed_size)
+        {
+            result.message = "size mismatch";
+            return false;
+        }
 
-    std::string read_string(size_t offset, size_t length)
-    {
-        if ((offset + length) > size)
+        checksum.update(buffer.data(), produced);
+        if (fd >= 0)
         {
-            throw std::runtime_error("read out of bounds");
+            try
+            {
+                zipstream::write_all(fd, buffer.data(), produced);
+            }
+            catch (std::exception const &)
+            {
+                result.message = "failed to write";
+                return false;
+            }
         }
+    }
 
-        return std::string(reinterpret_cast<char const*>(&address[offset]), length);
+    if (size != info.uncompressed_size)
+    {
+        result.message = "size mismatch";
+        return false;
     }
 
-    size_t get_size() const
+    if (checksum.get_value() != info.crc32)
     {
-        return size;
+        result.message = "crc32 mismatch";
+        return false;
     }
 
-private:
-    int fd;
-    size_t size;
-    uint8_t * address;
-};
+    result.bytes = size;
+    return true;
+}
 
-size_t find_end_of_central_directory(mmap_file& zip)
+entry_result process_entry(zipstream::reader const & zip, size_t index, int archive_fd, mode run_mode,
+    std::filesystem::path const & target)
 {
-    uint8_t const * file = zip.get_address();
-    for(size_t i = zip.get_size() - 22; i >= 4; i--)
+    entry_result result;
+    auto const info = zip.entry(index);
+    bool const is_directory = ((!info.name.empty()) && (info.name.back() == '/'));
+
+    if ((run_mode == mode::extract) && (!is_safe_name(info.name)))
+    {
+        result.message = "unsafe file name";
+        return result;
+    }
+
+    std::filesystem::path path;
+    if (run_mode == mode::extract)
     {
-        uint32_t const signature = zip.read_u32(i);
-        if (signature == 0x06054b50)
+        std::error_code error;
+        path = target / std::string(info.name);
+        std::filesystem::create_directories((is_directory) ? path : path.parent_path(), error);
+    }
+
+    auto const data = zip.data(index);
+    if ((!is_directory) && (info.compression_method != method_store))
+    {
+        int fd = -1;
+        if (run_mode == mode::extract)
+        {
+            fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0)
+            {
+                result.message = "failed to write " + path.string();
+                return result;
+            }
+        }
+
+        result.ok = decompress_data(info, data, fd, result);
+        if ((fd >= 0) && (0 != close(fd)) && (result.ok))
+        {
+            result.ok = false;
+            result.message = "failed to write " + path.string();
+        }
+        if ((fd >= 0) && (!result.ok))
         {
-            return i;
+            // no partial files of corrupt entries
+            std::error_code error;
+            std::filesystem::remove(path, error);
         }
+        return result;
     }
 
-    throw std::runtime_error("invalid file format: end of central directory not found");
-}
+    if (data.size() != info.uncompressed_size)
+    {
+        result.message = "size mismatch";
+        return result;
+    }
 
-void read_end_of_central_directory(mmap_file& zip, size_t offset, end_of_central_directory & eocd)
-{
-    eocd.signature = zip.read_u32(offset);
-    eocd.disk_number = zip.read_u16(offset + 4);
-    eocd.disk_with_start_of_central_directory = zip.read_u16(offset + 6);
-    eocd.entries_on_this_disk = zip.read_u16(offset + 8);
-    eocd.total_entries = zip.read_u16(offset + 10);
-    eocd.size = zip.read_u32(offset +12);
-    eocd.offset = zip.read_u32(offset + 16);
-    
-    uint16_t const comment_length = zip.read_u16(offset + 20);
-    if (comment_length == 0)
+    zipstream::crc32sum checksum;
+    checksum.update(data.data(), data.size());
+    if (checksum.get_value() != info.crc32)
     {
-        eocd.comment = "";
+        result.message = "crc32 mismatch";
+        return result;
     }
-    else
+
+    if ((run_mode == mode::extract) && (!is_directory)
+        && (!copy_data(archive_fd, zip.local_header(index).data_offset, data, path.string())))
     {
-        eocd.comment = zip.read_string(offset + 22, comment_length);
+        result.message = "failed to write " + path.string();
+        return result;
     }
+
+    result.ok = true;
+    result.bytes = data.size();
+    return result;
 }
 
-// central file header
-
-constexpr uint32_t const cfh_signature = 0x02014b50;
-constexpr size_t const cfh_signature_offset = 0;
-constexpr size_t const cfh_version_made_by_offset = 4;
-constexpr size_t const cfh_version_needed_offset = 6;
-constexpr size_t const cfh_flags_offset = 8;
-constexpr size_t const cfh_compression_method_offset = 10;
-constexpr size_t const cfh_last_mod_time_offset = 12;
-constexpr size_t const cfh_last_mod_date_offset = 14;
-constexpr size_t const cfh_checksum_offset = 16;
-constexpr size_t const cfh_compressed_size_offset = 20;
-constexpr size_t const cfh_uncompressed_size_offset = 24;
-constexpr size_t const cfh_filename_length_offset = 28;
-constexpr size_t const cfh_extra_field_length_offset = 30;
-constexpr size_t const cfh_comment_offset = 32;
-constexpr size_t const cfh_start_disk_offset = 34;
-constexpr size_t const cfh_internal_attributes_offset = 36;
-constexpr size_t const cfh_external_attributes_offset = 38;
-constexpr size_t const cfh_local_header_offset_offset = 42;
-constexpr size_t const cfh_filename_offset = 46;
-constexpr size_t const cfh_static_size = 46;
-
-struct central_file_header
+int run(std::string const & filename, mode run_mode, std::filesystem::path const & target, size_t thread_count)
 {
-    uint32_t signature;
-    uint16_t version_made_by;
-    uint16_t version_needed_to_extract;
-    uint16_t general_purpose_flag;
-    uint16_t compression_method;
-    uint16_t last_mod_time;
-    uint16_t last_mod_date;
-    uint32_t checksum;
-    uint32_t compressed_size;
-    uint32_t uncompressed_size;
-    uint16_t disk_number_start;
-    uint16_t internal_file_attributes;
-    uint32_t external_file_attributes;
-    uint32_t offset_of_local_header;
+    if (run_mode == mode::recover)
+    {
+        size_t const count = zipstream::recover_archive(filename, target.string());
+        std::cout << "recovered entries: " << count << std::endl;
+        return 0;
+    }
 
-    std::string filename;
-    std::string extra;
-    std::string comment;
-    size_t size;
+    zipstream::reader zip(filename);
+    if (run_mode == mode::dump)
+    {
+        dump(zip);
+        return 0;
+    }
 
-    void parse(mmap_file & zip, size_t offset)
+    int const archive_fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (archive_fd < 0)
     {
-        signature = zip.read_u32(offset + cfh_signature_offset);
-        if (signature != cfh_signature)
+        std::cerr << "error: failed to open " << filename << std::endl;
+        return 1;
+    }
+
+    auto const start = std::chrono::steady_clock::now();
+    std::vector<entry_result> results(zip.count());
+    std::atomic<size_t> next(0);
+    auto const work = [&]() {
+        for(size_t index = next++; index < results.size(); index = next++)
         {
-            throw std::runtime_error("invalid central file header signature");
+            try
+            {
+                results[index] = process_entry(zip, index, archive_fd, run_mode, target);
+            }
+            catch (std::exception const & ex)
+            {
+                results[index].message = ex.what();
+            }
         }
+    };
 
-        version_made_by = zip.read_u16(offset + cfh_version_made_by_offset);
-        version_needed_to_extract = zip.read_u16(offset + cfh_version_needed_offset);
-        general_purpose_flag = zip.read_u16(offset + cfh_flags_offset);
-        compression_method = zip.read_u16(offset + cfh_compression_method_offset);
-        last_mod_time = zip.read_u16(offset + cfh_last_mod_time_offset);
-        last_mod_date = zip.read_u16(offset + cfh_last_mod_date_offset);
-        checksum = zip.read_u32(offset + cfh_checksum_offset);
-        compressed_size = zip.read_u32(offset + cfh_compressed_size_offset);
-        uncompressed_size = zip.read_u32(offset + cfh_uncompressed_size_offset);
-        uint16_t const filename_length = zip.read_u16(offset + cfh_filename_length_offset);
-        uint16_t const extra_length = zip.read_u16(offset + cfh_extra_field_length_offset);
-        uint16_t const comment_length = zip.read_u16(offset + cfh_comment_offset);
-        internal_file_attributes = zip.read_u16(offset + cfh_internal_attributes_offset);
-        external_file_attributes = zip.read_u32(offset + cfh_external_attributes_offset);
-        offset_of_local_header = zip.read_u32(offset + cfh_local_header_offset_offset);
-        filename = zip.read_string(offset + cfh_filename_offset, filename_length);
-        size_t const extra_field_offset = cfh_static_size + filename_length;
-        extra = zip.read_string(offset + extra_field_offset, extra_length);
-        size_t const comment_offset = extra_field_offset + extra_length;
-        comment = zip.read_string(offset + comment_offset, comment_length);
-        size = cfh_static_size + filename_length + extra_length + comment_length;
+    std::vector<std::thread> workers;
+    for(size_t i = 1; i < std::min(thread_count, results.size()); i++)
+    {
+        workers.emplace_back(work);
     }
-};
-
-// local file header
-
-constexpr uint32_t const lfh_signature = 0x04034b50;
-constexpr size_t const lfh_signature_offset = 0;
-constexpr size_t const lfh_version_needed_offset = 4;
-constexpr size_t const lfh_flags_offset = 6;
-constexpr size_t const lfh_compression_method_offset = 8;
-constexpr size_t const lfh_last_mod_time_offset = 10;
-constexpr size_t const lfh_last_mod_date_offset = 12;
-constexpr size_t const lfh_checksum_offset = 14;
-constexpr size_t const lfh_compressed_size_offset = 18;
-constexpr size_t const lfh_uncompressed_size_offset = 22;
-constexpr size_t const lfh_filename_length_offset = 26;
-constexpr size_t const lfh_extra_length_offset = 28;
-constexpr size_t const lfh_filename_offset = 30;
-constexpr size_t const lfh_static_size = 30;
-
-struct local_file_header
-{
-    uint32_t signature;
-    uint16_t version_needed;
-    uint16_t flags;
-    uint16_t compression_method;
-    uint16_t last_mod_time;
-    uint16_t last_mod_date;
-    uint32_t checksum;
-    uint32_t compressed_size;
-    uint32_t uncompressed_size;
-    std::string filename;
-    std::string extra;
-    size_t data_offset;
+    work();
+    for(auto & worker: workers)
+    {
+        worker.join();
+    }
+    close(archive_fd);
 
-    void parse(mmap_file &zip, size_t offset)
+    double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t failed = 0;
+    uint64_t bytes = 0;
+    for(size_t index = 0; index < results.size(); index++)
     {
-        signature = zip.read_u32(offset + lfh_signature_offset);
-        if (signature != lfh_signature)
+        auto const & result = results[index];
+        if (result.ok)
         {
-            throw std::runtime_error("invalid local file header signature");
+            std::cout << "OK " << zip.name(index) << std::endl;
+            bytes += result.bytes;
         }
+        else
+        {
+            std::cout << "FAILED " << zip.name(index) << ": " << result.message << std::endl;
+            failed++;
+        }
+    }
 
-        version_needed = zip.read_u16(offset + lfh_version_needed_offset);
-        flags = zip.read_u16(offset + lfh_flags_offset);
-        compression_method = zip.read_u16(offset + lfh_compression_method_offset);
-        last_mod_time = zip.read_u16(offset + lfh_last_mod_time_offset);
-        last_mod_date = zip.read_u16(offset + lfh_last_mod_date_offset);
-        checksum = zip.read_u32(offset + lfh_checksum_offset);
-        compressed_size = zip.read_u32(offset + lfh_compressed_size_offset);
-        uncompressed_size = zip.read_u32(offset + lfh_uncompressed_size_offset);
-
-        uint16_t const filename_length = zip.read_u16(offset + lfh_filename_length_offset);
-        filename = zip.read_string(offset + lfh_filename_offset, filename_length);
-
-        uint16_t const extra_length = zip.read_u16(offset + lfh_extra_length_offset);
-        size_t extra_offset = lfh_static_size + filename_length;
-        extra = zip.read_string(offset + extra_offset, extra_length);
+    double const mib = static_cast<double>(bytes) / (1024 * 1024);
+    std::cout << std::endl;
+    std::cout << "entries: " << results.size() << ", failed: " << failed << std::endl;
+    std::cout << "data: " << std::fixed << std::setprecision(1) << mib << " MiB in "
+        << std::setprecision(3) << seconds << " s (" << std::setprecision(1)
+        << ((seconds > 0) ? mib / seconds : 0.0) << " MiB/s, " << thread_count << " threads)" << std::endl;
 
-        data_offset = offset + lfh_static_size + filename_length + extra_length;
-    }
-};
+    return (failed == 0) ? 0 : 1;
+}
 
 }
 
 int main(int argc, char* argv[])
 {
-    if (argc > 1)
-    {
-        char const * filename = argv[1];
-        mmap_file zip(filename);
-
-        std::cout << "size: " << zip.get_size() << std::endl;
-        std::cout << std::endl;
-
-        auto eocd_offset = find_end_of_central_directory(zip);
-        std::cout << "end of central directory: 0x" << std::hex << eocd_offset << std::endl;
-        std::cout << std::endl;
-
-        end_of_central_directory eocd;
-        read_end_of_central_directory(zip, eocd_offset, eocd);
-        std::cout << "end of central directory:" << std::endl;
-        std::cout << "  signature: 0x" << std::hex << eocd.signature << std::endl;
-        std::cout << "  number of this disk: " << std::dec << eocd.disk_number << std::endl;
-        std::cout << "  #disk with start of central directory:" << std::dec << eocd.disk_with_start_of_central_directory << std::endl;
-        std::cout << "  entries on this disk: " << std::dec << eocd.entries_on_this_disk << std::endl;
-        std::cout << "  total entries:" << std::dec << eocd.total_entries << std::endl;
-        std::cout << "  offset of start of central directory: 0x" << std::hex << eocd.offset << std::endl;
-        std::cout << "  comment length: " << std::dec << eocd.comment.size() << std::endl;
-        std::cout << "  comment: " << eocd.comment << std::endl;
-        std::cout << std::endl;
-
+    mode run_mode = mode::dump;
+    std::filesystem::path target;
+    size_t thread_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+    std::string filename;
 
-        std::vector<central_file_header> toc;
-        uint32_t offset = eocd.offset;
-        for(size_t i = 0; i < eocd.total_entries; i++) 
+    for(int i = 1; i < argc; i++)
+    {
+        std::string const arg = argv[i];
+        if (arg == "--verify")
         {
-            central_file_header cfh;
-            cfh.parse(zip, offset);
-            offset += cfh.size;
-            toc.push_back(cfh);
+            run_mode = mode::verify;
         }
-
-        for(auto const & cfh: toc)
+        else if ((arg == "--extract") && ((i + 1) < argc))
         {
-            std::cout << "central file header:" << std::endl;
-            std::cout << "  signature: 0x" << std::hex << cfh.signature << std::endl;
-            std::cout << "  version made by: 0x" << std::hex << cfh.version_made_by << std::endl;
-            std::cout << "  version needed to extract: " << std::dec << cfh.version_needed_to_extract << std::endl;
-            std::cout << "  general purpose bit flag: 0x" << std::hex << cfh.general_purpose_flag << std::endl;
-            std::cout << "  compression method: " << std::dec << cfh.compression_method << std::endl;
-            std::cout << "  last mod file time: " << std::dec << cfh.last_mod_time << std::endl;
-            std::cout << "  last mod file date: " << std::dec << cfh.last_mod_date << std::endl;
-            std::cout << "  crc32: 0x" << std::hex << cfh.checksum << std::endl;
-            std::cout << "  compressed size: " << std::dec << cfh.compressed_size << std::endl;
-            std::cout << "  uncompressed size: " << std::dec << cfh.uncompressed_size << std::endl;
-            std::cout << "  file name: " << cfh.filename << std::endl;
-            std::cout << "  extra field length: " << std::dec << cfh.extra.size() << std::endl;
-            std::cout << "  file comment: " << cfh.comment << std::endl;
-            std::cout << "  disk number start: " << std::dec << cfh.disk_number_start << std::endl;
-            std::cout << "  interal file attributes: 0x" << std::hex << cfh.internal_file_attributes << std::endl;
-            std::cout << "  external file attributes: 0x" << std::hex << cfh.external_file_attributes << std::endl;
-            std::cout << "  local header offset: 0x" << std::hex << cfh.offset_of_local_header << std::endl; 
-            std::cout << std::endl;
-
-
-            local_file_header lfh;
-            lfh.parse(zip, cfh.offset_of_local_header);
-
-            std::cout << "local file header:" << std::endl;
-            std::cout << "  signature: 0x" << std::hex << lfh.signature << std::endl;
-            std::cout << "  version needed to extract: " << std::dec << lfh.version_needed << std::endl;
-            std::cout << "  general purpose bit flag: 0x" << std::hex << lfh.flags << std::endl;
-            std::cout << "  compression method: " << std::dec << lfh.compression_method << std::endl;
-            std::cout << "  last mod file time: " << std::dec << lfh.last_mod_time << std::endl;
-            std::cout << "  last mod file date: " << std::dec << lfh.last_mod_date << std::endl;
-            std::cout << "  crc32: 0x" << std::hex << lfh.checksum << std::endl;
-            std::cout << "  compressed size: " << std::dec << lfh.compressed_size << std::endl;
-            std::cout << "  uncompressed size: " << std::dec << lfh.uncompressed_size << std::endl;
-            std::cout << "  filename: " << lfh.filename << std::endl;
-            std::cout << "  extra field size: " << lfh.extra.size() << std::endl;
-            std::cout << std::endl;
+            run_mode = mode::extract;
+            target = argv[++i];
         }
+        else if ((arg == "--recover") && ((i + 1) < argc))
+        {
+            run_mode = mode::recover;
+            target = argv[++i];
+        }
+        else if ((arg == "--threads") && ((i + 1) < argc))
+        {
+            thread_count = std::max(1, std::atoi(argv[++i]));
+        }
+        else if ((filename.empty()) && (arg.rfind("--", 0) != 0))
+        {
+            filename = arg;
+        }
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
 
+    if (filename.empty())
+    {
+        print_usage();
+        return 1;
     }
 
-    return 0;
-}
\ No newline at end of file
+    try
+    {
+        return run(filename, run_mode, target, thread_count);
+    }
+    catch (std::exception const & ex)
+    {
+        std::cerr << "error: " << ex.what() << std::endl;
+        return 1;
+    }
+}